@@ -0,0 +1,59 @@
+#include "async_writer.h"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace chc
+{
+
+AsyncWriter::AsyncWriter(std::ostream& os, size_t max_queued)
+	: _os(os), _max_queued(max_queued), _thread(&AsyncWriter::_run, this) { }
+
+AsyncWriter::~AsyncWriter()
+{
+	finish();
+}
+
+void AsyncWriter::push(std::string&& buffer)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_not_full.wait(lock, [this]() { return _queue.size() < _max_queued; });
+	_queue.push_back(std::move(buffer));
+	_not_empty.notify_one();
+}
+
+void AsyncWriter::finish()
+{
+	if (!_thread.joinable()) return;
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_finished = true;
+	}
+	_not_empty.notify_one();
+	_thread.join();
+}
+
+void AsyncWriter::_run()
+{
+	for (;;) {
+		std::string buffer;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_not_empty.wait(lock, [this]() { return _finished || !_queue.empty(); });
+			if (_queue.empty()) return;
+
+			buffer = std::move(_queue.front());
+			_queue.pop_front();
+		}
+		_not_full.notify_one();
+
+		_os.write(buffer.data(), buffer.size());
+		if (!_os) {
+			std::cerr << "FATAL_ERROR: Writing graph file failed. Exiting." << std::endl;
+			std::abort();
+		}
+	}
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "defs.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace chc
+{
+
+/*
+ * Writes buffers to an ostream on a dedicated thread, in the order they were
+ * pushed, so the producers can format the next buffers in the meantime.
+ *
+ * At most max_queued buffers wait for the writer; push() blocks until there
+ * is room again. finish() (or the destructor) writes the remaining buffers
+ * and joins the thread; failing writes are fatal.
+ */
+class AsyncWriter
+{
+	private:
+		std::ostream& _os;
+		size_t const _max_queued;
+
+		std::deque<std::string> _queue;
+		bool _finished = false;
+		std::mutex _mutex;
+		std::condition_variable _not_empty;
+		std::condition_variable _not_full;
+
+		std::thread _thread;
+
+		void _run();
+
+		AsyncWriter(AsyncWriter const&) = delete;
+		AsyncWriter& operator=(AsyncWriter const&) = delete;
+	public:
+		explicit AsyncWriter(std::ostream& os, size_t max_queued = 16);
+		~AsyncWriter();
+
+		void push(std::string&& buffer);
+		void finish();
+};
+
+}
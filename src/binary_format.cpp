@@ -0,0 +1,393 @@
+#include "binary_format.h"
+#include "compression.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace chc {
+	namespace FormatBinary {
+		BinaryNode toBinary(node_type const& node)
+		{
+			return BinaryNode { node.osm_id, node.lat, node.lon, node.elev, 0 };
+		}
+
+		BinaryEdge toBinary(edge_type const& edge)
+		{
+			BinaryEdge out;
+			std::memset(&out, 0, sizeof(out));
+			out.src = edge.src;
+			out.tgt = edge.tgt;
+			out.dist = edge.dist;
+			out.type = edge.type;
+			out.speed = edge.speed;
+			out.child_edge1 = edge.child_edge1;
+			out.child_edge2 = edge.child_edge2;
+			out.center_node = edge.center_node;
+			return out;
+		}
+
+		node_type fromBinary(BinaryNode const& in, NodeID node_id)
+		{
+			node_type node;
+			node.id = node_id;
+			node.osm_id = in.osm_id;
+			node.lat = in.lat;
+			node.lon = in.lon;
+			node.elev = in.elev;
+			return node;
+		}
+
+		edge_type fromBinary(BinaryEdge const& in, EdgeID edge_id)
+		{
+			if (in.dist >= c::NO_EDGE_DIST) {
+				std::cerr << "FATAL_ERROR: Edge distance " << in.dist << " doesn't fit into a "
+					<< 8 * sizeof(Distance) << " bit distance (see CHC_DISTANCE_BITS). Exiting.\n";
+				std::abort();
+			}
+			return edge_type(OSMEdge(edge_id, in.src, in.tgt, in.dist, in.type, in.speed),
+				in.child_edge1, in.child_edge2, in.center_node);
+		}
+
+		namespace {
+			void appendString(std::string& out, std::string const& s)
+			{
+				uint32_t len(s.size());
+				out.append(reinterpret_cast<char const*>(&len), sizeof(len));
+				out.append(s);
+			}
+
+			bool readString(char const*& pos, char const* end, std::string& s)
+			{
+				uint32_t len;
+				if (uint64_t(end - pos) < sizeof(len)) return false;
+				std::memcpy(&len, pos, sizeof(len));
+				pos += sizeof(len);
+				if (uint64_t(end - pos) < len) return false;
+				s.assign(pos, len);
+				pos += len;
+				return true;
+			}
+
+			uint64_t alignUp(uint64_t pos)
+			{
+				return (pos + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+			}
+
+			uint32_t elementSize(SectionType type)
+			{
+				switch (type) {
+				case SectionType::META:
+					return 1;
+				case SectionType::NODES:
+					return sizeof(BinaryNode);
+				case SectionType::EDGES:
+					return sizeof(BinaryEdge);
+				case SectionType::LEVELS:
+					return sizeof(uint32_t);
+				case SectionType::UP_OUT_OFFSETS:
+				case SectionType::UP_IN_OFFSETS:
+				case SectionType::UP_OUT_EDGES:
+				case SectionType::UP_IN_EDGES:
+					return sizeof(EdgeID);
+				}
+				return 0;
+			}
+		}
+
+		std::string serializeMetadata(Metadata const& meta_data)
+		{
+			std::string out;
+			for (auto const& entry: meta_data) {
+				appendString(out, entry.first);
+				appendString(out, entry.second);
+			}
+			return out;
+		}
+
+		Metadata deserializeMetadata(char const* data, uint64_t size)
+		{
+			Metadata meta_data;
+			char const* pos(data);
+			char const* end(data + size);
+			while (pos != end) {
+				std::string key, value;
+				if (!readString(pos, end, key) || !readString(pos, end, value)) {
+					std::cerr << "FATAL_ERROR: Invalid meta data in binary graph file. Exiting." << std::endl;
+					std::abort();
+				}
+				meta_data[key] = value;
+			}
+			return meta_data;
+		}
+
+
+		MappedFile::MappedFile(std::string const& filename, bool verify_ids) : _filename(filename)
+		{
+			if (compressionOf(filename) != Compression::NONE) {
+				_fail("compressed files can't be mapped, decompress it first");
+			}
+
+			int fd(open(filename.c_str(), O_RDONLY));
+			if (fd < 0) {
+				std::cerr << "FATAL_ERROR: Couldn't open graph file \'" <<
+					filename << "\'. Exiting." << std::endl;
+				std::abort();
+			}
+
+			struct stat st;
+			if (fstat(fd, &st) < 0) {
+				close(fd);
+				_fail(std::strerror(errno));
+			}
+			_size = st.st_size;
+			if (_size < sizeof(FileHeader)) {
+				close(fd);
+				_fail("file too small");
+			}
+
+			void* data(mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0));
+			close(fd);
+			if (data == MAP_FAILED) {
+				_fail(std::strerror(errno));
+			}
+			_data = static_cast<char const*>(data);
+
+			_validate();
+			if (verify_ids) _verifyIds();
+		}
+
+		MappedFile::MappedFile(MappedFile&& other)
+			: _filename(std::move(other._filename)), _data(other._data), _size(other._size)
+		{
+			other._data = nullptr;
+			other._size = 0;
+		}
+
+		MappedFile& MappedFile::operator=(MappedFile&& other)
+		{
+			std::swap(_filename, other._filename);
+			std::swap(_data, other._data);
+			std::swap(_size, other._size);
+			return *this;
+		}
+
+		MappedFile::~MappedFile()
+		{
+			if (_data) munmap(const_cast<char*>(_data), _size);
+		}
+
+		void MappedFile::_fail(std::string const& reason) const
+		{
+			std::cerr << "FATAL_ERROR: Invalid binary graph file \'" << _filename
+				<< "\': " << reason << ". Exiting." << std::endl;
+			std::abort();
+		}
+
+		void MappedFile::_validate() const
+		{
+			FileHeader const& h(header());
+			if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) {
+				_fail("wrong magic number");
+			}
+			if (h.byte_order != BYTE_ORDER_MARK) {
+				_fail("written on a host with different byte order");
+			}
+			if (h.version != VERSION) {
+				_fail("unsupported version " + std::to_string(h.version));
+			}
+			if (h.nr_of_sections > MAX_SECTIONS) {
+				_fail("too many sections");
+			}
+			if (h.nr_of_nodes >= c::NO_NID || h.nr_of_edges >= c::NO_EID) {
+				_fail("too many nodes or edges");
+			}
+
+			for (uint32_t i(0); i<h.nr_of_sections; i++) {
+				Section const& s(h.sections[i]);
+				if (s.element_size == 0 || s.element_size != elementSize(s.type) || s.size % s.element_size != 0) {
+					_fail("invalid section " + std::to_string(from_enum(s.type)));
+				}
+				if (s.offset % ALIGNMENT != 0 || s.offset > _size || s.size > _size - s.offset) {
+					_fail("section " + std::to_string(from_enum(s.type)) + " out of bounds");
+				}
+			}
+
+			auto expectSection = [this](SectionType type, uint64_t count) {
+				Section const* s(findSection(type));
+				if (!s) {
+					_fail("missing section " + std::to_string(from_enum(type)));
+				}
+				if (count != uint64_t(-1) && s->size != count * s->element_size) {
+					_fail("unexpected size of section " + std::to_string(from_enum(type)));
+				}
+			};
+
+			uint64_t n(h.nr_of_nodes);
+			expectSection(SectionType::META, uint64_t(-1));
+			expectSection(SectionType::NODES, n);
+			expectSection(SectionType::EDGES, h.nr_of_edges);
+			if (isCH()) {
+				expectSection(SectionType::LEVELS, n);
+				expectSection(SectionType::UP_OUT_OFFSETS, n + 1);
+				expectSection(SectionType::UP_OUT_EDGES, uint64_t(-1));
+				expectSection(SectionType::UP_IN_OFFSETS, n + 1);
+				expectSection(SectionType::UP_IN_EDGES, uint64_t(-1));
+
+				/* the offsets have to describe the edge arrays exactly */
+				SectionType const csr[2][2] = {
+					{ SectionType::UP_OUT_OFFSETS, SectionType::UP_OUT_EDGES },
+					{ SectionType::UP_IN_OFFSETS, SectionType::UP_IN_EDGES }
+				};
+				for (auto const& types: csr) {
+					EdgeID const* offsets(section<EdgeID>(types[0]));
+					if (offsets[0] != 0 || offsets[n] != sectionCount<EdgeID>(types[1])) {
+						_fail("invalid offsets in section " + std::to_string(from_enum(types[0])));
+					}
+				}
+			}
+		}
+
+		void MappedFile::_verifyIds() const
+		{
+			FileHeader const& h(header());
+			uint64_t n(h.nr_of_nodes);
+
+			if (isCH()) {
+				SectionType const csr[2][2] = {
+					{ SectionType::UP_OUT_OFFSETS, SectionType::UP_OUT_EDGES },
+					{ SectionType::UP_IN_OFFSETS, SectionType::UP_IN_EDGES }
+				};
+				for (auto const& types: csr) {
+					EdgeID const* offsets(section<EdgeID>(types[0]));
+					for (uint64_t i(0); i<n; i++) {
+						if (offsets[i] > offsets[i+1]) {
+							_fail("decreasing offsets in section " + std::to_string(from_enum(types[0])));
+						}
+					}
+
+					EdgeID const* edge_ids(section<EdgeID>(types[1]));
+					for (uint64_t i(0), size(sectionCount<EdgeID>(types[1])); i<size; i++) {
+						if (edge_ids[i] >= h.nr_of_edges) {
+							_fail("invalid edge id in section " + std::to_string(from_enum(types[1])));
+						}
+					}
+				}
+			}
+
+			BinaryEdge const* edges(section<BinaryEdge>(SectionType::EDGES));
+			for (uint64_t i(0); i<h.nr_of_edges; i++) {
+				BinaryEdge const& edge(edges[i]);
+				if (edge.src >= n || edge.tgt >= n) {
+					_fail("invalid node id in edge " + std::to_string(i));
+				}
+				if ((edge.child_edge1 != c::NO_EID && edge.child_edge1 >= h.nr_of_edges)
+						|| (edge.child_edge2 != c::NO_EID && edge.child_edge2 >= h.nr_of_edges)
+						|| (edge.center_node != c::NO_NID && edge.center_node >= n)) {
+					_fail("invalid shortcut data in edge " + std::to_string(i));
+				}
+			}
+		}
+
+		Section const* MappedFile::findSection(SectionType type) const
+		{
+			FileHeader const& h(header());
+			for (uint32_t i(0); i<h.nr_of_sections; i++) {
+				if (h.sections[i].type == type) return &h.sections[i];
+			}
+			return nullptr;
+		}
+
+		Metadata MappedFile::metaData() const
+		{
+			Section const* s(findSection(SectionType::META));
+			return deserializeMetadata(_data + s->offset, s->size);
+		}
+
+		namespace
+		{
+			/* false if is doesn't start with a readable header */
+			bool readHeader(std::istream& is, FileHeader& header)
+			{
+				if (!is.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+				return std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.byte_order == BYTE_ORDER_MARK
+					&& header.version == VERSION && header.nr_of_sections <= MAX_SECTIONS;
+			}
+		}
+
+		bool isCHFile(std::string const& filename)
+		{
+			std::ifstream is(filename.c_str(), std::ios::binary);
+			FileHeader header;
+			return readHeader(is, header) && (header.flags & FLAG_CH);
+		}
+
+		bool readMetadata(std::string const& filename, Metadata& meta_data)
+		{
+			std::ifstream is(filename.c_str(), std::ios::binary | std::ios::ate);
+			uint64_t file_size(is ? uint64_t(is.tellg()) : 0);
+			is.seekg(0);
+
+			FileHeader header;
+			if (!readHeader(is, header)) return false;
+
+			for (uint32_t i(0); i<header.nr_of_sections; i++) {
+				Section const& s(header.sections[i]);
+				if (s.type != SectionType::META) continue;
+				if (s.offset > file_size || s.size > file_size - s.offset) return false;
+
+				std::string data(s.size, '\0');
+				if (!is.seekg(s.offset) || !is.read(&data[0], s.size)) return false;
+				meta_data = deserializeMetadata(data.data(), data.size());
+				return true;
+			}
+			return false;
+		}
+
+
+		uint64_t Writer::_writeHeader(std::ostream& os, FileHeader& header,
+				std::vector<std::pair<SectionType, uint64_t>> const& sections)
+		{
+			assert(sections.size() <= MAX_SECTIONS);
+
+			std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+			header.version = VERSION;
+			header.byte_order = BYTE_ORDER_MARK;
+			header.nr_of_sections = sections.size();
+
+			uint64_t pos(alignUp(sizeof(FileHeader)));
+			for (size_t i(0); i<sections.size(); i++) {
+				Section& s(header.sections[i]);
+				s.type = sections[i].first;
+				s.element_size = elementSize(s.type);
+				s.offset = pos;
+				s.size = sections[i].second;
+				pos = alignUp(pos + s.size);
+			}
+
+			os.write(reinterpret_cast<char const*>(&header), sizeof(header));
+			return sizeof(header);
+		}
+
+		void Writer::_writeSection(std::ostream& os, uint64_t& pos, Section const& section, void const* data)
+		{
+			static char const zeros[ALIGNMENT] = { 0 };
+			assert(section.offset >= pos && section.offset - pos < ALIGNMENT);
+
+			os.write(zeros, section.offset - pos);
+			os.write(static_cast<char const*>(data), section.size);
+			pos = section.offset + section.size;
+
+			if (!os) {
+				std::cerr << "FATAL_ERROR: Writing binary graph file failed. Exiting." << std::endl;
+				std::abort();
+			}
+		}
+	}
+}
@@ -0,0 +1,401 @@
+#pragma once
+
+#include "file_formats_helper.h"
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace chc {
+	/*
+	 * Binary graph / CH format.
+	 *
+	 * Layout (little endian on all supported hosts, checked by byte_order):
+	 *   FileHeader     magic, version, flags, counts and the section table
+	 *   sections       each starts at a multiple of ALIGNMENT:
+	 *     META            (uint32 key length, key, uint32 value length, value)*
+	 *     NODES           BinaryNode[nr_of_nodes], node id = index
+	 *     EDGES           BinaryEdge[nr_of_edges], edge id = index
+	 *   and only in CH files (flags & FLAG_CH):
+	 *     LEVELS          uint32[nr_of_nodes]
+	 *     UP_OUT_OFFSETS  EdgeID[nr_of_nodes + 1]; upward out edges of a node
+	 *     UP_OUT_EDGES    EdgeID[...]
+	 *     UP_IN_OFFSETS   EdgeID[nr_of_nodes + 1]; upward in edges of a node
+	 *     UP_IN_EDGES     EdgeID[...]
+	 *
+	 * All sections are plain arrays, so a mapped file can be used in place.
+	 * NodeID and EdgeID have the configured widths (CHC_NODE_ID_BITS,
+	 * CHC_EDGE_ID_BITS), so files can only be read with the widths they were
+	 * written with; the element sizes of the sections ensure that.
+	 * The stored data is that of CHNode<OSMNode> and CHEdge<OSMEdge>.
+	 */
+	namespace FormatBinary
+	{
+		typedef CHNode<OSMNode> node_type;
+		typedef CHEdge<OSMEdge> edge_type;
+
+		static constexpr char MAGIC[8] = { 'C', 'H', 'C', 'G', 'R', 'A', 'P', 'H' };
+		static constexpr uint32_t VERSION = 1;
+		static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+		static constexpr uint64_t ALIGNMENT = 64;
+
+		static constexpr uint32_t FLAG_CH = 1;
+
+		enum class SectionType : uint32_t {
+			META = 1, NODES, EDGES, LEVELS,
+			UP_OUT_OFFSETS, UP_OUT_EDGES, UP_IN_OFFSETS, UP_IN_EDGES
+		};
+		static constexpr uint32_t MAX_SECTIONS = 8;
+
+		struct Section
+		{
+			SectionType type;
+			uint32_t element_size;
+			uint64_t offset;
+			uint64_t size; /* in bytes */
+		};
+
+		struct FileHeader
+		{
+			char magic[8];
+			uint32_t version;
+			uint32_t byte_order;
+			uint32_t flags;
+			uint32_t nr_of_sections;
+			uint64_t nr_of_nodes;
+			uint64_t nr_of_edges;
+			Section sections[MAX_SECTIONS];
+		};
+
+		struct BinaryNode
+		{
+			uint64_t osm_id;
+			double lat;
+			double lon;
+			int32_t elev;
+			uint32_t padding;
+		};
+
+		struct BinaryEdge
+		{
+			NodeID src;
+			NodeID tgt;
+			uint32_t dist;
+			uint32_t type;
+			int32_t speed;
+			EdgeID child_edge1;
+			EdgeID child_edge2;
+			NodeID center_node;
+
+			uint distance() const { return dist; }
+		};
+
+		static_assert(sizeof(Section) == 24, "unexpected padding in Section");
+		static_assert(sizeof(FileHeader) == 40 + MAX_SECTIONS * sizeof(Section), "unexpected padding in FileHeader");
+		static_assert(sizeof(BinaryNode) == 32, "unexpected padding in BinaryNode");
+		/* with 64 bit ids BinaryEdge is padded; toBinary() zeroes the padding */
+		static_assert(sizeof(BinaryEdge) == 32 || sizeof(NodeID) != 4 || sizeof(EdgeID) != 4,
+			"unexpected padding in BinaryEdge");
+
+		BinaryNode toBinary(node_type const& node);
+		BinaryEdge toBinary(edge_type const& edge);
+		node_type fromBinary(BinaryNode const& node, NodeID node_id);
+		edge_type fromBinary(BinaryEdge const& edge, EdgeID edge_id);
+
+		std::string serializeMetadata(Metadata const& meta_data);
+		Metadata deserializeMetadata(char const* data, uint64_t size);
+
+		/*
+		 * Read-only memory mapping of a binary graph file; the header and all
+		 * section sizes are validated when opening. With verify_ids, all node
+		 * / edge ids in the sections are checked as well, which reads the
+		 * whole file.
+		 */
+		class MappedFile
+		{
+			private:
+				std::string _filename;
+				char const* _data = nullptr;
+				uint64_t _size = 0;
+
+				void _validate() const;
+				/* the ids are used as indices without further checks */
+				void _verifyIds() const;
+				void _fail(std::string const& reason) const;
+			public:
+				MappedFile() { }
+				explicit MappedFile(std::string const& filename, bool verify_ids = false);
+				MappedFile(MappedFile&& other);
+				MappedFile& operator=(MappedFile&& other);
+				MappedFile(MappedFile const&) = delete;
+				MappedFile& operator=(MappedFile const&) = delete;
+				~MappedFile();
+
+				FileHeader const& header() const { return *reinterpret_cast<FileHeader const*>(_data); }
+				bool isCH() const { return header().flags & FLAG_CH; }
+				NodeID getNrOfNodes() const { return header().nr_of_nodes; }
+				EdgeID getNrOfEdges() const { return header().nr_of_edges; }
+
+				/* nullptr if the section is missing */
+				Section const* findSection(SectionType type) const;
+
+				template<typename T>
+				T const* section(SectionType type) const
+				{
+					Section const* s(findSection(type));
+					return s ? reinterpret_cast<T const*>(_data + s->offset) : nullptr;
+				}
+
+				template<typename T>
+				uint64_t sectionCount(SectionType type) const
+				{
+					Section const* s(findSection(type));
+					return s ? s->size / sizeof(T) : 0;
+				}
+
+				Metadata metaData() const;
+		};
+
+		/* true if filename is a binary CH file; only reads the header */
+		bool isCHFile(std::string const& filename);
+		/* only reads the meta data; false (instead of aborting) if filename isn't a readable binary graph file */
+		bool readMetadata(std::string const& filename, Metadata& meta_data);
+
+		struct Reader
+		{
+			typedef typename node_type::base_node_type base_node_type;
+			typedef typename edge_type::base_edge_type base_edge_type;
+
+			template<typename NodeT = base_node_type, typename EdgeT = edge_type>
+			struct can_read
+			{
+				typedef is_static_castable_t<base_node_type, NodeT> support_node;
+				typedef is_static_castable_t<base_edge_type, EdgeT> support_edge;
+
+				static constexpr bool value = support_node::value && support_edge::value;
+			};
+
+			template<typename NodeT = base_node_type, typename EdgeT = edge_type>
+			struct can_read_ch
+			{
+				typedef is_static_castable_t<base_node_type, NodeT> support_node;
+				typedef is_static_castable_t<edge_type, EdgeT> support_edge;
+
+				static constexpr bool value = support_node::value && support_edge::value;
+			};
+
+			template<typename NodeT = base_node_type, typename EdgeT = edge_type, typename std::enable_if<!can_read<NodeT, EdgeT>::value>::type* = nullptr>
+			static GraphInData<NodeT, EdgeT> readGraph(std::string const&, uint = 1)
+			{
+				Print("Can't read nodes / edges in this format");
+				std::abort();
+			}
+
+			/* reading a CH file as graph only keeps the original edges; nothing is parsed, so num_threads is unused */
+			template<typename NodeT = base_node_type, typename EdgeT = edge_type, typename std::enable_if<can_read<NodeT, EdgeT>::value>::type* = nullptr>
+			static GraphInData<NodeT, EdgeT> readGraph(std::string const& filename, uint num_threads = 1)
+			{
+				/* everything is read anyway, so checking the ids is cheap */
+				MappedFile file(filename, true);
+				GraphInData<NodeT, EdgeT> result;
+				result.meta_data = file.metaData();
+
+				_readNodes(file, result.nodes);
+
+				BinaryEdge const* edges(file.section<BinaryEdge>(SectionType::EDGES));
+				result.edges.reserve(file.getNrOfEdges());
+				for (EdgeID i = 0; i < file.getNrOfEdges(); ++i) {
+					if (edges[i].child_edge1 != c::NO_EID) continue;
+					edge_type edge(fromBinary(edges[i], result.edges.size()));
+					result.edges.push_back(static_cast<EdgeT>(static_cast<base_edge_type const&>(edge)));
+				}
+				Print("Read " << result.edges.size() << " edges.");
+
+				return result;
+			}
+
+			template<typename NodeT = base_node_type, typename EdgeT = edge_type, typename std::enable_if<!can_read_ch<NodeT, EdgeT>::value>::type* = nullptr>
+			static GraphCHInData<NodeT, EdgeT> readCHGraph(std::string const&, uint = 1)
+			{
+				Print("Can't read nodes / edges in this format");
+				std::abort();
+			}
+
+			template<typename NodeT = base_node_type, typename EdgeT = edge_type, typename std::enable_if<can_read_ch<NodeT, EdgeT>::value>::type* = nullptr>
+			static GraphCHInData<NodeT, EdgeT> readCHGraph(std::string const& filename, uint num_threads = 1)
+			{
+				MappedFile file(filename, true);
+				if (!file.isCH()) {
+					std::cerr << "FATAL_ERROR: '" << filename << "' doesn't contain a CH. Exiting." << std::endl;
+					std::abort();
+				}
+
+				GraphCHInData<NodeT, EdgeT> result;
+				result.meta_data = file.metaData();
+
+				_readNodes(file, result.nodes);
+
+				uint32_t const* levels(file.section<uint32_t>(SectionType::LEVELS));
+				result.node_levels.assign(levels, levels + file.getNrOfNodes());
+
+				BinaryEdge const* edges(file.section<BinaryEdge>(SectionType::EDGES));
+				result.edges.reserve(file.getNrOfEdges());
+				for (EdgeID i = 0; i < file.getNrOfEdges(); ++i) {
+					edge_type in_edge(fromBinary(edges[i], i));
+					EdgeT edge(static_cast<EdgeT>(in_edge));
+					copyShortcutData(edge, in_edge);
+					result.edges.push_back(std::move(edge));
+				}
+				Print("Read " << result.edges.size() << " edges.");
+
+				return result;
+			}
+
+		private:
+			template<typename NodeT>
+			static void _readNodes(MappedFile const& file, std::vector<NodeT>& nodes)
+			{
+				BinaryNode const* in_nodes(file.section<BinaryNode>(SectionType::NODES));
+				nodes.reserve(file.getNrOfNodes());
+				for (NodeID i = 0; i < file.getNrOfNodes(); ++i) {
+					nodes.push_back(static_cast<NodeT>(static_cast<base_node_type const&>(fromBinary(in_nodes[i], i))));
+				}
+				Print("Read " << nodes.size() << " nodes.");
+			}
+		};
+
+		struct Writer
+		{
+			typedef FormatBinary::node_type node_type;
+			typedef FormatBinary::edge_type edge_type;
+
+			template<typename NodeT, typename EdgeT>
+			using can_write = writer_can_write<Writer, NodeT, EdgeT>;
+
+			template<typename NodeT, typename EdgeT, typename std::enable_if<!can_write<NodeT, EdgeT>::value>::type* = nullptr>
+			static void writeGraph(std::ostream&, GraphOutData<NodeT, EdgeT> const&, uint = 1)
+			{
+				Print("Can't export nodes / edges in this format");
+				std::abort();
+			}
+
+			template<typename NodeT, typename EdgeT, typename std::enable_if<can_write<NodeT, EdgeT>::value>::type* = nullptr>
+			static void writeGraph(std::ostream& os, GraphOutData<NodeT, EdgeT> const& data, uint = 1)
+			{
+				std::vector<uint> node_levels(data.nodes.size(), c::NO_LVL);
+				_write(os, GraphCHOutData<NodeT, EdgeT>{data.nodes, node_levels, data.edges, data.meta_data}, false);
+			}
+
+			template<typename NodeT, typename EdgeT, typename std::enable_if<!can_write<NodeT, EdgeT>::value>::type* = nullptr>
+			static void writeCHGraph(std::ostream&, GraphCHOutData<NodeT, EdgeT> const&, uint = 1)
+			{
+				Print("Can't export nodes / edges in this format");
+				std::abort();
+			}
+
+			template<typename NodeT, typename EdgeT, typename std::enable_if<can_write<NodeT, EdgeT>::value>::type* = nullptr>
+			static void writeCHGraph(std::ostream& os, GraphCHOutData<NodeT, EdgeT> const& data, uint = 1)
+			{
+				_write(os, data, true);
+			}
+
+		private:
+			/* writes the header and the section table; returns the position after it */
+			static uint64_t _writeHeader(std::ostream& os, FileHeader& header,
+					std::vector<std::pair<SectionType, uint64_t>> const& sections);
+			static void _writeSection(std::ostream& os, uint64_t& pos, Section const& section, void const* data);
+
+			template<typename NodeT, typename EdgeT>
+			static void _write(std::ostream& os, GraphCHOutData<NodeT, EdgeT> const& data, bool is_ch);
+		};
+
+		template<typename NodeT, typename EdgeT>
+		void Writer::_write(std::ostream& os, GraphCHOutData<NodeT, EdgeT> const& data, bool is_ch)
+		{
+			uint64_t nr_of_nodes(data.nodes.size());
+			uint64_t nr_of_edges(data.edges.size());
+			if (nr_of_nodes >= c::NO_NID || nr_of_edges >= c::NO_EID) {
+				std::cerr << "FATAL_ERROR: Graph too large for the binary format. Exiting." << std::endl;
+				std::abort();
+			}
+
+			Print("Exporting " << nr_of_nodes << " nodes and " << nr_of_edges << " edges");
+
+			std::string meta(serializeMetadata(data.meta_data));
+
+			std::vector<BinaryNode> nodes;
+			nodes.reserve(nr_of_nodes);
+			for (NodeID node_id = 0; node_id < nr_of_nodes; ++node_id) {
+				node_type node(static_cast<node_type>(makeCHNode(data.nodes[node_id], data.node_levels[node_id])));
+				setNodeLevel(node, data.node_levels[node_id]);
+				nodes.push_back(toBinary(node));
+			}
+
+			std::vector<BinaryEdge> edges;
+			edges.reserve(nr_of_edges);
+			for (auto const& in_edge: data.edges) {
+				edge_type edge(static_cast<edge_type>(in_edge));
+				copyShortcutData(edge, in_edge);
+				edges.push_back(toBinary(edge));
+			}
+
+			/* upward edges; see CHGraph::isUp */
+			std::vector<EdgeID> up_offsets[2];
+			std::vector<EdgeID> up_edges[2];
+			if (is_ch) {
+				for (auto& offsets: up_offsets) offsets.assign(nr_of_nodes + 1, 0);
+				auto const& lvl(data.node_levels);
+				for (auto const& edge: edges) {
+					if (lvl[edge.src] < lvl[edge.tgt]) up_offsets[0][edge.src + 1]++;
+					else if (lvl[edge.src] > lvl[edge.tgt]) up_offsets[1][edge.tgt + 1]++;
+				}
+				for (uint d(0); d<2; d++) {
+					for (NodeID i(0); i<nr_of_nodes; i++) up_offsets[d][i + 1] += up_offsets[d][i];
+					up_edges[d].resize(up_offsets[d].back());
+				}
+				std::vector<EdgeID> pos[2] = {
+					std::vector<EdgeID>(up_offsets[0].begin(), up_offsets[0].end() - 1),
+					std::vector<EdgeID>(up_offsets[1].begin(), up_offsets[1].end() - 1)
+				};
+				for (EdgeID i(0); i<nr_of_edges; i++) {
+					auto const& edge(edges[i]);
+					if (lvl[edge.src] < lvl[edge.tgt]) up_edges[0][pos[0][edge.src]++] = i;
+					else if (lvl[edge.src] > lvl[edge.tgt]) up_edges[1][pos[1][edge.tgt]++] = i;
+				}
+			}
+
+			std::vector<std::pair<SectionType, uint64_t>> sizes = {
+				{ SectionType::META, meta.size() },
+				{ SectionType::NODES, nodes.size() * sizeof(BinaryNode) },
+				{ SectionType::EDGES, edges.size() * sizeof(BinaryEdge) },
+			};
+			if (is_ch) {
+				sizes.insert(sizes.end(), {
+					{ SectionType::LEVELS, nr_of_nodes * sizeof(uint32_t) },
+					{ SectionType::UP_OUT_OFFSETS, up_offsets[0].size() * sizeof(EdgeID) },
+					{ SectionType::UP_OUT_EDGES, up_edges[0].size() * sizeof(EdgeID) },
+					{ SectionType::UP_IN_OFFSETS, up_offsets[1].size() * sizeof(EdgeID) },
+					{ SectionType::UP_IN_EDGES, up_edges[1].size() * sizeof(EdgeID) },
+				});
+			}
+
+			FileHeader header;
+			std::memset(&header, 0, sizeof(header));
+			header.flags = is_ch ? FLAG_CH : 0;
+			header.nr_of_nodes = nr_of_nodes;
+			header.nr_of_edges = nr_of_edges;
+
+			uint64_t pos(_writeHeader(os, header, sizes));
+			void const* section_data[] = {
+				meta.data(), nodes.data(), edges.data(), data.node_levels.data(),
+				up_offsets[0].data(), up_edges[0].data(), up_offsets[1].data(), up_edges[1].data()
+			};
+			for (uint32_t i(0); i<header.nr_of_sections; i++) {
+				_writeSection(os, pos, header.sections[i], section_data[i]);
+			}
+			Print("Exported all sections.");
+		}
+	}
+}
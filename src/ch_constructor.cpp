@@ -22,7 +22,14 @@ void printHelp()
 		<< "  -g, --outformat <format>   Writes outfile in <format> (" << getAllFileFormatsString() << " - default FMI_CH)\n"
 		<< "  -t, --threads <number>     Number of threads to use in the calculations (default: 1)\n"
 		<< "  -p, --prioritizer <type>   Uses prioritizer <type> for the CH construction. (default: NONE)\n"
-		<< "Note: not all formats are available as input / ouput format, and not all combinations are possible.\n";
+		<< "  -c, --cache                Cache the parsed input graph in <infile>.chc_cache and reuse it while infile is unchanged\n"
+		<< "  -r, --reorder              Renumber the nodes along a Hilbert curve (BFS order without coordinates) for faster contraction;\n"
+		<< "                             the output keeps the node ids of the input\n"
+		<< "  -l, --level-order <path>   Renumber the output nodes by descending level (spatial order within a level) for faster\n"
+		<< "                             queries; writes the input id of each output node to <path>, one per line\n"
+		<< "  -s, --spill <dir>          Keep the edges of contracted nodes in a temp file in <dir> instead of in memory\n"
+		<< "Note: not all formats are available as input / ouput format, and not all combinations are possible.\n"
+		<< "Text files ending in .gz or .zst are read and written compressed.\n";
 }
 
 struct BuildAndStoreCHGraph {
@@ -32,18 +39,33 @@ struct BuildAndStoreCHGraph {
 	TrackTime tt;
 
 	PrioritizerType prioritizer_type;
+	bool reorder;
+	std::string id_map_file;
+	std::string spill_dir;
 
 	template<typename NodeT, typename EdgeT>
 	void operator()(GraphInData<NodeT, CHEdge<EdgeT>>&& data) {
 		tt.track("reading input");
 
-		/* Read graph */
-		CHGraph<NodeT, EdgeT> g;
-		g.init(std::move(data));
+		std::vector<NodeID> original_ids;
+		if (reorder) {
+			original_ids = localityOrder(data.nodes, data.edges, nr_of_threads);
+			renumberNodes(data.nodes, data.edges, inversePermutation(original_ids), nr_of_threads);
+			tt.track("reordering nodes");
+		}
+
+		/* Read graph; contract on slim edges, the payloads are only needed for the export */
+		std::vector<CHEdge<EdgeT>> edges(std::move(data.edges));
+		CHGraph<NodeT, Edge> g;
+		g.setNrOfThreads(nr_of_threads);
+		g.init(GraphInData<NodeT, CHEdge<Edge>>{std::move(data.nodes), slimEdges(edges), std::move(data.meta_data)});
+		if (reorder) g.setOriginalNodeIds(std::move(original_ids));
+		g.setExportByLevel(!id_map_file.empty());
+		if (!spill_dir.empty()) g.spillEdgesDump(spill_dir);
 		tt.track("loading graph");
 
 		/* Build CH */
-		CHConstructor<NodeT, EdgeT> chc(g, nr_of_threads);
+		CHConstructor<NodeT, Edge> chc(g, nr_of_threads);
 		std::vector<NodeID> all_nodes(g.getNrOfNodes());
 		for (NodeID i(0); i<all_nodes.size(); i++) {
 			all_nodes[i] = i;
@@ -60,11 +82,16 @@ struct BuildAndStoreCHGraph {
 
 		tt.track("contracting graph");
 
-		auto exportData = g.exportData();
+		auto exportData = g.exportData(edges);
 		tt.track("rebuliding graph");
 
+		if (!id_map_file.empty()) {
+			writeNodeIds(id_map_file, g.getExportedNodeIds());
+			tt.track("writing node id map");
+		}
+
 		/* Export */
-		writeCHGraphFile(outformat, outfile, std::move(exportData));
+		writeCHGraphFile(outformat, outfile, std::move(exportData), nr_of_threads);
 		tt.track("exporting graph", false);
 
 		tt.summary();
@@ -83,6 +110,10 @@ int main(int argc, char* argv[])
 	FileFormat outformat(FileFormat::FMI_CH);
 	uint nr_of_threads(1);
 	PrioritizerType prioritizer_type(PrioritizerType::NONE);
+	bool use_cache(false);
+	bool reorder(false);
+	std::string id_map_file("");
+	std::string spill_dir("");
 
 	/*
 	 * Getopt argument parsing.
@@ -96,6 +127,10 @@ int main(int argc, char* argv[])
 		{"outformat",   required_argument,  0, 'g'},
 		{"threads",	required_argument,  0, 't'},
 		{"prioritizer",	required_argument,  0, 'p'},
+		{"cache",	no_argument,        0, 'c'},
+		{"reorder",	no_argument,        0, 'r'},
+		{"level-order",	required_argument,  0, 'l'},
+		{"spill",	required_argument,  0, 's'},
 		{0,0,0,0},
 	};
 
@@ -103,7 +138,7 @@ int main(int argc, char* argv[])
 	int iarg(0);
 	opterr = 1;
 
-	while((iarg = getopt_long(argc, argv, "hi:f:o:g:t:p:", longopts, &index)) != -1) {
+	while((iarg = getopt_long(argc, argv, "hi:f:o:g:t:p:crl:s:", longopts, &index)) != -1) {
 		switch (iarg) {
 			case 'h':
 				printHelp();
@@ -134,6 +169,18 @@ int main(int argc, char* argv[])
 			case 'p':
 				prioritizer_type = toPrioritizerType(optarg);
 				break;
+			case 'c':
+				use_cache = true;
+				break;
+			case 'r':
+				reorder = true;
+				break;
+			case 'l':
+				id_map_file = optarg;
+				break;
+			case 's':
+				spill_dir = optarg;
+				break;
 			default:
 				printHelp();
 				return 1;
@@ -150,7 +197,7 @@ int main(int argc, char* argv[])
 	Print("Using " << nr_of_threads << " threads.");
 
 	readGraphForWriteFormat(outformat, informat, infile,
-		BuildAndStoreCHGraph { outformat, outfile, nr_of_threads, VerboseTrackTime(), prioritizer_type });
+		BuildAndStoreCHGraph { outformat, outfile, nr_of_threads, VerboseTrackTime(), prioritizer_type, reorder, id_map_file, spill_dir }, nr_of_threads, use_cache);
 
 	return 0;
 }
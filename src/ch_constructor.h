@@ -5,6 +5,7 @@
 #include "graph.h"
 #include "chgraph.h"
 #include "prioritizer.h"
+#include "labels.h"
 
 #include <chrono>
 #include <queue>
@@ -42,8 +43,7 @@ class CHConstructor{
 
 		struct ThreadData {
 			PQ pq;
-			std::vector<uint> dists;
-			std::vector<uint> reset_dists;
+			StampedLabels<uint> dists;
 		};
 		std::vector<ThreadData> _thread_data;
 
@@ -245,33 +245,22 @@ void CHConstructor<NodeT, EdgeT>::_calcShortestDists(ThreadData& td, NodeID star
 
 	/* clear thread data first */
 	td.pq = PQ();
-	for (auto node_id: td.reset_dists) {
-		td.dists[node_id] = c::NO_DIST;
-	}
-	td.reset_dists.clear();
+	td.dists.reset();
 
 	/* now initialize with start node */
 	td.pq.push(PQElement(start_node, 0));
-	td.dists[start_node] = 0;
-	td.reset_dists.push_back(start_node);
+	td.dists.set(start_node, 0);
 
 	while (!td.pq.empty() && td.pq.top().distance() <= radius) {
 		auto top = td.pq.top();
 		td.pq.pop();
 		if (td.dists[top.node] != top.distance()) continue;
 
-		for (auto const& edge: _base_graph.nodeEdges(top.node, direction)) {
-			NodeID tgt_node(otherNode(edge, direction));
-			uint new_dist(top.distance() + edge.distance());
-
-			if (new_dist < td.dists[tgt_node]) {
-				if (td.dists[tgt_node] == c::NO_DIST) {
-					td.reset_dists.push_back(tgt_node);
-				}
-				td.dists[tgt_node] = new_dist;
-				td.pq.push(PQElement(tgt_node, new_dist));
-			}
-		}
+		auto adjacency(_base_graph.nodeAdjacency(top.node, direction));
+		td.dists.relax(top.distance(), adjacency.nodes, adjacency.dists, adjacency.size,
+			[&td, &adjacency](size_t i, uint new_dist) {
+				td.pq.push(PQElement(adjacency.nodes[i], new_dist));
+			});
 	}
 }
 
@@ -365,7 +354,7 @@ CHConstructor<NodeT, EdgeT>::CHConstructor(CHGraphT& base_graph, uint num_thread
 		_num_threads = 1;
 	}
 
-	uint nr_of_nodes(_base_graph.getNrOfNodes());
+	NodeID nr_of_nodes(_base_graph.getNrOfNodes());
 
 	_thread_data.resize(_num_threads);
 	_edge_diffs.resize(nr_of_nodes);
@@ -373,7 +362,6 @@ CHConstructor<NodeT, EdgeT>::CHConstructor(CHGraphT& base_graph, uint num_thread
 
 	for (auto& td: _thread_data) {
 		td.dists.assign(nr_of_nodes, c::NO_DIST);
-		td.reset_dists.reserve(nr_of_nodes);
 	}
 	_new_shortcuts.reserve(_base_graph.getNrOfEdges());
 	_remove.reserve(nr_of_nodes);
@@ -402,9 +390,9 @@ void CHConstructor<NodeT, EdgeT>::quickContract(std::vector<NodeID>& nodes, uint
 		if (independent_set.empty()) break;
 
 		Debug("Quick-contracting all the nodes in the independent set.");
-		uint size(independent_set.size());
+		NodeID size(independent_set.size());
 		#pragma omp parallel for num_threads(_num_threads) schedule(dynamic)
-		for (uint i = 0; i < size; i++) {
+		for (NodeID i = 0; i < size; i++) {
 			uint node(independent_set[i]);
 			_quickContract(node);
 		}
@@ -448,9 +436,9 @@ void CHConstructor<NodeT, EdgeT>::contract(std::vector<NodeID>& nodes)
 		Print("The independent set has size " << independent_set.size() << ".");
 
 		Debug("Contracting all the nodes in the independent set.");
-		uint size(independent_set.size());
+		NodeID size(independent_set.size());
 		#pragma omp parallel for num_threads(_num_threads) schedule(dynamic)
-		for (uint i = 0; i < size; i++) {
+		for (NodeID i = 0; i < size; i++) {
 			uint node(independent_set[i]);
 			_contract(node);
 		}
@@ -494,9 +482,9 @@ void CHConstructor<NodeT, EdgeT>::contract(std::vector<NodeID>& nodes, Prioritiz
 		Print("There are " << next_nodes.size() << " nodes to be contracted in this round.");
 
 		Debug("Contracting all the nodes in the independent set.");
-		uint size(next_nodes.size());
+		NodeID size(next_nodes.size());
 		#pragma omp parallel for num_threads(_num_threads) schedule(dynamic)
-		for (uint i = 0; i < size; i++) {
+		for (NodeID i = 0; i < size; i++) {
 			uint node(next_nodes[i]);
 			_contract(node);
 		}
@@ -559,9 +547,9 @@ std::vector<int> CHConstructor<NodeT, EdgeT>::calcEdgeDiffs(std::vector<NodeID>
 	std::vector<int> edge_diffs(nodes.size());
 	auto shortcuts(getShortcutsOfContracting(nodes));
 
-	uint size(nodes.size());
+	NodeID size(nodes.size());
 	#pragma omp parallel for num_threads(_num_threads) schedule(dynamic)
-	for (uint i = 0; i<size; i++) {
+	for (NodeID i = 0; i<size; i++) {
 		edge_diffs[i] = shortcuts[i].size() - (int) _base_graph.getNrOfEdges(nodes[i]);
 	}
 
@@ -572,6 +560,7 @@ template <typename NodeT, typename EdgeT>
 auto CHConstructor<NodeT, EdgeT>::getShortcutsOfContracting(NodeID node) const -> std::vector<Shortcut>
 {
 	ThreadData td;
+	td.dists.assign(_base_graph.getNrOfNodes(), c::NO_DIST);
 	return _contract(node, td);
 }
 
@@ -587,13 +576,12 @@ auto CHConstructor<NodeT, EdgeT>::getShortcutsOfContracting(std::vector<NodeID>
 	auto nr_of_nodes(_base_graph.getNrOfNodes());
 	for (auto& td: thread_data) {
 		td.dists.assign(nr_of_nodes, c::NO_DIST);
-		td.reset_dists.reserve(nr_of_nodes);
 	}
 
 	/* calc shortcuts */
-	uint size(nodes.size());
+	NodeID size(nodes.size());
 	#pragma omp parallel for num_threads(_num_threads) schedule(dynamic)
-	for (uint i = 0; i < size; i++) {
+	for (NodeID i = 0; i < size; i++) {
 		uint node(nodes[i]);
 
 		auto& td(thread_data[omp_get_thread_num()]);
@@ -626,9 +614,9 @@ auto CHConstructor<NodeT, EdgeT>::getShortcutsOfQuickContracting(std::vector<Nod
 	std::vector<std::vector<Shortcut>> shortcuts(nodes.size());
 
 	/* calc shortcuts */
-	uint size(nodes.size());
+	NodeID size(nodes.size());
 	#pragma omp parallel for num_threads(_num_threads) schedule(dynamic)
-	for (uint i = 0; i < size; i++) {
+	for (NodeID i = 0; i < size; i++) {
 		shortcuts[i] = getShortcutsOfQuickContracting(nodes[i]);
 	}
 
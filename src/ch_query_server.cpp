@@ -0,0 +1,195 @@
+#include "defs.h"
+#include "ch_constructor.h"
+#include "file_formats.h"
+#include "mapped_chgraph.h"
+#include "compressed_chgraph.h"
+#include "query_server.h"
+#include "track_time.h"
+
+#include <getopt.h>
+#include <memory>
+
+using namespace chc;
+
+void printHelp()
+{
+	std::cerr
+		<< "Usage: ./ch_query_server [ARGUMENTS]\n"
+		<< "Mandatory arguments are:\n"
+		<< "  -i, --infile <path>        Read graph from <path>\n"
+		<< "Optional arguments are:\n"
+		<< "  -f, --informat <format>    Expects infile in <format> (" << getAllFileFormatsString() << " - default FMI)\n"
+		<< "                             FMI_CH, FMI_EUCL_CH, STEFAN_CH and binary CH files are used as they are, other graphs are contracted first;\n"
+		<< "                             binary CH files are memory mapped and used without loading them;\n"
+		<< "                             text files ending in .gz or .zst are decompressed while reading\n"
+		<< "  -t, --threads <number>     Number of worker threads (default: 1)\n"
+		<< "  -s, --socket <path>        Serve clients on the UNIX domain socket <path> (default: stdin/stdout)\n"
+		<< "  -b, --batch <number>       Maximum number of requests answered in one batch (default: 1024)\n"
+		<< "  -z, --compress             Answer queries on a compressed copy of the CH (only upward edges, varint encoded);\n"
+		<< "                             uses a fraction of the memory, queries get slightly slower\n"
+		<< "  -v, --verify               Check all node and edge ids of a mapped binary CH file before using it;\n"
+		<< "                             reads the whole file instead of only the pages queries touch\n"
+		<< "Requests (one per line):\n"
+		<< "  d <src> <tgt>              distance from src to tgt (-1 if there is no path)\n"
+		<< "  p <src> <tgt>              distance and nodes of the shortest path\n"
+		<< "  s                          number of requests and p50/p99 latency in microseconds\n";
+}
+
+template<typename NodeT, typename EdgeT, typename GraphT>
+void serveQueries(GraphT const& g, uint nr_of_threads, size_t max_batch, std::string const& socket_path, TrackTime& tt)
+{
+	CHQueryServer<NodeT, EdgeT, GraphT> server(g, nr_of_threads, max_batch);
+	if (socket_path.empty()) {
+		server.serve(STDIN_FILENO, STDOUT_FILENO);
+	}
+	else {
+		std::cerr << "Listening on " << socket_path << "\n";
+		server.serveUnixSocket(socket_path);
+	}
+	tt.track("serving queries");
+
+	auto const& latency(server.getLatencyStats());
+	std::cerr << "Answered " << latency.count() << " requests, latency p50 "
+		<< latency.percentile(0.5) << " us, p99 " << latency.percentile(0.99) << " us\n";
+}
+
+int main(int argc, char* argv[])
+{
+	/*
+	 * Containers for arguments.
+	 */
+
+	std::string infile("");
+	FileFormat informat(FileFormat::FMI);
+	uint nr_of_threads(1);
+	std::string socket_path("");
+	size_t max_batch(1024);
+	bool compress(false);
+	bool verify(false);
+
+	/*
+	 * Getopt argument parsing.
+	 */
+
+	const struct option longopts[] = {
+		{"help",	no_argument,        0, 'h'},
+		{"infile",	required_argument,  0, 'i'},
+		{"informat",	required_argument,  0, 'f'},
+		{"threads",	required_argument,  0, 't'},
+		{"socket",	required_argument,  0, 's'},
+		{"batch",	required_argument,  0, 'b'},
+		{"compress",	no_argument,        0, 'z'},
+		{"verify",	no_argument,        0, 'v'},
+		{0,0,0,0},
+	};
+
+	int index(0);
+	int iarg(0);
+	opterr = 1;
+
+	while((iarg = getopt_long(argc, argv, "hi:f:t:s:b:zv", longopts, &index)) != -1) {
+		switch (iarg) {
+			case 'h':
+				printHelp();
+				return 0;
+				break;
+			case 'i':
+				infile = optarg;
+				break;
+			case 'f':
+				informat = toFileFormat(optarg);
+				break;
+			case 't':
+				{
+					size_t idx = 0; // index of first "non digit"
+					nr_of_threads = std::stoi(optarg, &idx);
+					if ('\0' != optarg[idx] || nr_of_threads <= 0) {
+						std::cerr << "Invalid thread count: '" << optarg << "'\n";
+						return 1;
+					}
+				}
+				break;
+			case 's':
+				socket_path = optarg;
+				break;
+			case 'b':
+				{
+					size_t idx = 0; // index of first "non digit"
+					max_batch = std::stoi(optarg, &idx);
+					if ('\0' != optarg[idx] || max_batch <= 0) {
+						std::cerr << "Invalid batch size: '" << optarg << "'\n";
+						return 1;
+					}
+				}
+				break;
+			case 'z':
+				compress = true;
+				break;
+			case 'v':
+				verify = true;
+				break;
+			default:
+				printHelp();
+				return 1;
+				break;
+		}
+	}
+
+	if (infile == "") {
+		std::cerr << "No input file specified! Exiting.\n";
+		std::cerr << "Use ./ch_query_server --help to print the usage.\n";
+		return 1;
+	}
+
+	/* stdout might carry the protocol: send all logging to stderr */
+	std::cout.rdbuf(std::cerr.rdbuf());
+
+	TrackTime tt(std::cerr);
+
+	std::unique_ptr<CompressedCHGraph> compressed_g;
+	if (informat == FileFormat::BINARY && isCHFile(informat, infile)) {
+		/* Use the mapped CH in place */
+		MappedCHGraph g(infile, verify);
+		tt.track("mapping CH");
+		if (!compress) {
+			serveQueries<OSMNode, OSMEdge>(g, nr_of_threads, max_batch, socket_path, tt);
+			return 0;
+		}
+		compressed_g.reset(new CompressedCHGraph(g));
+	}
+	else {
+		CHGraph<OSMNode, OSMEdge> g;
+		g.setNrOfThreads(nr_of_threads);
+		if (isCHFile(informat, infile)) {
+			/* Read the CH */
+			g.init(readCHGraph<OSMNode, CHEdge<OSMEdge>>(informat, infile, nr_of_threads));
+			tt.track("reading CH");
+		}
+		else {
+			/* Read graph and build CH */
+			g.init(readGraph<OSMNode, CHEdge<OSMEdge>>(informat, infile, nr_of_threads));
+
+			CHConstructor<OSMNode, OSMEdge> chc(g, nr_of_threads);
+			std::vector<NodeID> all_nodes(g.getNrOfNodes());
+			for (NodeID i(0); i<all_nodes.size(); i++) {
+				all_nodes[i] = i;
+			}
+			chc.quickContract(all_nodes, 4, 5);
+			chc.contract(all_nodes);
+			chc.rebuildCompleteGraph();
+			tt.track("building CH");
+		}
+		if (!compress) {
+			serveQueries<OSMNode, OSMEdge>(g, nr_of_threads, max_batch, socket_path, tt);
+			return 0;
+		}
+		compressed_g.reset(new CompressedCHGraph(g));
+	}
+
+	/* the uncompressed CH is freed at this point */
+	tt.track("compressing CH");
+	std::cerr << "Compressed CH: " << compressed_g->getNrOfBytes() << " bytes\n";
+	serveQueries<OSMNode, OSMEdge>(*compressed_g, nr_of_threads, max_batch, socket_path, tt);
+
+	return 0;
+}
@@ -2,9 +2,12 @@
 
 #include "graph.h"
 #include "nodes_and_edges.h"
+#include "node_order.h"
+#include "edge_spill.h"
 
 #include <vector>
 #include <algorithm>
+#include <memory>
 
 namespace chc
 {
@@ -19,17 +22,56 @@ class CHGraph : public Graph<NodeT, CHEdge<EdgeT> >
 		using BaseGraph::_in_edges;
 		using BaseGraph::_id_to_index;
 		using BaseGraph::edge_count;
+		using BaseGraph::_num_threads;
 		using typename BaseGraph::OutEdgeSort;
 
 		std::vector<uint> _node_levels;
 
 		std::vector<Shortcut> _edges_dump;
+		/* see spillEdgesDump() */
+		std::unique_ptr<EdgeSpill<Shortcut>> _dump_spill;
+		size_t _spill_run_size = 0;
 
 		uint _next_lvl = 0;
 
+		/* ids of the nodes in the input, if they were renumbered (see setOriginalNodeIds()) */
+		std::vector<NodeID> _original_ids;
+		/* see setExportByLevel() */
+		bool _export_by_level = false;
+		std::vector<NodeID> _exported_ids;
+
 		void _addNewEdge(Shortcut& new_edge,
 				std::vector<Shortcut>& new_edge_vec);
+
+		/* all edges of _edges_dump and _dump_spill; sorted by OutEdgeSort if something was spilled */
+		std::vector<Shortcut> _takeDump();
+		/* all edges, in no particular order; destroys internal data structures */
+		std::vector<Shortcut> _takeEdges();
+		/*
+		 * Positions of edges in the order of the output, i.e. sorted by
+		 * OutEdgeSort (and id); new_ids is set to the new id per old id.
+		 */
+		std::vector<EdgeID> _exportOrder(std::vector<Shortcut> const& edges, std::vector<EdgeID>& new_ids) const;
+		/* renumbers nodes, levels and edges to the ids of the export; returns new_ids[old id] (empty if unchanged) */
+		std::vector<NodeID> _renumberForExport(std::vector<Shortcut>& edges);
+
+		/* what exportData(edges) needs of a slim edge to build the full one, indexed by the new id */
+		struct ExportRecipe
+		{
+			/* index of an original edge in the full edges; NO_EID for shortcuts */
+			EdgeID original;
+			/* new ids of the children of a shortcut */
+			EdgeID child_edge1;
+			EdgeID child_edge2;
+		};
 	public:
+		/*
+		 * The witness searches relax the adjacency arrays in both
+		 * directions. That costs 16 bytes per live edge while contracting,
+		 * but makes the contraction about a quarter faster.
+		 */
+		CHGraph() { BaseGraph::_with_in_adjacency = true; }
+
 		template <typename Data>
 		void init(Data&& data)
 		{
@@ -37,6 +79,30 @@ class CHGraph : public Graph<NodeT, CHEdge<EdgeT> >
 			BaseGraph::init(std::forward<Data>(data));
 		}
 
+		/* init from an already contracted graph (e.g. read from a CH file) */
+		void init(GraphCHInData<NodeT, Shortcut>&& data);
+
+		/*
+		 * The nodes were renumbered (e.g. by localityOrder()) before init:
+		 * original_ids[id] is the id of the node in the input. exportData()
+		 * maps the nodes back to these ids.
+		 */
+		void setOriginalNodeIds(std::vector<NodeID> original_ids);
+		/*
+		 * exportData() renumbers the nodes by levelOrder() instead of
+		 * keeping the ids of the input; getExportedNodeIds() maps them back.
+		 */
+		void setExportByLevel(bool by_level) { _export_by_level = by_level; }
+		/* after exportData(): the id in the input of each exported node */
+		std::vector<NodeID> const& getExportedNodeIds() const { return _exported_ids; }
+
+		/*
+		 * The edges of contracted nodes are written to a temp file in
+		 * directory, in sorted runs of run_size edges, instead of being kept
+		 * in memory until rebuildCompleteGraph() / exportData() merge them
+		 * back.
+		 */
+		void spillEdgesDump(std::string const& directory, size_t run_size = size_t(1) << 20);
 
 		void restructure(std::vector<NodeID> const& removed,
 				std::vector<bool> const& to_remove,
@@ -44,11 +110,34 @@ class CHGraph : public Graph<NodeT, CHEdge<EdgeT> >
 		void rebuildCompleteGraph();
 
 		bool isUp(Shortcut const& edge, EdgeType direction) const;
+		uint getNodeLevel(NodeID node_id) const { return _node_levels[node_id]; }
 
 		/* destroys internal data structures */
 		GraphCHOutData<NodeT, Shortcut> exportData();
+		/*
+		 * For graphs contracted on slim edges (see slimEdges()): edges holds
+		 * the original full edges, indexed by the ids the graph was initialized
+		 * with. They are replaced by the exported edges, where shortcuts get
+		 * the concatenated payload of their children.
+		 */
+		template <typename FullEdgeT>
+		GraphCHOutData<NodeT, CHEdge<FullEdgeT>> exportData(std::vector<CHEdge<FullEdgeT>>& edges);
 };
 
+template <typename NodeT, typename EdgeT>
+void CHGraph<NodeT, EdgeT>::init(GraphCHInData<NodeT, Shortcut>&& data)
+{
+	assert(data.node_levels.size() == data.nodes.size());
+	_node_levels.swap(data.node_levels);
+
+	_next_lvl = 0;
+	for (auto lvl: _node_levels) {
+		if (lvl != c::NO_LVL) _next_lvl = std::max(_next_lvl, lvl + 1);
+	}
+
+	BaseGraph::init(GraphInData<NodeT, Shortcut>{std::move(data.nodes), std::move(data.edges), std::move(data.meta_data)});
+}
+
 template <typename NodeT, typename EdgeT>
 void CHGraph<NodeT, EdgeT>::restructure(
 		std::vector<NodeID> const& removed,
@@ -74,7 +163,7 @@ void CHGraph<NodeT, EdgeT>::restructure(
 	std::vector<Shortcut> new_edge_vec;
 	new_edge_vec.reserve(_out_edges.size() + new_shortcuts.size());
 
-	std::sort(new_shortcuts.begin(), new_shortcuts.end(), outEdgeSort);
+	radixSort(new_shortcuts, outEdgeSort, _num_threads);
 
 	/* Manually merge the new_shortcuts and _out_edges vector. */
 	size_t j(0);
@@ -118,9 +207,14 @@ void CHGraph<NodeT, EdgeT>::restructure(
 	_out_edges.swap(new_edge_vec);
 	debug_assert(std::is_sorted(_out_edges.begin(), _out_edges.end(), outEdgeSort));
 
-	_in_edges.assign(_out_edges.begin(), _out_edges.end());
-	BaseGraph::sortInEdges();
 	BaseGraph::initOffsets();
+	BaseGraph::initInEdges();
+	BaseGraph::initAdjacency();
+
+	if (_dump_spill && _edges_dump.size() >= _spill_run_size) {
+		_dump_spill->appendRun(_edges_dump, _num_threads);
+		_edges_dump.clear();
+	}
 }
 
 template <typename NodeT, typename EdgeT>
@@ -150,6 +244,11 @@ void CHGraph<NodeT, EdgeT>::_addNewEdge(Shortcut& new_edge,
 	}
 
 	if (c::NO_EID == new_edge.id) {
+		if (edge_count == c::NO_EID) {
+			std::cerr << "FATAL_ERROR: More than " << c::NO_EID << " edges including shortcuts"
+				<< " (see CHC_EDGE_ID_BITS). Exiting." << std::endl;
+			std::abort();
+		}
 		new_edge.id = edge_count++;
 	}
 	new_edge_vec.push_back(new_edge);
@@ -160,9 +259,8 @@ void CHGraph<NodeT, EdgeT>::rebuildCompleteGraph()
 {
 	assert(_out_edges.empty() && _in_edges.empty());
 
-	_out_edges.swap(_edges_dump);
-	_in_edges = _out_edges;
-	_edges_dump.clear();
+	/* spilled edges come back sorted, so update() doesn't have to sort them again */
+	_out_edges = _takeDump();
 
 	BaseGraph::update();
 }
@@ -186,47 +284,233 @@ bool CHGraph<NodeT, EdgeT>::isUp(Shortcut const& edge, EdgeType direction) const
 }
 
 template <typename NodeT, typename EdgeT>
-auto CHGraph<NodeT, EdgeT>::exportData() -> GraphCHOutData<NodeT, Shortcut>
+void CHGraph<NodeT, EdgeT>::spillEdgesDump(std::string const& directory, size_t run_size)
 {
-	BaseGraph::_is_dirty = true;
+	_dump_spill.reset(new EdgeSpill<Shortcut>(directory));
+	_spill_run_size = run_size;
+}
 
-	std::vector<Shortcut>* edges_source;
+template <typename NodeT, typename EdgeT>
+auto CHGraph<NodeT, EdgeT>::_takeDump() -> std::vector<Shortcut>
+{
 	std::vector<Shortcut> edges;
+	if (!_dump_spill || _dump_spill->getNrOfEdges() == 0) {
+		edges.swap(_edges_dump);
+	}
+	else {
+		_dump_spill->appendRun(_edges_dump, _num_threads);
+		_edges_dump = decltype(_edges_dump)();
+		edges = _dump_spill->merge();
+	}
+	return edges;
+}
 
-	_id_to_index = decltype(_id_to_index)();
+template <typename NodeT, typename EdgeT>
+auto CHGraph<NodeT, EdgeT>::_takeEdges() -> std::vector<Shortcut>
+{
+	BaseGraph::_is_dirty = true;
 
+	std::vector<Shortcut> edges;
 	if (_out_edges.empty() && _in_edges.empty()) {
-		edges_source = &_edges_dump;
+		edges = _takeDump();
 	}
 	else {
-		assert(_edges_dump.empty());
-		edges_source = &_out_edges;
-		_in_edges = decltype(_in_edges)();
+		assert(_edges_dump.empty() && (!_dump_spill || _dump_spill->getNrOfEdges() == 0));
+		edges.swap(_out_edges);
+	}
+
+	_id_to_index = decltype(_id_to_index)();
+	_in_edges = decltype(_in_edges)();
+	_out_edges = decltype(_out_edges)();
+	_edges_dump = decltype(_edges_dump)();
+	for (uint i(0); i<2; i++) {
+		BaseGraph::_adjacent_nodes[i] = std::vector<NodeID>();
+		BaseGraph::_adjacent_dists[i] = std::vector<uint>();
+	}
+
+	return edges;
+}
+
+template <typename NodeT, typename EdgeT>
+std::vector<EdgeID> CHGraph<NodeT, EdgeT>::_exportOrder(std::vector<Shortcut> const& edges, std::vector<EdgeID>& new_ids) const
+{
+	/* only an index per edge instead of (key, index) pairs: the edges are
+	 * distributed by src (like in Graph::initInEdges()), then sorted by tgt per node */
+	NodeID nr_of_nodes(BaseGraph::_nodes.size());
+	std::vector<EdgeID> offsets(nr_of_nodes + 1, 0);
+	for (auto const& edge: edges) {
+		offsets[edge.src + 1]++;
+	}
+	for (NodeID i(0); i<nr_of_nodes; i++) {
+		offsets[i + 1] += offsets[i];
+	}
+
+	std::vector<EdgeID> order(edges.size());
+	{
+		std::vector<EdgeID> next(offsets.begin(), offsets.end() - 1);
+		for (EdgeID i(0), size(edges.size()); i<size; i++) {
+			order[next[edges[i].src]++] = i;
+		}
+	}
+
+	#pragma omp parallel for num_threads(_num_threads) schedule(dynamic, 1024)
+	for (NodeID node = 0; node < nr_of_nodes; node++) {
+		std::sort(order.begin() + offsets[node], order.begin() + offsets[node + 1], [&edges](EdgeID a, EdgeID b) {
+			return edges[a].tgt < edges[b].tgt || (edges[a].tgt == edges[b].tgt && edges[a].id < edges[b].id);
+		});
+	}
+
+	/* the ids are a permutation of [0, edges.size()) */
+	new_ids.resize(edges.size());
+	#pragma omp parallel for num_threads(_num_threads) schedule(static)
+	for (size_t i = 0; i < order.size(); i++) {
+		new_ids[edges[order[i]].id] = i;
 	}
+	return order;
+}
+
+template <typename NodeT, typename EdgeT>
+void CHGraph<NodeT, EdgeT>::setOriginalNodeIds(std::vector<NodeID> original_ids)
+{
+	assert(original_ids.size() == BaseGraph::_nodes.size());
+	_original_ids = std::move(original_ids);
+}
 
-	edges.resize(edges_source->size());
-	for (auto const& edge: *edges_source) {
-		edges[edge.id] = edge;
+template <typename NodeT, typename EdgeT>
+std::vector<NodeID> CHGraph<NodeT, EdgeT>::_renumberForExport(std::vector<Shortcut>& edges)
+{
+	std::vector<NodeID> new_ids;
+	if (_export_by_level) {
+		auto order(levelOrder(BaseGraph::_nodes, _node_levels, _num_threads));
+		new_ids = inversePermutation(order);
+
+		/* order has the current ids, which may differ from the input */
+		if (!_original_ids.empty()) {
+			for (auto& id: order) {
+				id = _original_ids[id];
+			}
+		}
+		_exported_ids = std::move(order);
 	}
+	else {
+		new_ids.swap(_original_ids);
+	}
+	_original_ids = decltype(_original_ids)();
 
-	/* Sort edges for output and adapt id's */
-	std::sort(edges.begin(), edges.end(), EdgeSortSrcTgt<EdgeT>());
-	std::vector<size_t> new_id(edges.size());
-	for (uint i(0); i<edges.size(); i++) {
-		new_id[edges[i].id] = i;
+	if (!new_ids.empty()) {
+		renumberNodes(BaseGraph::_nodes, edges, new_ids, _num_threads);
+		permute(_node_levels, new_ids);
 	}
-	for (uint i(0); i<edges.size(); i++) {
+	return new_ids;
+}
+
+template <typename NodeT, typename EdgeT>
+auto CHGraph<NodeT, EdgeT>::exportData() -> GraphCHOutData<NodeT, Shortcut>
+{
+	auto edges(_takeEdges());
+	_renumberForExport(edges);
+
+	std::vector<EdgeID> new_ids;
+	_exportOrder(edges, new_ids);
+
+	#pragma omp parallel for num_threads(_num_threads) schedule(static)
+	for (size_t i = 0; i < edges.size(); i++) {
 		Shortcut& edge(edges[i]);
-		edge.id = new_id[i];
-		edge.child_edge1 = (edge.child_edge1 != c::NO_EID ? new_id[edge.child_edge1] : c::NO_EID);
-		edge.child_edge2 = (edge.child_edge2 != c::NO_EID ? new_id[edge.child_edge2] : c::NO_EID);
+		edge.id = new_ids[edge.id];
+		if (edge.center_node == c::NO_NID) continue;
+		edge.child_edge1 = new_ids[edge.child_edge1];
+		edge.child_edge2 = new_ids[edge.child_edge2];
 	}
+	new_ids = decltype(new_ids)();
 
+	sortById(edges);
 	_out_edges = std::move(edges);
 
-	_edges_dump = decltype(_edges_dump)();
-
 	return GraphCHOutData<NodeT, Shortcut>{BaseGraph::_nodes, _node_levels, _out_edges, BaseGraph::_meta_data};
 }
 
+template <typename NodeT, typename EdgeT>
+template <typename FullEdgeT>
+auto CHGraph<NodeT, EdgeT>::exportData(std::vector<CHEdge<FullEdgeT>>& edges) -> GraphCHOutData<NodeT, CHEdge<FullEdgeT>>
+{
+	/* the slim edges are replaced by the (smaller) recipes before the full edges are allocated */
+	std::vector<ExportRecipe> recipes;
+	std::vector<NodeID> new_node_ids;
+	{
+		auto slim_edges(_takeEdges());
+		new_node_ids = _renumberForExport(slim_edges);
+
+		std::vector<EdgeID> new_ids;
+		auto order(_exportOrder(slim_edges, new_ids));
+		recipes.resize(slim_edges.size());
+		#pragma omp parallel for num_threads(_num_threads) schedule(static)
+		for (size_t i = 0; i < order.size(); i++) {
+			Shortcut const& slim_edge(slim_edges[order[i]]);
+			if (slim_edge.center_node == c::NO_NID) {
+				recipes[i] = ExportRecipe { slim_edge.id, c::NO_EID, c::NO_EID };
+			}
+			else {
+				recipes[i] = ExportRecipe { c::NO_EID, new_ids[slim_edge.child_edge1], new_ids[slim_edge.child_edge2] };
+			}
+		}
+	}
+
+	/* original edges first, then the shortcuts, whose children have to be done before them */
+	std::vector<CHEdge<FullEdgeT>> full_edges(recipes.size());
+	std::vector<bool> done(recipes.size(), false);
+	#pragma omp parallel for num_threads(_num_threads) schedule(static)
+	for (size_t i = 0; i < recipes.size(); i++) {
+		if (recipes[i].original == c::NO_EID) continue;
+		auto& full_edge(full_edges[i]);
+		full_edge = static_cast<FullEdgeT const&>(edges[recipes[i].original]);
+		full_edge.id = i;
+		if (!new_node_ids.empty()) {
+			full_edge.src = new_node_ids[full_edge.src];
+			full_edge.tgt = new_node_ids[full_edge.tgt];
+		}
+	}
+	for (size_t i(0); i<recipes.size(); i++) {
+		done[i] = (recipes[i].original != c::NO_EID);
+	}
+	edges = std::vector<CHEdge<FullEdgeT>>();
+
+	std::vector<EdgeID> stack;
+	for (EdgeID id(0); id<recipes.size(); id++) {
+		stack.push_back(id);
+		while (!stack.empty()) {
+			EdgeID top(stack.back());
+			ExportRecipe const& recipe(recipes[top]);
+			if (done[top]) {
+				stack.pop_back();
+			}
+			else if (!done[recipe.child_edge1] || !done[recipe.child_edge2]) {
+				if (!done[recipe.child_edge1]) stack.push_back(recipe.child_edge1);
+				if (!done[recipe.child_edge2]) stack.push_back(recipe.child_edge2);
+			}
+			else {
+				full_edges[top] = make_shortcut(full_edges[recipe.child_edge1], full_edges[recipe.child_edge2]);
+				full_edges[top].id = top;
+				done[top] = true;
+				stack.pop_back();
+			}
+		}
+	}
+	recipes = decltype(recipes)();
+	edges.swap(full_edges);
+	debug_assert(std::is_sorted(edges.begin(), edges.end(), EdgeSortSrcTgt<CHEdge<FullEdgeT>>()));
+
+	return GraphCHOutData<NodeT, CHEdge<FullEdgeT>>{BaseGraph::_nodes, _node_levels, edges, BaseGraph::_meta_data};
+}
+
+/* topology and distance of edges, with the position in edges as id */
+template <typename EdgeT>
+std::vector<CHEdge<Edge>> slimEdges(std::vector<EdgeT> const& edges)
+{
+	std::vector<CHEdge<Edge>> slim_edges(edges.size());
+	for (EdgeID i(0); i<edges.size(); i++) {
+		slim_edges[i] = CHEdge<Edge>(Edge(i, edges[i].src, edges[i].tgt, edges[i].distance()));
+	}
+	return slim_edges;
+}
+
 }
@@ -0,0 +1,291 @@
+#pragma once
+
+#include "defs.h"
+#include "nodes_and_edges.h"
+#include "indexed_container.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace chc
+{
+
+namespace unit_tests
+{
+	void testCompressedCHGraph();
+}
+
+/*
+ * Read-only CH for queries with a compressed adjacency: only the upward
+ * edges are kept (every edge once, at its lower node), as varints in one
+ * byte array, and decoded while CHDijkstra iterates over them.
+ *
+ * Record of a node, starting at _byte_offsets[node]:
+ *   varint  number of upward out edges
+ *   varint  size of the out edges in bytes (to skip them for in edges)
+ *   out edges, then in edges, both sorted by their other node; per edge
+ *     varint  zigzag(other node - previous other node), starting at node
+ *     varint  distance
+ *     varint  center node + 1 (0 for original edges)
+ * The edges of a node have consecutive ids, starting at _edge_offsets[node].
+ *
+ * Child edges of shortcuts are not stored: they are the edges between the
+ * center node and src / tgt, and are looked up by getEdge().
+ *
+ * Offers the parts of the CHGraph interface used by queries (CHDijkstra,
+ * CHQueryServer), but nodeEdges() only returns the upward edges of a node.
+ */
+class CompressedCHGraph
+{
+	public:
+		struct CompressedEdge
+		{
+			EdgeID id = c::NO_EID;
+			NodeID src = c::NO_NID;
+			NodeID tgt = c::NO_NID;
+			uint dist = c::NO_DIST;
+			NodeID center_node = c::NO_NID;
+			/* only set by getEdge() */
+			EdgeID child_edge1 = c::NO_EID;
+			EdgeID child_edge2 = c::NO_EID;
+
+			uint distance() const { return dist; }
+		};
+
+		class edge_iterator : public std::iterator<std::forward_iterator_tag, CompressedEdge const>
+		{
+			private:
+				uint8_t const* _pos;
+				NodeID _node;
+				EdgeType _type;
+				EdgeID _end;
+				NodeID _other;
+				CompressedEdge _edge;
+
+				void _decode();
+			public:
+				edge_iterator(uint8_t const* pos, NodeID node, EdgeType type, EdgeID id, EdgeID end);
+
+				CompressedEdge const& operator*() const { return _edge; }
+				CompressedEdge const* operator->() const { return &_edge; }
+				edge_iterator& operator++() { ++_edge.id; _decode(); return *this; }
+				edge_iterator operator++(int) { edge_iterator it(*this); ++*this; return it; }
+				bool operator==(edge_iterator const& rhs) const { return _edge.id == rhs._edge.id; }
+				bool operator!=(edge_iterator const& rhs) const { return _edge.id != rhs._edge.id; }
+				std::ptrdiff_t operator-(edge_iterator const& rhs) const { return _edge.id - rhs._edge.id; }
+		};
+		typedef range<edge_iterator> node_edges_range;
+
+	private:
+		std::vector<uint8_t> _data;
+		std::vector<uint64_t> _byte_offsets;
+		std::vector<EdgeID> _edge_offsets;
+
+		struct UpEdge
+		{
+			NodeID other;
+			uint dist;
+			NodeID center_node;
+
+			bool operator<(UpEdge const& rhs) const { return other < rhs.other; }
+		};
+
+		static void _writeEdges(std::vector<uint8_t>& out, NodeID node, std::vector<UpEdge> const& edges);
+		static void _writeVarint(std::vector<uint8_t>& out, uint64_t value);
+		static uint64_t _readVarint(uint8_t const*& pos);
+
+		/* the edge from/to other in the up edges of node in direction type with distance dist */
+		EdgeID _findEdge(NodeID node, EdgeType type, NodeID other, uint dist) const;
+	public:
+		/* g has to be a complete CH, e.g. CHGraph or MappedCHGraph */
+		template <typename GraphT>
+		explicit CompressedCHGraph(GraphT const& g);
+
+		NodeID getNrOfNodes() const { return _edge_offsets.size() - 1; }
+		EdgeID getNrOfEdges() const { return _edge_offsets.back(); }
+		/* number of upward edges */
+		uint getNrOfEdges(NodeID node_id, EdgeType type) const;
+		/* size of the compressed graph */
+		size_t getNrOfBytes() const;
+
+		CompressedEdge getEdge(EdgeID edge_id) const;
+
+		/* all edges of nodeEdges() are upward */
+		bool isUp(CompressedEdge const& edge, EdgeType direction) const { return true; }
+
+		/* upward edges of node_id in direction type */
+		node_edges_range nodeEdges(NodeID node_id, EdgeType type) const;
+
+		friend void unit_tests::testCompressedCHGraph();
+};
+
+/*
+ * CompressedCHGraph::edge_iterator member functions.
+ */
+
+inline CompressedCHGraph::edge_iterator::edge_iterator(uint8_t const* pos, NodeID node, EdgeType type, EdgeID id, EdgeID end)
+	: _pos(pos), _node(node), _type(type), _end(end), _other(node)
+{
+	_edge.id = id;
+	_decode();
+}
+
+inline void CompressedCHGraph::edge_iterator::_decode()
+{
+	if (_edge.id == _end) return;
+
+	uint64_t delta(_readVarint(_pos));
+	_other += (delta & 1) ? ~NodeID(delta >> 1) : NodeID(delta >> 1);
+	_edge.dist = _readVarint(_pos);
+	_edge.center_node = NodeID(_readVarint(_pos)) - 1;
+
+	_edge.src = (_type == EdgeType::OUT ? _node : _other);
+	_edge.tgt = (_type == EdgeType::OUT ? _other : _node);
+}
+
+/*
+ * CompressedCHGraph member functions.
+ */
+
+template <typename GraphT>
+CompressedCHGraph::CompressedCHGraph(GraphT const& g)
+{
+	NodeID nr_of_nodes(g.getNrOfNodes());
+	_byte_offsets.reserve(nr_of_nodes + 1);
+	_edge_offsets.reserve(nr_of_nodes + 1);
+	_edge_offsets.push_back(0);
+
+	std::vector<UpEdge> up_edges[2];
+	std::vector<uint8_t> out_data;
+	for (NodeID node(0); node<nr_of_nodes; node++) {
+		for (auto type: {EdgeType::OUT, EdgeType::IN}) {
+			auto& edges(up_edges[from_enum(type)]);
+			edges.clear();
+			for (auto const& edge: g.nodeEdges(node, type)) {
+				if (!g.isUp(edge, type)) continue;
+				edges.push_back(UpEdge { otherNode(edge, type), edge.distance(), edge.center_node });
+			}
+			std::sort(edges.begin(), edges.end());
+		}
+
+		out_data.clear();
+		_writeEdges(out_data, node, up_edges[0]);
+
+		_byte_offsets.push_back(_data.size());
+		_writeVarint(_data, up_edges[0].size());
+		_writeVarint(_data, out_data.size());
+		_data.insert(_data.end(), out_data.begin(), out_data.end());
+		_writeEdges(_data, node, up_edges[1]);
+		_edge_offsets.push_back(_edge_offsets.back() + up_edges[0].size() + up_edges[1].size());
+	}
+	_byte_offsets.push_back(_data.size());
+	_data.shrink_to_fit();
+
+	Print("Compressed " << getNrOfEdges() << " upward edges of " << nr_of_nodes << " nodes into " << getNrOfBytes() << " bytes.");
+}
+
+inline void CompressedCHGraph::_writeEdges(std::vector<uint8_t>& out, NodeID node, std::vector<UpEdge> const& edges)
+{
+	NodeID prev(node);
+	for (auto const& edge: edges) {
+		/* zigzag, as other nodes may be smaller than node */
+		NodeID delta(edge.other - prev);
+		_writeVarint(out, edge.other >= prev ? uint64_t(delta) << 1 : (uint64_t(NodeID(~delta)) << 1) | 1);
+		_writeVarint(out, edge.dist);
+		_writeVarint(out, uint64_t(edge.center_node) + 1);
+		prev = edge.other;
+	}
+}
+
+inline void CompressedCHGraph::_writeVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+	while (value >= 0x80) {
+		out.push_back(uint8_t(value) | 0x80);
+		value >>= 7;
+	}
+	out.push_back(uint8_t(value));
+}
+
+inline uint64_t CompressedCHGraph::_readVarint(uint8_t const*& pos)
+{
+	uint64_t value(*pos & 0x7f);
+	for (uint shift(7); *pos++ & 0x80; shift += 7) {
+		value |= uint64_t(*pos & 0x7f) << shift;
+	}
+	return value;
+}
+
+inline uint CompressedCHGraph::getNrOfEdges(NodeID node_id, EdgeType type) const
+{
+	uint8_t const* pos(_data.data() + _byte_offsets[node_id]);
+	uint nr_of_out_edges(_readVarint(pos));
+	if (type == EdgeType::OUT) return nr_of_out_edges;
+	return _edge_offsets[node_id + 1] - _edge_offsets[node_id] - nr_of_out_edges;
+}
+
+inline size_t CompressedCHGraph::getNrOfBytes() const
+{
+	return _data.size() * sizeof(uint8_t) + _byte_offsets.size() * sizeof(uint64_t)
+		+ _edge_offsets.size() * sizeof(EdgeID);
+}
+
+inline auto CompressedCHGraph::nodeEdges(NodeID node_id, EdgeType type) const -> node_edges_range
+{
+	uint8_t const* pos(_data.data() + _byte_offsets[node_id]);
+	EdgeID first(_edge_offsets[node_id]);
+	EdgeID nr_of_out_edges(_readVarint(pos));
+	uint64_t out_bytes(_readVarint(pos));
+
+	if (type == EdgeType::OUT) {
+		return node_edges_range(edge_iterator(pos, node_id, type, first, first + nr_of_out_edges),
+			edge_iterator(nullptr, node_id, type, first + nr_of_out_edges, first + nr_of_out_edges));
+	}
+	EdgeID last(_edge_offsets[node_id + 1]);
+	return node_edges_range(edge_iterator(pos + out_bytes, node_id, type, first + nr_of_out_edges, last),
+		edge_iterator(nullptr, node_id, type, last, last));
+}
+
+inline EdgeID CompressedCHGraph::_findEdge(NodeID node, EdgeType type, NodeID other, uint dist) const
+{
+	for (auto const& edge: nodeEdges(node, type)) {
+		if (otherNode(edge, type) == other && edge.distance() == dist) return edge.id;
+	}
+	return c::NO_EID;
+}
+
+inline auto CompressedCHGraph::getEdge(EdgeID edge_id) const -> CompressedEdge
+{
+	debug_assert(edge_id < getNrOfEdges());
+
+	/* the node storing the edge */
+	NodeID node(std::upper_bound(_edge_offsets.begin(), _edge_offsets.end(), edge_id) - _edge_offsets.begin() - 1);
+	EdgeType type(edge_id - _edge_offsets[node] < getNrOfEdges(node, EdgeType::OUT) ? EdgeType::OUT : EdgeType::IN);
+
+	CompressedEdge result;
+	for (auto const& edge: nodeEdges(node, type)) {
+		if (edge.id == edge_id) {
+			result = edge;
+			break;
+		}
+	}
+
+	/* the children of a shortcut are up edges of its center node */
+	if (result.center_node != c::NO_NID) {
+		for (auto const& child1: nodeEdges(result.center_node, EdgeType::IN)) {
+			if (child1.src != result.src || child1.dist > result.dist) continue;
+			EdgeID child2(_findEdge(result.center_node, EdgeType::OUT, result.tgt, result.dist - child1.dist));
+			if (child2 != c::NO_EID) {
+				result.child_edge1 = child1.id;
+				result.child_edge2 = child2;
+				break;
+			}
+		}
+		assert(result.child_edge1 != c::NO_EID);
+	}
+
+	return result;
+}
+
+}
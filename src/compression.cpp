@@ -0,0 +1,431 @@
+#include "compression.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#ifdef CHC_HAVE_ZLIB
+# include <zlib.h>
+#endif
+#ifdef CHC_HAVE_ZSTD
+# include <zstd.h>
+#endif
+
+namespace chc
+{
+
+namespace
+{
+	size_t const IO_CHUNK = 1 << 18;
+
+	bool endsWith(std::string const& s, std::string const& suffix)
+	{
+		return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	std::FILE* openFile(std::string const& filename, char const* mode)
+	{
+		std::FILE* file(std::fopen(filename.c_str(), mode));
+		if (!file) {
+			std::cerr << "FATAL_ERROR: Couldn't open graph file \'" <<
+				filename << "\'. Exiting." << std::endl;
+			std::abort();
+		}
+		return file;
+	}
+}
+
+Compression compressionOf(std::string const& filename)
+{
+	if (endsWith(filename, ".gz")) return Compression::GZIP;
+	if (endsWith(filename, ".zst")) return Compression::ZSTD;
+	return Compression::NONE;
+}
+
+void checkCompressionSupport(Compression compression, std::string const& filename)
+{
+	bool supported(true);
+	switch (compression) {
+	case Compression::NONE:
+		break;
+	case Compression::GZIP:
+#ifndef CHC_HAVE_ZLIB
+		supported = false;
+#endif
+		break;
+	case Compression::ZSTD:
+#ifndef CHC_HAVE_ZSTD
+		supported = false;
+#endif
+		break;
+	}
+
+	if (!supported) {
+		std::cerr << "FATAL_ERROR: \'" << filename << "\' is compressed, but support for its "
+			"compression wasn't available at build time. Exiting." << std::endl;
+		std::abort();
+	}
+}
+
+
+DecompressingReader::DecompressingReader(std::string const& filename, Compression compression)
+	: _filename(filename), _compression(compression)
+{
+	checkCompressionSupport(compression, filename);
+	_file = openFile(filename, "rb");
+	_thread = std::thread(&DecompressingReader::_run, this);
+}
+
+DecompressingReader::~DecompressingReader()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopped = true;
+	}
+	_not_full.notify_one();
+	_thread.join();
+	std::fclose(_file);
+}
+
+bool DecompressingReader::next(std::string& block)
+{
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_not_empty.wait(lock, [this]() { return _finished || !_queue.empty(); });
+		if (_queue.empty()) return false;
+
+		block = std::move(_queue.front());
+		_queue.pop_front();
+	}
+	_not_full.notify_one();
+	return true;
+}
+
+void DecompressingReader::_fail(std::string const& reason) const
+{
+	std::cerr << "FATAL_ERROR: Couldn't decompress graph file \'" << _filename
+		<< "\': " << reason << ". Exiting." << std::endl;
+	std::abort();
+}
+
+bool DecompressingReader::_emit(std::string& pending, bool last)
+{
+	if (pending.empty() || (!last && pending.size() < BLOCK_SIZE)) return true;
+
+	std::string block;
+	if (last) {
+		block = std::move(pending);
+		pending.clear();
+	}
+	else {
+		/* keep the incomplete last line for the next block */
+		auto newline(pending.rfind('\n'));
+		if (newline == std::string::npos) return true;
+		block.assign(pending, 0, newline + 1);
+		pending.erase(0, newline + 1);
+	}
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_not_full.wait(lock, [this]() { return _stopped || _queue.size() < MAX_QUEUED; });
+	if (_stopped) return false;
+	_queue.push_back(std::move(block));
+	_not_empty.notify_one();
+	return true;
+}
+
+void DecompressingReader::_run()
+{
+	switch (_compression) {
+	case Compression::NONE:
+		break;
+	case Compression::GZIP:
+		_runGzip();
+		break;
+	case Compression::ZSTD:
+		_runZstd();
+		break;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_finished = true;
+	}
+	_not_empty.notify_one();
+}
+
+void DecompressingReader::_runGzip()
+{
+#ifdef CHC_HAVE_ZLIB
+	z_stream z;
+	std::memset(&z, 0, sizeof(z));
+	/* automatic gzip / zlib header detection */
+	if (inflateInit2(&z, 15 + 32) != Z_OK) _fail("inflateInit2() failed");
+
+	std::vector<char> in(IO_CHUNK);
+	std::string pending;
+	bool in_stream(false);
+	bool output_full(false);
+	for (;;) {
+		if (z.avail_in == 0 && !output_full) {
+			size_t len(std::fread(in.data(), 1, in.size(), _file));
+			if (len == 0) break;
+			z.next_in = reinterpret_cast<Bytef*>(in.data());
+			z.avail_in = len;
+		}
+
+		size_t old_size(pending.size());
+		pending.resize(old_size + IO_CHUNK);
+		z.next_out = reinterpret_cast<Bytef*>(&pending[old_size]);
+		z.avail_out = IO_CHUNK;
+		uInt const avail_in(z.avail_in);
+		int ret(inflate(&z, Z_NO_FLUSH));
+		output_full = (z.avail_out == 0);
+		pending.resize(old_size + IO_CHUNK - z.avail_out);
+		/* a member is only started once its input is consumed */
+		if (z.avail_in != avail_in) in_stream = true;
+
+		if (ret == Z_STREAM_END) {
+			/* concatenated gzip members; the finished one has no output left */
+			in_stream = false;
+			output_full = false;
+			inflateReset(&z);
+		}
+		else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+			_fail(z.msg ? z.msg : "corrupt data");
+		}
+
+		if (!_emit(pending, false)) {
+			inflateEnd(&z);
+			return;
+		}
+	}
+	inflateEnd(&z);
+
+	if (std::ferror(_file)) _fail(std::strerror(errno));
+	if (in_stream) _fail("unexpected end of file");
+	_emit(pending, true);
+#endif
+}
+
+void DecompressingReader::_runZstd()
+{
+#ifdef CHC_HAVE_ZSTD
+	ZSTD_DStream* ds(ZSTD_createDStream());
+	if (!ds) _fail("ZSTD_createDStream() failed");
+	ZSTD_initDStream(ds);
+
+	std::vector<char> in(IO_CHUNK);
+	std::string pending;
+	size_t last_ret(0);
+	size_t len;
+	while ((len = std::fread(in.data(), 1, in.size(), _file)) > 0) {
+		ZSTD_inBuffer input { in.data(), len, 0 };
+		bool output_full(false);
+		while (input.pos < input.size || output_full) {
+			size_t old_size(pending.size());
+			pending.resize(old_size + IO_CHUNK);
+			ZSTD_outBuffer output { &pending[old_size], IO_CHUNK, 0 };
+			last_ret = ZSTD_decompressStream(ds, &output, &input);
+			if (ZSTD_isError(last_ret)) _fail(ZSTD_getErrorName(last_ret));
+			/* 0: the frame is complete and flushed, even if the output is full */
+			output_full = (last_ret != 0 && output.pos == output.size);
+			pending.resize(old_size + output.pos);
+
+			if (!_emit(pending, false)) {
+				ZSTD_freeDStream(ds);
+				return;
+			}
+		}
+	}
+	ZSTD_freeDStream(ds);
+
+	if (std::ferror(_file)) _fail(std::strerror(errno));
+	if (last_ret != 0) _fail("unexpected end of file");
+	_emit(pending, true);
+#endif
+}
+
+
+struct CompressingBuffer::State
+{
+#ifdef CHC_HAVE_ZLIB
+	z_stream z;
+#endif
+#ifdef CHC_HAVE_ZSTD
+	ZSTD_CCtx* zstd = nullptr;
+#endif
+};
+
+CompressingBuffer::CompressingBuffer(std::string const& filename, Compression compression, int level)
+	: _filename(filename), _compression(compression), _state(new State())
+{
+	checkCompressionSupport(compression, filename);
+	_file = openFile(filename, "wb");
+
+	switch (_compression) {
+	case Compression::NONE:
+		break;
+	case Compression::GZIP:
+#ifdef CHC_HAVE_ZLIB
+		std::memset(&_state->z, 0, sizeof(_state->z));
+		if (deflateInit2(&_state->z, level < 0 ? Z_DEFAULT_COMPRESSION : level,
+				Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+			_fail("deflateInit2() failed");
+		}
+#endif
+		break;
+	case Compression::ZSTD:
+#ifdef CHC_HAVE_ZSTD
+		_state->zstd = ZSTD_createCCtx();
+		if (!_state->zstd) _fail("ZSTD_createCCtx() failed");
+		ZSTD_CCtx_setParameter(_state->zstd, ZSTD_c_compressionLevel, level < 0 ? ZSTD_CLEVEL_DEFAULT : level);
+#endif
+		break;
+	}
+
+	_in.resize(IO_CHUNK);
+	_out.resize(IO_CHUNK);
+	setp(&_in[0], &_in[0] + _in.size());
+}
+
+CompressingBuffer::~CompressingBuffer()
+{
+	close();
+#ifdef CHC_HAVE_ZLIB
+	if (_compression == Compression::GZIP) deflateEnd(&_state->z);
+#endif
+#ifdef CHC_HAVE_ZSTD
+	if (_state->zstd) ZSTD_freeCCtx(_state->zstd);
+#endif
+}
+
+void CompressingBuffer::_fail(std::string const& reason) const
+{
+	std::cerr << "FATAL_ERROR: Couldn't write compressed graph file \'" << _filename
+		<< "\': " << reason << ". Exiting." << std::endl;
+	std::abort();
+}
+
+void CompressingBuffer::_compress(char const* data, size_t size, bool finish)
+{
+	auto writeOut = [this](size_t len) {
+		if (len && std::fwrite(_out.data(), 1, len, _file) != len) _fail(std::strerror(errno));
+	};
+
+	switch (_compression) {
+	case Compression::NONE:
+		break;
+	case Compression::GZIP: {
+#ifdef CHC_HAVE_ZLIB
+		z_stream& z(_state->z);
+		z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+		z.avail_in = size;
+		int ret;
+		do {
+			z.next_out = reinterpret_cast<Bytef*>(&_out[0]);
+			z.avail_out = _out.size();
+			ret = deflate(&z, finish ? Z_FINISH : Z_NO_FLUSH);
+			if (ret == Z_STREAM_ERROR) _fail("deflate() failed");
+			writeOut(_out.size() - z.avail_out);
+		} while (z.avail_out == 0 || (finish && ret != Z_STREAM_END));
+#endif
+		break;
+	}
+	case Compression::ZSTD: {
+#ifdef CHC_HAVE_ZSTD
+		ZSTD_inBuffer input { data, size, 0 };
+		bool done;
+		do {
+			ZSTD_outBuffer output { &_out[0], _out.size(), 0 };
+			size_t remaining(ZSTD_compressStream2(_state->zstd, &output, &input, finish ? ZSTD_e_end : ZSTD_e_continue));
+			if (ZSTD_isError(remaining)) _fail(ZSTD_getErrorName(remaining));
+			writeOut(output.pos);
+			done = finish ? (remaining == 0) : (input.pos == input.size);
+		} while (!done);
+#endif
+		break;
+	}
+	}
+}
+
+auto CompressingBuffer::overflow(int_type c) -> int_type
+{
+	if (_closed) return traits_type::eof();
+
+	_compress(pbase(), pptr() - pbase(), false);
+	setp(&_in[0], &_in[0] + _in.size());
+	if (!traits_type::eq_int_type(c, traits_type::eof())) {
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+	}
+	return traits_type::not_eof(c);
+}
+
+std::streamsize CompressingBuffer::xsputn(char const* s, std::streamsize n)
+{
+	if (_closed) return 0;
+
+	if (n <= epptr() - pptr()) {
+		std::memcpy(pptr(), s, n);
+		pbump(n);
+		return n;
+	}
+
+	/* large writes bypass the buffer */
+	_compress(pbase(), pptr() - pbase(), false);
+	setp(&_in[0], &_in[0] + _in.size());
+	_compress(s, n, false);
+	return n;
+}
+
+int CompressingBuffer::sync()
+{
+	if (_closed) return 0;
+
+	_compress(pbase(), pptr() - pbase(), false);
+	setp(&_in[0], &_in[0] + _in.size());
+	return 0;
+}
+
+void CompressingBuffer::close()
+{
+	if (_closed) return;
+
+	_compress(pbase(), pptr() - pbase(), true);
+	setp(nullptr, nullptr);
+	_closed = true;
+
+	if (std::fclose(_file) != 0) _fail(std::strerror(errno));
+}
+
+
+std::unique_ptr<std::ostream> openGraphOutputFile(std::string const& filename)
+{
+	Compression compression(compressionOf(filename));
+	if (compression != Compression::NONE) {
+		return std::unique_ptr<std::ostream>(new CompressingOStream(filename, compression));
+	}
+
+	std::unique_ptr<std::ofstream> os(new std::ofstream(filename.c_str(), std::ios::binary));
+	if (!os->is_open()) {
+		std::cerr << "FATAL_ERROR: Couldn't open graph file \'" <<
+			filename << "\'. Exiting." << std::endl;
+		std::abort();
+	}
+	return std::unique_ptr<std::ostream>(os.release());
+}
+
+void closeGraphOutputFile(std::ostream& os)
+{
+	if (auto compressed = dynamic_cast<CompressingOStream*>(&os)) {
+		compressed->close();
+	}
+	else if (auto file = dynamic_cast<std::ofstream*>(&os)) {
+		file->close();
+	}
+}
+
+}
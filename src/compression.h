@@ -0,0 +1,131 @@
+#pragma once
+
+#include "defs.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+namespace chc
+{
+
+namespace unit_tests
+{
+	void testCompression();
+}
+
+/*
+ * Transparent compression of graph files, chosen by the file name:
+ * ".gz" (zlib, needs CHC_HAVE_ZLIB) and ".zst" (needs CHC_HAVE_ZSTD).
+ */
+enum class Compression { NONE, GZIP, ZSTD };
+
+Compression compressionOf(std::string const& filename);
+/* aborts if the library for the compression wasn't available at build time */
+void checkCompressionSupport(Compression compression, std::string const& filename);
+
+/*
+ * Decompresses a file on its own thread. The output is handed out in
+ * blocks which end after a newline (except for the last one), so text
+ * records never span two blocks; at most a few blocks are queued.
+ */
+class DecompressingReader
+{
+	private:
+		std::string const _filename;
+		Compression const _compression;
+		std::FILE* _file;
+
+		std::deque<std::string> _queue;
+		bool _finished = false;
+		bool _stopped = false;
+		std::mutex _mutex;
+		std::condition_variable _not_empty;
+		std::condition_variable _not_full;
+
+		std::thread _thread;
+
+		void _run();
+		void _runGzip();
+		void _runZstd();
+		/* appends decompressed data; emits complete lines; returns false when stopped */
+		bool _emit(std::string& pending, bool last);
+		void _fail(std::string const& reason) const;
+
+		DecompressingReader(DecompressingReader const&) = delete;
+		DecompressingReader& operator=(DecompressingReader const&) = delete;
+	public:
+		static constexpr size_t BLOCK_SIZE = 1 << 20;
+		static constexpr size_t MAX_QUEUED = 4;
+
+		DecompressingReader(std::string const& filename, Compression compression);
+		~DecompressingReader();
+
+		/* next block; false at the end of the file */
+		bool next(std::string& block);
+};
+
+/*
+ * streambuf compressing everything written to it into a file; the
+ * compression runs on the thread writing to the stream (e.g. the thread
+ * of an AsyncWriter).
+ */
+class CompressingBuffer : public std::streambuf
+{
+	private:
+		std::string const _filename;
+		Compression const _compression;
+		std::FILE* _file;
+
+		/* opaque zlib / zstd stream state */
+		struct State;
+		std::unique_ptr<State> _state;
+
+		std::string _in;
+		std::string _out;
+		bool _closed = false;
+
+		void _compress(char const* data, size_t size, bool finish);
+		void _fail(std::string const& reason) const;
+
+		CompressingBuffer(CompressingBuffer const&) = delete;
+		CompressingBuffer& operator=(CompressingBuffer const&) = delete;
+	protected:
+		int_type overflow(int_type c) override;
+		std::streamsize xsputn(char const* s, std::streamsize n) override;
+		int sync() override;
+	public:
+		CompressingBuffer(std::string const& filename, Compression compression, int level);
+		~CompressingBuffer();
+
+		/* flushes the compressor and closes the file */
+		void close();
+};
+
+/* ostream writing a compressed file */
+class CompressingOStream : public std::ostream
+{
+	private:
+		CompressingBuffer _buffer;
+	public:
+		CompressingOStream(std::string const& filename, Compression compression, int level = -1)
+			: std::ostream(nullptr), _buffer(filename, compression, level)
+		{
+			rdbuf(&_buffer);
+		}
+
+		void close() { flush(); _buffer.close(); }
+};
+
+/* opens a graph file for writing, compressed if the file name asks for it; aborts on failure */
+std::unique_ptr<std::ostream> openGraphOutputFile(std::string const& filename);
+/* closes a stream from openGraphOutputFile(), finishing the compression */
+void closeGraphOutputFile(std::ostream& os);
+
+}
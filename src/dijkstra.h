@@ -3,10 +3,11 @@
 #include "graph.h"
 #include "chgraph.h"
 #include "enum_array.h"
+#include "priority_queues.h"
+#include "labels.h"
 
 #include <vector>
 #include <limits>
-#include <queue>
 
 namespace chc
 {
@@ -17,22 +18,25 @@ namespace unit_tests
 	void testDijkstra();
 }
 
-template <typename Node, typename Edge>
+/*
+ * PQImpl selects the priority queue (see priority_queues.h); RadixHeap is
+ * usually the fastest choice for the integer distances used here.
+ */
+template <typename Node, typename Edge, template <typename> class PQImpl = BinaryHeap>
 class Dijkstra
 {
 	private:
 		struct PQElement;
-		typedef std::priority_queue<
-				PQElement, std::vector<PQElement>, std::greater<PQElement> > PQ;
+		typedef PQImpl<PQElement> PQ;
 
 		Graph<Node, Edge> const& _g;
+		PQ _pq;
 
 		std::vector<EdgeID> _found_by;
-		std::vector<uint> _dists;
-		std::vector<NodeID> _reset_dists;
+		StampedLabels<uint> _dists;
 
 		void _reset();
-		void _relaxAllEdges(PQ& pq, PQElement const& top);
+		void _relaxAllEdges(PQElement const& top);
 	public:
 		Dijkstra(Graph<Node, Edge> const& g);
 
@@ -48,8 +52,8 @@ class Dijkstra
 				std::vector<EdgeID>& path);
 };
 
-template <typename Node, typename Edge>
-struct Dijkstra<Node, Edge>::PQElement
+template <typename Node, typename Edge, template <typename> class PQImpl>
+struct Dijkstra<Node, Edge, PQImpl>::PQElement
 {
 	NodeID node;
 	EdgeID found_by;
@@ -67,102 +71,94 @@ struct Dijkstra<Node, Edge>::PQElement
 	uint distance() const { return _dist; }
 };
 
-template <typename Node, typename Edge>
-Dijkstra<Node,Edge>::Dijkstra(Graph<Node, Edge> const& g)
+template <typename Node, typename Edge, template <typename> class PQImpl>
+Dijkstra<Node, Edge, PQImpl>::Dijkstra(Graph<Node, Edge> const& g)
 	: _g(g), _found_by(g.getNrOfNodes()),
 	_dists(g.getNrOfNodes(), c::NO_DIST) {}
 
-template <typename Node, typename Edge>
-uint Dijkstra<Node,Edge>::calcShopa(NodeID src, NodeID tgt,
+template <typename Node, typename Edge, template <typename> class PQImpl>
+uint Dijkstra<Node, Edge, PQImpl>::calcShopa(NodeID src, NodeID tgt,
 		std::vector<EdgeID>& path)
 {
 	_reset();
 	path.clear();
 
-	PQ pq;
-	pq.push(PQElement(src, c::NO_EID, 0));
-	_dists[src] = 0;
-	_reset_dists.push_back(src);
+	_pq.push(PQElement(src, c::NO_EID, 0));
+	_dists.set(src, 0);
 
 	// Dijkstra loop
-	while (!pq.empty() && pq.top().node != tgt) {
-		PQElement top(pq.top());
-		pq.pop();
+	while (!_pq.empty() && _pq.top().node != tgt) {
+		PQElement top(_pq.top());
+		_pq.pop();
 
 		if (_dists[top.node] == top.distance()) {
 			_found_by[top.node] = top.found_by;
-			_relaxAllEdges(pq, top);
+			_relaxAllEdges(top);
 		}
 	}
 
-	if (pq.empty()) {
+	if (_pq.empty()) {
 		Print("No path found from " << src << " to " << tgt << ".");
 		return c::NO_DIST;
 	}
 
 	// Path backtracking.
 	NodeID bt_node(tgt);
-	_found_by[tgt] = pq.top().found_by;
+	_found_by[tgt] = _pq.top().found_by;
 	while (bt_node != src) {
 		EdgeID edge_id = _found_by[bt_node];
 		bt_node = _g.getEdge(edge_id).src;
 		path.push_back(edge_id);
 	}
 
-	return pq.top().distance();
+	return _pq.top().distance();
 }
 
-template <typename Node, typename Edge>
-void Dijkstra<Node,Edge>::_relaxAllEdges(PQ& pq, PQElement const& top)
+template <typename Node, typename Edge, template <typename> class PQImpl>
+void Dijkstra<Node, Edge, PQImpl>::_relaxAllEdges(PQElement const& top)
 {
-	for (auto const& edge: _g.nodeEdges(top.node, EdgeType::OUT)) {
-		NodeID tgt(edge.tgt);
-		uint new_dist(top.distance() + edge.distance());
-
-		if (new_dist < _dists[tgt]) {
-			if (_dists[tgt] == c::NO_DIST) {
-				_reset_dists.push_back(tgt);
-			}
-			_dists[tgt] = new_dist;
-
-			pq.push(PQElement(tgt, edge.id, new_dist));
-		}
-	}
+	auto adjacency(_g.nodeAdjacency(top.node, EdgeType::OUT));
+	_dists.relax(top.distance(), adjacency.nodes, adjacency.dists, adjacency.size,
+		[this, &adjacency](size_t i, uint new_dist) {
+			_pq.push(PQElement(adjacency.nodes[i], adjacency.edge(i).id, new_dist));
+		});
 }
 
-template <typename Node, typename Edge>
-void Dijkstra<Node,Edge>::_reset()
+template <typename Node, typename Edge, template <typename> class PQImpl>
+void Dijkstra<Node, Edge, PQImpl>::_reset()
 {
-	for (auto const node: _reset_dists) {
-		_dists[node] = c::NO_DIST;
-	}
-	_reset_dists.clear();
+	_dists.reset();
+	_pq.clear();
 }
 
-template <typename Node, typename Edge>
+/*
+ * GraphT may be any CH with the query interface of CHGraph, e.g. a
+ * MappedCHGraph or CompressedCHGraph; the CH has to be complete (see CHGraph::rebuildCompleteGraph).
+ */
+template <typename Node, typename Edge, template <typename> class PQImpl = BinaryHeap,
+	typename GraphT = CHGraph<Node, Edge> >
 class CHDijkstra
 {
 	private:
 		struct PQElement;
-		typedef std::priority_queue<
-			PQElement, std::vector<PQElement>, std::greater<PQElement> > PQ;
+		typedef PQImpl<PQElement> PQ;
 
-		CHGraph<Node, Edge> const& _g;
+		GraphT const& _g;
+		PQ _pq;
 
 		/*
 		 * data stored per direction
 		 */
 		struct direction_info {
 			std::vector<EdgeID> _found_by;
-			std::vector<uint> _dists;
-			std::vector<NodeID> _reset_dists;
+			StampedLabels<uint> _dists;
 		};
 		enum_array<direction_info, EdgeType, 2> _dir;
 
 		void _reset();
-		void _relaxAllEdges(PQ& pq, PQElement const& top);
+		void _relaxAllEdges(PQElement const& top);
 	public:
-		CHDijkstra(CHGraph<Node, Edge> const& g);
+		CHDijkstra(GraphT const& g);
 
 		/**
 		 * @brief Computes the shortest path between src and tgt.
@@ -176,8 +172,8 @@ class CHDijkstra
 				std::vector<EdgeID>& path);
 };
 
-template <typename Node, typename Edge>
-struct CHDijkstra<Node, Edge>::PQElement
+template <typename Node, typename Edge, template <typename> class PQImpl, typename GraphT>
+struct CHDijkstra<Node, Edge, PQImpl, GraphT>::PQElement
 {
 	NodeID node;
 	EdgeID found_by;
@@ -196,40 +192,37 @@ struct CHDijkstra<Node, Edge>::PQElement
 	uint distance() const { return _dist; }
 };
 
-template <typename Node, typename Edge>
-CHDijkstra<Node,Edge>::CHDijkstra(CHGraph<Node, Edge> const& g)
+template <typename Node, typename Edge, template <typename> class PQImpl, typename GraphT>
+CHDijkstra<Node, Edge, PQImpl, GraphT>::CHDijkstra(GraphT const& g)
 : _g(g) {
 	for(auto& dir_info: _dir) {
-		dir_info._dists.resize(g.getNrOfNodes(), c::NO_DIST);
+		dir_info._dists.assign(g.getNrOfNodes(), c::NO_DIST);
 		dir_info._found_by.resize(g.getNrOfNodes());
 	}
 }
 
-template <typename Node, typename Edge>
-uint CHDijkstra<Node,Edge>::calcShopa(NodeID src, NodeID tgt,
+template <typename Node, typename Edge, template <typename> class PQImpl, typename GraphT>
+uint CHDijkstra<Node, Edge, PQImpl, GraphT>::calcShopa(NodeID src, NodeID tgt,
 		std::vector<EdgeID>& path)
 {
 	_reset();
 	path.clear();
 
-	PQ pq;
-	pq.push(PQElement(src, c::NO_EID, EdgeType::OUT, 0));
-	pq.push(PQElement(tgt, c::NO_EID, EdgeType::IN, 0));
-	_dir[EdgeType::OUT]._dists[src] = 0;
-	_dir[EdgeType::OUT]._reset_dists.push_back(src);
-	_dir[EdgeType::IN]._dists[tgt] = 0;
-	_dir[EdgeType::IN]._reset_dists.push_back(tgt);
+	_pq.push(PQElement(src, c::NO_EID, EdgeType::OUT, 0));
+	_pq.push(PQElement(tgt, c::NO_EID, EdgeType::IN, 0));
+	_dir[EdgeType::OUT]._dists.set(src, 0);
+	_dir[EdgeType::IN]._dists.set(tgt, 0);
 
 	// Dijkstra loop
 	uint shortest_dist(c::NO_DIST);
 	NodeID center_node(c::NO_NID);;
-	while (!pq.empty() && pq.top().distance() <= shortest_dist) {
-		PQElement top(pq.top());
-		pq.pop();
+	while (!_pq.empty() && _pq.top().distance() <= shortest_dist) {
+		PQElement top(_pq.top());
+		_pq.pop();
 
 		if (_dir[top.direction]._dists[top.node] == top.distance()) {
 			_dir[top.direction]._found_by[top.node] = top.found_by;
-			_relaxAllEdges(pq, top);
+			_relaxAllEdges(top);
 
 			uint rest_dist = _dir[!top.direction]._dists[top.node];
 			if (rest_dist != c::NO_DIST
@@ -267,8 +260,8 @@ uint CHDijkstra<Node,Edge>::calcShopa(NodeID src, NodeID tgt,
 	return shortest_dist;
 }
 
-template <typename Node, typename Edge>
-void CHDijkstra<Node,Edge>::_relaxAllEdges(PQ& pq, PQElement const& top)
+template <typename Node, typename Edge, template <typename> class PQImpl, typename GraphT>
+void CHDijkstra<Node, Edge, PQImpl, GraphT>::_relaxAllEdges(PQElement const& top)
 {
 	EdgeType dir(top.direction);
 	// TODO When edges are sorted accordingly: loop while
@@ -279,26 +272,21 @@ void CHDijkstra<Node,Edge>::_relaxAllEdges(PQ& pq, PQElement const& top)
 			uint new_dist(top.distance() + edge.distance());
 
 			if (new_dist < _dir[dir]._dists[other_node]) {
-				if (_dir[dir]._dists[other_node] == c::NO_DIST) {
-					_dir[dir]._reset_dists.push_back(other_node);
-				}
-				_dir[dir]._dists[other_node] = new_dist;
+				_dir[dir]._dists.set(other_node, new_dist);
 
-				pq.push(PQElement(other_node, edge.id, dir, new_dist));
+				_pq.push(PQElement(other_node, edge.id, dir, new_dist));
 			}
 		}
 	}
 }
 
-template <typename Node, typename Edge>
-void CHDijkstra<Node,Edge>::_reset()
+template <typename Node, typename Edge, template <typename> class PQImpl, typename GraphT>
+void CHDijkstra<Node, Edge, PQImpl, GraphT>::_reset()
 {
 	for (auto& dir: _dir) {
-		for (auto const node: dir._reset_dists) {
-			dir._dists[node] = c::NO_DIST;
-		}
-		dir._reset_dists.clear();
+		dir._dists.reset();
 	}
+	_pq.clear();
 }
 
 }
@@ -0,0 +1,69 @@
+#include "edge_spill.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <unistd.h>
+
+namespace chc
+{
+
+SpillFile::SpillFile(std::string const& directory) : _directory(directory)
+{
+	std::string path(directory + "/chc_spill_XXXXXX");
+	_fd = mkstemp(&path[0]);
+	if (_fd < 0) _fail(std::strerror(errno));
+	unlink(path.c_str());
+}
+
+SpillFile::~SpillFile()
+{
+	if (_fd >= 0) close(_fd);
+}
+
+void SpillFile::_fail(std::string const& reason) const
+{
+	std::cerr << "FATAL_ERROR: Temp file in \'" << _directory << "\' failed: " << reason << ". Exiting." << std::endl;
+	std::abort();
+}
+
+void SpillFile::append(void const* data, size_t size)
+{
+	char const* pos(static_cast<char const*>(data));
+	while (size > 0) {
+		ssize_t written(pwrite(_fd, pos, size, _size));
+		if (written < 0) {
+			if (errno == EINTR) continue;
+			_fail(std::strerror(errno));
+		}
+		pos += written;
+		size -= written;
+		_size += written;
+	}
+}
+
+void SpillFile::read(uint64_t offset, void* data, size_t size) const
+{
+	char* pos(static_cast<char*>(data));
+	while (size > 0) {
+		ssize_t nr_read(pread(_fd, pos, size, offset));
+		if (nr_read < 0) {
+			if (errno == EINTR) continue;
+			_fail(std::strerror(errno));
+		}
+		if (nr_read == 0) _fail("unexpected end of file");
+		pos += nr_read;
+		size -= nr_read;
+		offset += nr_read;
+	}
+}
+
+void SpillFile::clear()
+{
+	if (ftruncate(_fd, 0) < 0) _fail(std::strerror(errno));
+	_size = 0;
+}
+
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "defs.h"
+#include "nodes_and_edges.h"
+#include "radix_sort.h"
+
+#include <algorithm>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace chc
+{
+
+namespace unit_tests
+{
+	void testEdgeSpill();
+}
+
+/*
+ * Unnamed temp file which is only appended to and read at offsets; it is
+ * unlinked right after creation, so it disappears with the process.
+ * Failing I/O is fatal.
+ */
+class SpillFile
+{
+	private:
+		int _fd = -1;
+		std::string _directory;
+		uint64_t _size = 0;
+
+		void _fail(std::string const& reason) const;
+
+		SpillFile(SpillFile const&) = delete;
+		SpillFile& operator=(SpillFile const&) = delete;
+	public:
+		explicit SpillFile(std::string const& directory);
+		~SpillFile();
+
+		uint64_t size() const { return _size; }
+
+		void append(void const* data, size_t size);
+		void read(uint64_t offset, void* data, size_t size) const;
+		/* drops the content */
+		void clear();
+};
+
+/*
+ * Edges which are not needed for a while (e.g. the edges of contracted
+ * nodes in CHGraph), stored in a SpillFile as runs sorted by (src, tgt).
+ * merge() reads them back through one small buffer per run and merges
+ * them into one vector; like a stable sort of all appended edges, equal
+ * edges keep the order in which they were appended.
+ */
+template <typename EdgeT>
+class EdgeSpill
+{
+	private:
+		static_assert(std::is_trivially_copyable<EdgeT>::value, "EdgeSpill stores edges as raw bytes");
+
+		SpillFile _file;
+		/* first edge of each run, and the end of the last one */
+		std::vector<uint64_t> _run_offsets;
+
+		/* edges read per run and refill in merge() */
+		static constexpr size_t READ_BUFFER_SIZE = 1 << 12;
+	public:
+		explicit EdgeSpill(std::string const& directory) : _file(directory), _run_offsets(1, 0) { }
+
+		uint64_t getNrOfEdges() const { return _run_offsets.back(); }
+		size_t getNrOfRuns() const { return _run_offsets.size() - 1; }
+
+		/* sorts edges and appends them as a new run */
+		void appendRun(std::vector<EdgeT>& edges, uint num_threads);
+		/* all edges, sorted by (src, tgt); the spill is empty afterwards */
+		std::vector<EdgeT> merge();
+};
+
+template <typename EdgeT>
+void EdgeSpill<EdgeT>::appendRun(std::vector<EdgeT>& edges, uint num_threads)
+{
+	if (edges.empty()) return;
+
+	radixSort(edges, EdgeSortSrcTgt<EdgeT>(), num_threads);
+	_file.append(edges.data(), edges.size() * sizeof(EdgeT));
+	_run_offsets.push_back(_run_offsets.back() + edges.size());
+}
+
+template <typename EdgeT>
+std::vector<EdgeT> EdgeSpill<EdgeT>::merge()
+{
+	struct Run
+	{
+		uint64_t next;
+		uint64_t end;
+		std::vector<EdgeT> buffer;
+		size_t pos;
+	};
+
+	std::vector<Run> runs(getNrOfRuns());
+	auto refill = [this](Run& run) {
+		run.buffer.resize(std::min<uint64_t>(uint64_t(READ_BUFFER_SIZE), run.end - run.next));
+		_file.read(run.next * sizeof(EdgeT), run.buffer.data(), run.buffer.size() * sizeof(EdgeT));
+		run.next += run.buffer.size();
+		run.pos = 0;
+	};
+
+	/* smallest current edge first, on ties the earlier run */
+	EdgeSortSrcTgt<EdgeT> less;
+	auto later = [&runs, &less](size_t a, size_t b) {
+		EdgeT const& edge_a(runs[a].buffer[runs[a].pos]);
+		EdgeT const& edge_b(runs[b].buffer[runs[b].pos]);
+		if (less(edge_b, edge_a)) return true;
+		return !less(edge_a, edge_b) && b < a;
+	};
+	std::priority_queue<size_t, std::vector<size_t>, decltype(later)> queue(later);
+	for (size_t i(0); i<runs.size(); i++) {
+		runs[i].next = _run_offsets[i];
+		runs[i].end = _run_offsets[i + 1];
+		refill(runs[i]);
+		queue.push(i);
+	}
+
+	std::vector<EdgeT> edges;
+	edges.reserve(getNrOfEdges());
+	while (!queue.empty()) {
+		size_t i(queue.top());
+		queue.pop();
+
+		Run& run(runs[i]);
+		edges.push_back(run.buffer[run.pos++]);
+		if (run.pos == run.buffer.size()) {
+			if (run.next == run.end) {
+				run.buffer = std::vector<EdgeT>();
+				continue;
+			}
+			refill(run);
+		}
+		queue.push(i);
+	}
+
+	_file.clear();
+	_run_offsets.assign(1, 0);
+
+	debug_assert(std::is_sorted(edges.begin(), edges.end(), less));
+	return edges;
+}
+
+}
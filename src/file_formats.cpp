@@ -1,4 +1,5 @@
 #include "file_formats.h"
+#include "text_formatter.h"
 
 #include <random>
 #include <sstream>
@@ -7,35 +8,47 @@
 namespace chc {
 	namespace {
 		template<typename Callable>
-		auto readLine(std::istream& is, Callable&& callable) -> decltype(callable(is)) {
+		auto readLine(TextScanner& is, Callable&& callable) -> decltype(callable(is)) {
 			if (is.eof()) {
 				std::cerr << "FATAL_ERROR: end of file\n";
 				std::abort();
 			}
-#if 0
-			/* "nice" way; parse the next non-empty line through a seperate stringstream */
-			std::string line;
-			do {
-				std::getline(is, line);
-			} while (is && line.empty());
-			std::istringstream sis;
-			std::cerr << "Reading line: '" << line << "'\n";
-			sis.str(line);
-			return callable(static_cast<std::istream&>(sis));
-#else
 			/* only make sure there is a newline (or EOF) after the record */
 			auto r = callable(is);
 			auto t = is.peek();
 			if (is.fail()) {
-				std::cerr << "FATAL_ERROR: istream failed\n";
+				std::cerr << "FATAL_ERROR: couldn't parse record\n";
 				std::abort();
 			}
-			if ('\n' != t && std::istream::traits_type::eof() != t) {
+			if ('\n' != t && TextScanner::EOF_CHAR != t) {
 				std::cerr << "Couldn't find new line after record\n";
 				std::abort();
 			}
 			return r;
-#endif
+		}
+
+		/* edge distances have to fit into Distance (c::NO_EDGE_DIST is reserved) */
+		Distance toDistance(long long dist)
+		{
+			if (dist >= c::NO_EDGE_DIST) {
+				std::cerr << "FATAL_ERROR: Edge distance " << dist << " doesn't fit into a "
+					<< 8 * sizeof(Distance) << " bit distance (see CHC_DISTANCE_BITS). Exiting.\n";
+				std::abort();
+			}
+			return dist;
+		}
+
+		/* child edges are written as -1 if missing */
+		EdgeID readChildEdge(TextScanner& is)
+		{
+			long long child_edge;
+			is >> child_edge;
+			return child_edge < 0 ? c::NO_EID : EdgeID(child_edge);
+		}
+
+		long long childEdge(EdgeID child_edge)
+		{
+			return child_edge == c::NO_EID ? -1LL : static_cast<long long>(child_edge);
 		}
 	}
 
@@ -65,6 +78,9 @@ namespace chc {
 		else if (format == "STEFAN_CH") {
 			return FileFormat::STEFAN_CH;
 		}
+		else if (format == "BINARY") {
+			return FileFormat::BINARY;
+		}
 		else {
 			std::cerr << "Unknown fileformat: " << format << "\n";
 		}
@@ -72,6 +88,32 @@ namespace chc {
 		return FileFormat::FMI;
 	}
 
+	bool isCacheableFileFormat(FileFormat format)
+	{
+		/* the binary format stores everything these readers produce */
+		return format == FileFormat::STD || format == FileFormat::FMI || format == FileFormat::FMI_DIST;
+	}
+
+	bool isCHFileFormat(FileFormat format)
+	{
+		switch (format) {
+		case FileFormat::FMI_CH:
+		case FileFormat::FMI_EUCL_CH:
+		case FileFormat::STEFAN_CH:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	bool isCHFile(FileFormat format, std::string const& filename)
+	{
+		if (format == FileFormat::BINARY) {
+			return FormatBinary::isCHFile(filename);
+		}
+		return isCHFileFormat(format);
+	}
+
 	std::string to_string(FileFormat format)
 	{
 		switch (format) {
@@ -91,6 +133,8 @@ namespace chc {
 			return "FMI_EUCL_CH";
 		case FileFormat::STEFAN_CH:
 			return "STEFAN_CH";
+		case FileFormat::BINARY:
+			return "BINARY";
 		}
 
 		std::cerr << "Unknown fileformat: " << static_cast<int>(format) << "\n";
@@ -211,27 +255,56 @@ namespace chc {
 	template<>
 	void text_writeNode<OSMNode>(std::ostream& os, OSMNode const& node)
 	{
-		os << node.id << " " << node.osm_id << " " << node.lat << " "
-			<< node.lon << " " << node.elev << "\n";
+		TextFormatter out(os);
+		out << node.id << ' ' << node.osm_id << ' ' << node.lat << ' '
+			<< node.lon << ' ' << node.elev << '\n';
 	}
 
 	template<>
 	void text_writeNode<CHNode<OSMNode>>(std::ostream& os, CHNode<OSMNode> const& node)
 	{
-		os << node.id << " " << node.osm_id << " " << node.lat << " "
-			<< node.lon << " " << node.elev << " " << node.lvl << "\n";
+		TextFormatter out(os);
+		out << node.id << ' ' << node.osm_id << ' ' << node.lat << ' '
+			<< node.lon << ' ' << node.elev << ' ' << node.lvl << '\n';
 	}
 
 	template<>
 	void text_writeNode<CHNode<StefanNode>>(std::ostream& os, CHNode<StefanNode> const& node)
 	{
-		os << node.lon << " " << node.lat << " " <<  node.lvl << " " << node.osm_id << "\n";
+		TextFormatter out(os);
+		out << node.lon << ' ' << node.lat << ' ' << node.lvl << ' ' << node.osm_id << '\n';
+	}
+
+	template<>
+	CHNode<OSMNode> text_readNode<CHNode<OSMNode>>(TextScanner& is, NodeID node_id)
+	{
+		return readLine(is, [node_id](TextScanner& is) {
+			CHNode<OSMNode> node;
+			is >> node.id >> node.osm_id >> node.lat >> node.lon >> node.elev >> node.lvl;
+			if (node_id != c::NO_NID && node.id != node_id) {
+				std::cerr << "FATAL_ERROR: Invalid node id " << node.id << " at index " << node_id << ". Exiting\n";
+				text_writeNode(std::cerr, node);
+				std::abort();
+			}
+			return node;
+		});
 	}
 
 	template<>
-	OSMNode text_readNode<OSMNode>(std::istream& is, NodeID node_id)
+	CHNode<StefanNode> text_readNode<CHNode<StefanNode>>(TextScanner& is, NodeID node_id)
 	{
-		return readLine(is, [node_id](std::istream& is) {
+		return readLine(is, [node_id](TextScanner& is) {
+			CHNode<StefanNode> node;
+			node.id = node_id;
+			is >> node.lon >> node.lat >> node.lvl >> node.osm_id;
+			return node;
+		});
+	}
+
+	template<>
+	OSMNode text_readNode<OSMNode>(TextScanner& is, NodeID node_id)
+	{
+		return readLine(is, [node_id](TextScanner& is) {
 			OSMNode node;
 			is >> node.id >> node.osm_id >> node.lat >> node.lon >> node.elev;
 			if (node_id != c::NO_NID && node.id != node_id) {
@@ -246,13 +319,14 @@ namespace chc {
 	template<>
 	void text_writeNode<GeoNode>(std::ostream& os, GeoNode const& node)
 	{
-		os << node.lat << " " << node.lon << " " << node.elev << "\n";
+		TextFormatter out(os);
+		out << node.lat << ' ' << node.lon << ' ' << node.elev << '\n';
 	}
 
 	template<>
-	GeoNode text_readNode<GeoNode>(std::istream& is, NodeID node_id)
+	GeoNode text_readNode<GeoNode>(TextScanner& is, NodeID node_id)
 	{
-		return readLine(is, [node_id](std::istream& is) {
+		return readLine(is, [node_id](TextScanner& is) {
 			GeoNode node;
 			node.id = node_id;
 			is >> node.lat >> node.lon >> node.elev;
@@ -263,21 +337,22 @@ namespace chc {
 	template<>
 	void text_writeEdge<OSMEdge>(std::ostream& os, OSMEdge const& edge)
 	{
-		os << edge.src << " " << edge.tgt << " " << edge.dist << " "
-			<< edge.type << " " << edge.speed << "\n";
+		TextFormatter out(os);
+		out << edge.src << ' ' << edge.tgt << ' ' << edge.dist << ' '
+			<< edge.type << ' ' << edge.speed << '\n';
 	}
 
 	template<>
-	OSMEdge text_readEdge<OSMEdge>(std::istream& is, EdgeID edge_id)
+	OSMEdge text_readEdge<OSMEdge>(TextScanner& is, EdgeID edge_id)
 	{
-		return readLine(is, [edge_id](std::istream& is) {
+		return readLine(is, [edge_id](TextScanner& is) {
 			OSMEdge edge;
-			std::make_signed<decltype(edge.dist)>::type signed_dist;
+			long long signed_dist;
 
 			is >> edge.src >> edge.tgt >> signed_dist >> edge.type >> edge.speed;
 			if (signed_dist >= 0) {
 				edge.id = edge_id;
-				edge.dist = signed_dist;
+				edge.dist = toDistance(signed_dist);
 			} else {
 				// mark as invalid edge with 0 length
 				edge.id = c::NO_EID;
@@ -289,16 +364,16 @@ namespace chc {
 	}
 
 	template<>
-	EuclOSMEdge text_readEdge<EuclOSMEdge>(std::istream& is, EdgeID edge_id)
+	EuclOSMEdge text_readEdge<EuclOSMEdge>(TextScanner& is, EdgeID edge_id)
 	{
-		return readLine(is, [edge_id](std::istream& is) {
+		return readLine(is, [edge_id](TextScanner& is) {
 			EuclOSMEdge edge;
-			std::make_signed<decltype(edge.dist)>::type signed_dist;
+			long long signed_dist;
 
 			is >> edge.src >> edge.tgt >> signed_dist >> edge.type >> edge.speed;
 			if (signed_dist >= 0) {
 				edge.id = edge_id;
-				edge.dist = signed_dist;
+				edge.dist = toDistance(signed_dist);
 			} else {
 				// mark as invalid edge with 0 length
 				edge.id = c::NO_EID;
@@ -311,16 +386,16 @@ namespace chc {
 	}
 
 	template<>
-	OSMDistEdge text_readEdge<OSMDistEdge>(std::istream& is, EdgeID edge_id)
+	OSMDistEdge text_readEdge<OSMDistEdge>(TextScanner& is, EdgeID edge_id)
 	{
-		return readLine(is, [edge_id](std::istream& is) {
+		return readLine(is, [edge_id](TextScanner& is) {
 			OSMDistEdge edge;
-			std::make_signed<decltype(edge.dist)>::type signed_dist;
+			long long signed_dist;
 
 			is >> edge.src >> edge.tgt >> signed_dist >> edge.type >> edge.speed;
 			if (signed_dist >= 0) {
 				edge.id = edge_id;
-				edge.dist = signed_dist;
+				edge.dist = toDistance(signed_dist);
 			} else {
 				// mark as invalid edge with 0 length
 				edge.id = c::NO_EID;
@@ -333,20 +408,21 @@ namespace chc {
 	template<>
 	void text_writeEdge<Edge>(std::ostream& os, Edge const& edge)
 	{
-		os << edge.src << " " << edge.tgt << " " << edge.dist << "\n";
+		TextFormatter out(os);
+		out << edge.src << ' ' << edge.tgt << ' ' << edge.dist << '\n';
 	}
 
 	template<>
-	Edge text_readEdge<Edge>(std::istream& is, EdgeID edge_id)
+	Edge text_readEdge<Edge>(TextScanner& is, EdgeID edge_id)
 	{
-		return readLine(is, [edge_id](std::istream& is) {
+		return readLine(is, [edge_id](TextScanner& is) {
 			Edge edge;
-			std::make_signed<decltype(edge.dist)>::type signed_dist;
+			long long signed_dist;
 
 			is >> edge.src >> edge.tgt >> signed_dist;
 			if (signed_dist >= 0) {
 				edge.id = edge_id;
-				edge.dist = signed_dist;
+				edge.dist = toDistance(signed_dist);
 			} else {
 				// mark as invalid edge with 0 length
 				edge.id = c::NO_EID;
@@ -359,27 +435,70 @@ namespace chc {
 	template<>
 	void text_writeEdge<CHEdge<OSMEdge>>(std::ostream& os, CHEdge<OSMEdge> const& edge)
 	{
-		os << edge.src << " " << edge.tgt << " " << edge.dist << " "
-			<< edge.type << " " << edge.speed << " "
-			<< (edge.child_edge1 == c::NO_EID ? "-1" : std::to_string(edge.child_edge1)) << " "
-			<< (edge.child_edge2 == c::NO_EID ? "-1" : std::to_string(edge.child_edge2)) << "\n";
+		TextFormatter out(os);
+		out << edge.src << ' ' << edge.tgt << ' ' << edge.dist << ' '
+			<< edge.type << ' ' << edge.speed << ' '
+			<< childEdge(edge.child_edge1) << ' '
+			<< childEdge(edge.child_edge2) << '\n';
 	}
 
 	template<>
 	void text_writeEdge<CHEdge<EuclOSMEdge>>(std::ostream& os, CHEdge<EuclOSMEdge> const& edge)
 	{
-		os << edge.src << " " << edge.tgt << " " << edge.dist << " "
-			<< edge.type << " " << edge.eucl_dist << " "
-			<< (edge.child_edge1 == c::NO_EID ? "-1" : std::to_string(edge.child_edge1)) << " "
-			<< (edge.child_edge2 == c::NO_EID ? "-1" : std::to_string(edge.child_edge2)) << "\n";
+		TextFormatter out(os);
+		out << edge.src << ' ' << edge.tgt << ' ' << edge.dist << ' '
+			<< edge.type << ' ' << edge.eucl_dist << ' '
+			<< childEdge(edge.child_edge1) << ' '
+			<< childEdge(edge.child_edge2) << '\n';
 	}
 
 	template<>
 	void text_writeEdge<CHEdge<StefanEdge>>(std::ostream& os, CHEdge<StefanEdge> const& edge)
 	{
-		os << edge.src << " " << edge.tgt << " " << edge.dist << " "
-			<< (edge.child_edge1 == c::NO_EID ? "-1" : std::to_string(edge.child_edge1)) << " "
-			<< (edge.child_edge2 == c::NO_EID ? "-1" : std::to_string(edge.child_edge2)) << "\n";
+		TextFormatter out(os);
+		out << edge.src << ' ' << edge.tgt << ' ' << edge.dist << ' '
+			<< childEdge(edge.child_edge1) << ' '
+			<< childEdge(edge.child_edge2) << '\n';
+	}
+
+	template<>
+	CHEdge<OSMEdge> text_readEdge<CHEdge<OSMEdge>>(TextScanner& is, EdgeID edge_id)
+	{
+		return readLine(is, [edge_id](TextScanner& is) {
+			CHEdge<OSMEdge> edge;
+			edge.id = edge_id;
+			is >> edge.src >> edge.tgt >> edge.dist >> edge.type >> edge.speed;
+			edge.child_edge1 = readChildEdge(is);
+			edge.child_edge2 = readChildEdge(is);
+			return edge;
+		});
+	}
+
+	template<>
+	CHEdge<EuclOSMEdge> text_readEdge<CHEdge<EuclOSMEdge>>(TextScanner& is, EdgeID edge_id)
+	{
+		return readLine(is, [edge_id](TextScanner& is) {
+			CHEdge<EuclOSMEdge> edge;
+			edge.id = edge_id;
+			/* the speed is not stored */
+			is >> edge.src >> edge.tgt >> edge.dist >> edge.type >> edge.eucl_dist;
+			edge.child_edge1 = readChildEdge(is);
+			edge.child_edge2 = readChildEdge(is);
+			return edge;
+		});
+	}
+
+	template<>
+	CHEdge<StefanEdge> text_readEdge<CHEdge<StefanEdge>>(TextScanner& is, EdgeID edge_id)
+	{
+		return readLine(is, [edge_id](TextScanner& is) {
+			CHEdge<StefanEdge> edge;
+			edge.id = edge_id;
+			is >> edge.src >> edge.tgt >> edge.dist;
+			edge.child_edge1 = readChildEdge(is);
+			edge.child_edge2 = readChildEdge(is);
+			return edge;
+		});
 	}
 
 
@@ -471,7 +590,7 @@ namespace chc {
 				Metadata& meta_data)
 		{
 			std::string line;
-			std::getline(is, line);
+			is.getline(line);
 			while (line != "") {
 				std::stringstream ss(line);
 				std::string hash;
@@ -491,7 +610,7 @@ namespace chc {
 
 				meta_data[key] = map;
 
-				std::getline(is, line);
+				is.getline(line);
 			}
 
 			is >> estimated_nr_nodes >> estimated_nr_edges;
@@ -534,6 +653,16 @@ namespace chc {
 	}
 
 	namespace FormatFMI_CH {
+		auto Reader_impl::readNode(NodeID node_id) -> node_type
+		{
+			return text_readNode<node_type>(is, node_id);
+		}
+
+		auto Reader_impl::readEdge(EdgeID edge_id) -> edge_type
+		{
+			return text_readEdge<edge_type>(is, edge_id);
+		}
+
 		Writer_impl::Writer_impl(std::ostream& os) : FormatSTD::Writer_impl(os) {
 			os.precision(7);
 			os << std::fixed;
@@ -567,6 +696,11 @@ namespace chc {
 	}
 
 	namespace FormatFMI_EUCL_CH {
+		auto Reader_impl::readEdge(EdgeID edge_id) -> edge_type
+		{
+			return text_readEdge<edge_type>(is, edge_id);
+		}
+
 		void Writer_impl::writeEdge(edge_type const& out, EdgeID)
 		{
 			text_writeEdge<edge_type>(os, out);
@@ -574,6 +708,16 @@ namespace chc {
 	}
 
 	namespace FormatSTEFAN_CH {
+		auto Reader_impl::readNode(NodeID node_id) -> node_type
+		{
+			return text_readNode<node_type>(is, node_id);
+		}
+
+		auto Reader_impl::readEdge(EdgeID edge_id) -> edge_type
+		{
+			return text_readEdge<edge_type>(is, edge_id);
+		}
+
 		Writer_impl::Writer_impl(std::ostream& os) : FormatSTD::Writer_impl(os) {
 			os.precision(7);
 			os << std::fixed;
@@ -1,8 +1,19 @@
 #pragma once
 
 #include "file_formats_helper.h"
+#include "binary_format.h"
+#include "compression.h"
+#include "graph_cache.h"
+
+#include <cstdio>
+#include <fstream>
 
 namespace chc {
+	namespace unit_tests
+	{
+		void testCHFileFormats();
+	}
+
 	// "default" text serialization of some nodes and edge types,
 	// used in the the formats below
 	template<typename NodeT>
@@ -13,9 +24,11 @@ namespace chc {
 	template<> void text_writeNode<CHNode<StefanNode>>(std::ostream& os, CHNode<StefanNode> const& node);
 
 	template<typename NodeT>
-	NodeT text_readNode(std::istream& is, NodeID node_id = c::NO_NID);
-	template<> OSMNode text_readNode<OSMNode>(std::istream& is, NodeID node_id);
-	template<> GeoNode text_readNode<GeoNode>(std::istream& is, NodeID node_id);
+	NodeT text_readNode(TextScanner& is, NodeID node_id = c::NO_NID);
+	template<> OSMNode text_readNode<OSMNode>(TextScanner& is, NodeID node_id);
+	template<> GeoNode text_readNode<GeoNode>(TextScanner& is, NodeID node_id);
+	template<> CHNode<OSMNode> text_readNode<CHNode<OSMNode>>(TextScanner& is, NodeID node_id);
+	template<> CHNode<StefanNode> text_readNode<CHNode<StefanNode>>(TextScanner& is, NodeID node_id);
 
 	template<typename EdgeT>
 	void text_writeEdge(std::ostream& os, EdgeT const& edge);
@@ -26,11 +39,14 @@ namespace chc {
 	template<> void text_writeEdge<CHEdge<StefanEdge>>(std::ostream& os, CHEdge<StefanEdge> const& edge);
 
 	template<typename EdgeT>
-	EdgeT text_readEdge(std::istream& is, EdgeID edge_id = c::NO_EID);
-	template<> OSMEdge text_readEdge<OSMEdge>(std::istream& is, EdgeID edge_id);
-	template<> EuclOSMEdge text_readEdge<EuclOSMEdge>(std::istream& is, EdgeID edge_id);
-	template<> OSMDistEdge text_readEdge<OSMDistEdge>(std::istream& is, EdgeID edge_id);
-	template<> Edge text_readEdge<Edge>(std::istream& is, EdgeID edge_id);
+	EdgeT text_readEdge(TextScanner& is, EdgeID edge_id = c::NO_EID);
+	template<> OSMEdge text_readEdge<OSMEdge>(TextScanner& is, EdgeID edge_id);
+	template<> EuclOSMEdge text_readEdge<EuclOSMEdge>(TextScanner& is, EdgeID edge_id);
+	template<> OSMDistEdge text_readEdge<OSMDistEdge>(TextScanner& is, EdgeID edge_id);
+	template<> Edge text_readEdge<Edge>(TextScanner& is, EdgeID edge_id);
+	template<> CHEdge<OSMEdge> text_readEdge<CHEdge<OSMEdge>>(TextScanner& is, EdgeID edge_id);
+	template<> CHEdge<EuclOSMEdge> text_readEdge<CHEdge<EuclOSMEdge>>(TextScanner& is, EdgeID edge_id);
+	template<> CHEdge<StefanEdge> text_readEdge<CHEdge<StefanEdge>>(TextScanner& is, EdgeID edge_id);
 
 	namespace FormatSTD
 	{
@@ -39,13 +55,13 @@ namespace chc {
 
 		struct Reader_impl
 		{
-			Reader_impl(std::istream& is) : is(is) { }
+			Reader_impl(TextScanner& is) : is(is) { }
 			void readHeader(NodeID& estimated_nr_nodes, EdgeID& estimated_nr_edges,
 					Metadata& meta_data);
 			node_type readNode(NodeID node_id);
 			edge_type readEdge(EdgeID edge_id);
 		protected:
-			std::istream& is;
+			TextScanner& is;
 		};
 		typedef SimpleReader<Reader_impl> Reader;
 
@@ -69,13 +85,13 @@ namespace chc {
 
 		struct Reader_impl
 		{
-			Reader_impl(std::istream& is) : is(is) { }
+			Reader_impl(TextScanner& is) : is(is) { }
 			void readHeader(NodeID& estimated_nr_nodes, EdgeID& estimated_nr_edges,
 					Metadata& meta_data);
 			node_type readNode(NodeID node_id);
 			edge_type readEdge(EdgeID edge_id);
 		protected:
-			std::istream& is;
+			TextScanner& is;
 		};
 		typedef SimpleReader<Reader_impl> Reader;
 
@@ -100,7 +116,7 @@ namespace chc {
 
 		struct Reader_impl : public FormatSTD::Reader_impl
 		{
-			Reader_impl(std::istream& is) : FormatSTD::Reader_impl(is) { }
+			Reader_impl(TextScanner& is) : FormatSTD::Reader_impl(is) { }
 			void readHeader(NodeID& estimated_nr_nodes, EdgeID& estimated_nr_edges,
 					Metadata& meta_data);
 		};
@@ -122,7 +138,7 @@ namespace chc {
 		struct Reader_impl : public FormatFMI::Reader_impl
 		{
 			edge_type readEdge(EdgeID edge_id);
-			Reader_impl(std::istream& is) : FormatFMI::Reader_impl(is) { }
+			Reader_impl(TextScanner& is) : FormatFMI::Reader_impl(is) { }
 		};
 		typedef SimpleReader<Reader_impl> Reader;
 	}
@@ -135,7 +151,7 @@ namespace chc {
 		struct Reader_impl : public FormatFMI::Reader_impl
 		{
 			edge_type readEdge(EdgeID edge_id);
-			Reader_impl(std::istream& is) : FormatFMI::Reader_impl(is) { }
+			Reader_impl(TextScanner& is) : FormatFMI::Reader_impl(is) { }
 		};
 		typedef SimpleReader<Reader_impl> Reader;
 	}
@@ -145,6 +161,14 @@ namespace chc {
 		typedef CHNode<OSMNode> node_type;
 		typedef CHEdge<OSMEdge> edge_type;
 
+		struct Reader_impl : public FormatFMI::Reader_impl
+		{
+			Reader_impl(TextScanner& is) : FormatFMI::Reader_impl(is) { }
+			node_type readNode(NodeID node_id);
+			edge_type readEdge(EdgeID edge_id);
+		};
+		typedef SimpleReader<Reader_impl> Reader;
+
 		struct Writer_impl : public FormatSTD::Writer_impl
 		{
 		public:
@@ -161,6 +185,13 @@ namespace chc {
 		typedef CHNode<OSMNode> node_type;
 		typedef CHEdge<EuclOSMEdge> edge_type;
 
+		struct Reader_impl : public FormatFMI_CH::Reader_impl
+		{
+			Reader_impl(TextScanner& is) : FormatFMI_CH::Reader_impl(is) { }
+			edge_type readEdge(EdgeID edge_id);
+		};
+		typedef SimpleReader<Reader_impl> Reader;
+
 		struct Writer_impl : public FormatFMI_CH::Writer_impl
 		{
 		public:
@@ -175,6 +206,14 @@ namespace chc {
 		typedef CHNode<StefanNode> node_type;
 		typedef CHEdge<StefanEdge> edge_type;
 
+		struct Reader_impl : public FormatSTD::Reader_impl
+		{
+			Reader_impl(TextScanner& is) : FormatSTD::Reader_impl(is) { }
+			node_type readNode(NodeID node_id);
+			edge_type readEdge(EdgeID edge_id);
+		};
+		typedef SimpleReader<Reader_impl> Reader;
+
 		struct Writer_impl : public FormatSTD::Writer_impl
 		{
 		public:
@@ -187,60 +226,159 @@ namespace chc {
 
 
 
-	enum class FileFormat { STD, SIMPLE, FMI, FMI_DIST, FMI_EUCL, FMI_CH, FMI_EUCL_CH, STEFAN_CH };
-	static constexpr FileFormat LastFileFormat = FileFormat::STEFAN_CH;
+	enum class FileFormat { STD, SIMPLE, FMI, FMI_DIST, FMI_EUCL, FMI_CH, FMI_EUCL_CH, STEFAN_CH, BINARY };
+	static constexpr FileFormat LastFileFormat = FileFormat::BINARY;
 
 	FileFormat toFileFormat(std::string const& format);
+	/* formats storing a contracted graph (node levels and shortcuts) */
+	bool isCHFileFormat(FileFormat format);
+	/* like isCHFileFormat(), but BINARY files are checked for a CH */
+	bool isCHFile(FileFormat format, std::string const& filename);
+	/* formats whose parsed graphs can be cached (see graph_cache.h) */
+	bool isCacheableFileFormat(FileFormat format);
 	std::string to_string(FileFormat format);
 	std::vector<FileFormat> getAllFileFormats();
 	std::string getAllFileFormatsString();
 
 	template<typename Node, typename Edge>
-	inline GraphInData<Node, Edge> readGraph(FileFormat format, std::string const& filename)
+	inline GraphInData<Node, Edge> readGraph(FileFormat format, std::string const& filename, uint num_threads = 1, bool use_cache = false);
+
+	template<typename Node, typename Edge, typename std::enable_if<
+		!(FormatBinary::Writer::can_write<Node, Edge>::value && FormatBinary::Reader::can_read<Node, Edge>::value)>::type* = nullptr>
+	inline GraphInData<Node, Edge> readCachedGraph(FileFormat format, std::string const& filename, uint num_threads)
+	{
+		Print("Can't cache graphs with these node / edge types, reading without cache.");
+		return readGraph<Node, Edge>(format, filename, num_threads);
+	}
+
+	/* read from the cache if it is up to date, otherwise read filename and (re)build the cache */
+	template<typename Node, typename Edge, typename std::enable_if<
+		FormatBinary::Writer::can_write<Node, Edge>::value && FormatBinary::Reader::can_read<Node, Edge>::value>::type* = nullptr>
+	inline GraphInData<Node, Edge> readCachedGraph(FileFormat format, std::string const& filename, uint num_threads)
+	{
+		if (!isCacheableFileFormat(format)) {
+			Print("Graphs in format " << to_string(format) << " can't be cached, reading without cache.");
+			return readGraph<Node, Edge>(format, filename, num_threads);
+		}
+
+		std::string const cache_filename(GraphCache::cacheFilename(filename));
+		Metadata const key(GraphCache::sourceKey(filename, to_string(format)));
+		if (GraphCache::isValid(cache_filename, key)) {
+			Print("Reading cached graph from " << cache_filename);
+			auto data(FormatBinary::Reader::readGraph<Node, Edge>(cache_filename));
+			data.meta_data = GraphCache::withoutKey(data.meta_data);
+			return data;
+		}
+
+		auto data(readGraph<Node, Edge>(format, filename, num_threads));
+
+		/*
+		 * write to a uniquely named temporary file first, so neither an
+		 * interrupted run nor concurrent runs leave a broken cache
+		 */
+		std::string const tmp_filename(GraphCache::createTempFile(cache_filename));
+		std::ofstream os;
+		if (!tmp_filename.empty()) os.open(tmp_filename.c_str(), std::ios::binary);
+		if (!os.is_open()) {
+			std::cerr << "WARNING: Couldn't write graph cache '" << cache_filename << "'.\n";
+			if (!tmp_filename.empty()) std::remove(tmp_filename.c_str());
+			return data;
+		}
+		FormatBinary::Writer::writeGraph(os, GraphOutData<Node, Edge> { data.nodes, data.edges,
+				GraphCache::withKey(data.meta_data, key) });
+		os.close();
+		if (!os || std::rename(tmp_filename.c_str(), cache_filename.c_str()) != 0) {
+			std::cerr << "WARNING: Couldn't write graph cache '" << cache_filename << "'.\n";
+			std::remove(tmp_filename.c_str());
+		}
+		else {
+			Print("Wrote graph cache to " << cache_filename);
+		}
+		return data;
+	}
+
+	template<typename Node, typename Edge>
+	inline GraphInData<Node, Edge> readGraph(FileFormat format, std::string const& filename, uint num_threads, bool use_cache)
 	{
+		if (use_cache) {
+			return readCachedGraph<Node, Edge>(format, filename, num_threads);
+		}
+
 		switch (format) {
 		case FileFormat::STD:
-			return FormatSTD::Reader::readGraph<Node, Edge>(filename);
+			return FormatSTD::Reader::readGraph<Node, Edge>(filename, num_threads);
 		case FileFormat::SIMPLE:
-			return FormatSimple::Reader::readGraph<Node, Edge>(filename);
+			return FormatSimple::Reader::readGraph<Node, Edge>(filename, num_threads);
 		case FileFormat::FMI:
-			return FormatFMI::Reader::readGraph<Node, Edge>(filename);
+			return FormatFMI::Reader::readGraph<Node, Edge>(filename, num_threads);
 		case FileFormat::FMI_DIST:
-			return FormatFMI_DIST::Reader::readGraph<Node, Edge>(filename);
+			return FormatFMI_DIST::Reader::readGraph<Node, Edge>(filename, num_threads);
 		case FileFormat::FMI_EUCL:
-			return FormatFMI_EUCL::Reader::readGraph<Node, Edge>(filename);
+			return FormatFMI_EUCL::Reader::readGraph<Node, Edge>(filename, num_threads);
 		case FileFormat::FMI_CH:
 			break;
 		case FileFormat::FMI_EUCL_CH:
 			break;
 		case FileFormat::STEFAN_CH:
 			break;
+		case FileFormat::BINARY:
+			return FormatBinary::Reader::readGraph<Node, Edge>(filename, num_threads);
 		}
 		std::cerr << "Unknown input fileformat!" << std::endl;
 		std::exit(1);
 	}
 
+	/* read a contracted graph; only for formats with isCHFileFormat() */
+	template<typename Node, typename Edge>
+	inline GraphCHInData<Node, Edge> readCHGraph(FileFormat format, std::string const& filename, uint num_threads = 1)
+	{
+		switch (format) {
+		case FileFormat::STD:
+			break;
+		case FileFormat::SIMPLE:
+			break;
+		case FileFormat::FMI:
+			break;
+		case FileFormat::FMI_DIST:
+			break;
+		case FileFormat::FMI_EUCL:
+			break;
+		case FileFormat::FMI_CH:
+			return FormatFMI_CH::Reader::readCHGraph<Node, Edge>(filename, num_threads);
+		case FileFormat::FMI_EUCL_CH:
+			return FormatFMI_EUCL_CH::Reader::readCHGraph<Node, Edge>(filename, num_threads);
+		case FileFormat::STEFAN_CH:
+			return FormatSTEFAN_CH::Reader::readCHGraph<Node, Edge>(filename, num_threads);
+		case FileFormat::BINARY:
+			return FormatBinary::Reader::readCHGraph<Node, Edge>(filename, num_threads);
+		}
+		std::cerr << "Unknown CH input fileformat!" << std::endl;
+		std::exit(1);
+	}
+
 	/* run callable with types from reader (but always with CHEdge<>) */
 	template<typename Callable>
-	inline void withReadGraph(FileFormat format, std::string const& filename, Callable&& callable)
+	inline void withReadGraph(FileFormat format, std::string const& filename, Callable&& callable, uint num_threads = 1)
 	{
 		switch (format) {
 		case FileFormat::STD:
-			callable(FormatSTD::Reader::readGraph(filename));
+			callable(FormatSTD::Reader::readGraph(filename, num_threads));
 		case FileFormat::SIMPLE:
-			callable(FormatSimple::Reader::readGraph(filename));
+			callable(FormatSimple::Reader::readGraph(filename, num_threads));
 		case FileFormat::FMI:
-			callable(FormatFMI::Reader::readGraph(filename));
+			callable(FormatFMI::Reader::readGraph(filename, num_threads));
 		case FileFormat::FMI_DIST:
-			callable(FormatFMI_DIST::Reader::readGraph(filename));
+			callable(FormatFMI_DIST::Reader::readGraph(filename, num_threads));
 		case FileFormat::FMI_EUCL:
-			callable(FormatFMI_EUCL::Reader::readGraph(filename));
+			callable(FormatFMI_EUCL::Reader::readGraph(filename, num_threads));
 		case FileFormat::FMI_CH:
 			break;
 		case FileFormat::FMI_EUCL_CH:
 			break;
 		case FileFormat::STEFAN_CH:
 			break;
+		case FileFormat::BINARY:
+			callable(FormatBinary::Reader::readGraph(filename, num_threads));
 		}
 		std::cerr << "Unknown input fileformat!" << std::endl;
 		std::exit(1);
@@ -248,21 +386,21 @@ namespace chc {
 
 	/* try to read with types suitable to be written with Writer; strip CHNode<>, but apply CHEdge<> */
 	template<typename Writer>
-	inline GraphInData<typename MakeCHNode<typename Writer::node_type>::base_node_type, MakeCHEdge<typename Writer::edge_type>> readGraphForWriter(FileFormat format, std::string const& filename)
+	inline GraphInData<typename MakeCHNode<typename Writer::node_type>::base_node_type, MakeCHEdge<typename Writer::edge_type>> readGraphForWriter(FileFormat format, std::string const& filename, uint num_threads = 1, bool use_cache = false)
 	{
-		return readGraph<typename MakeCHNode<typename Writer::node_type>::base_node_type, MakeCHEdge<typename Writer::edge_type>>(format, filename);
+		return readGraph<typename MakeCHNode<typename Writer::node_type>::base_node_type, MakeCHEdge<typename Writer::edge_type>>(format, filename, num_threads, use_cache);
 	}
 
 	/* run callable with types suitable to be written with Writer for write_format; strip CHNode<>, but apply CHEdge<> */
 	template<typename Callable>
-	inline void readGraphForWriteFormat(FileFormat write_format, FileFormat read_format, std::string const& filename, Callable&& callable)
+	inline void readGraphForWriteFormat(FileFormat write_format, FileFormat read_format, std::string const& filename, Callable&& callable, uint num_threads = 1, bool use_cache = false)
 	{
 		switch (write_format) {
 		case FileFormat::STD:
-			callable(readGraphForWriter<FormatSTD::Writer>(read_format, filename));
+			callable(readGraphForWriter<FormatSTD::Writer>(read_format, filename, num_threads, use_cache));
 			return;
 		case FileFormat::SIMPLE:
-			callable(readGraphForWriter<FormatSimple::Writer>(read_format, filename));
+			callable(readGraphForWriter<FormatSimple::Writer>(read_format, filename, num_threads, use_cache));
 			return;
 		case FileFormat::FMI:
 			break;
@@ -271,13 +409,16 @@ namespace chc {
 		case FileFormat::FMI_EUCL:
 			break;
 		case FileFormat::FMI_CH:
-			callable(readGraphForWriter<FormatFMI_CH::Writer>(read_format, filename));
+			callable(readGraphForWriter<FormatFMI_CH::Writer>(read_format, filename, num_threads, use_cache));
 			return;
 		case FileFormat::FMI_EUCL_CH:
-			callable(readGraphForWriter<FormatFMI_EUCL_CH::Writer>(read_format, filename));
+			callable(readGraphForWriter<FormatFMI_EUCL_CH::Writer>(read_format, filename, num_threads, use_cache));
 			return;
 		case FileFormat::STEFAN_CH:
-			callable(readGraphForWriter<FormatSTEFAN_CH::Writer>(read_format, filename));
+			callable(readGraphForWriter<FormatSTEFAN_CH::Writer>(read_format, filename, num_threads, use_cache));
+			return;
+		case FileFormat::BINARY:
+			callable(readGraphForWriter<FormatBinary::Writer>(read_format, filename, num_threads, use_cache));
 			return;
 		}
 		std::cerr << "Unknown output fileformat!" << std::endl;
@@ -285,30 +426,24 @@ namespace chc {
 	}
 
 	template<typename Writer, typename NodeT, typename EdgeT>
-	inline void writeCHGraphFile(std::string const& filename, GraphCHOutData<NodeT, EdgeT> const& data)
+	inline void writeCHGraphFile(std::string const& filename, GraphCHOutData<NodeT, EdgeT> const& data, uint num_threads = 1)
 	{
-		std::ofstream os(filename.c_str());
-
-		if (!os.is_open()) {
-			std::cerr << "FATAL_ERROR: Couldn't open graph file \'" <<
-				filename << "\'. Exiting." << std::endl;
-			std::abort();
-		}
+		auto os(openGraphOutputFile(filename));
 
 		Print("Exporting to " << filename);
-		Writer::writeCHGraph(os, data);
-		os.close();
+		Writer::writeCHGraph(*os, data, num_threads);
+		closeGraphOutputFile(*os);
 	}
 
 	template<typename NodeT, typename EdgeT>
-	inline void writeCHGraphFile(FileFormat format, std::string const& filename, GraphCHOutData<NodeT, EdgeT> const& data)
+	inline void writeCHGraphFile(FileFormat format, std::string const& filename, GraphCHOutData<NodeT, EdgeT> const& data, uint num_threads = 1)
 	{
 		switch (format) {
 		case FileFormat::STD:
-			writeCHGraphFile<FormatSTD::Writer>(filename, data);
+			writeCHGraphFile<FormatSTD::Writer>(filename, data, num_threads);
 			return;
 		case FileFormat::SIMPLE:
-			writeCHGraphFile<FormatSimple::Writer>(filename, data);
+			writeCHGraphFile<FormatSimple::Writer>(filename, data, num_threads);
 			return;
 		case FileFormat::FMI:
 			break;
@@ -317,13 +452,16 @@ namespace chc {
 		case FileFormat::FMI_EUCL:
 			break;
 		case FileFormat::FMI_CH:
-			writeCHGraphFile<FormatFMI_CH::Writer>(filename, data);
+			writeCHGraphFile<FormatFMI_CH::Writer>(filename, data, num_threads);
 			return;
 		case FileFormat::FMI_EUCL_CH:
-			writeCHGraphFile<FormatFMI_EUCL_CH::Writer>(filename, data);
+			writeCHGraphFile<FormatFMI_EUCL_CH::Writer>(filename, data, num_threads);
 			return;
 		case FileFormat::STEFAN_CH:
-			writeCHGraphFile<FormatSTEFAN_CH::Writer>(filename, data);
+			writeCHGraphFile<FormatSTEFAN_CH::Writer>(filename, data, num_threads);
+			return;
+		case FileFormat::BINARY:
+			writeCHGraphFile<FormatBinary::Writer>(filename, data, num_threads);
 			return;
 		}
 		std::cerr << "Unknown output fileformat!" << std::endl;
@@ -331,46 +469,43 @@ namespace chc {
 	}
 
 	template<typename Writer, typename NodeT, typename EdgeT>
-	inline void writeGraphFile(std::string const& filename, GraphOutData<NodeT, EdgeT> const& data)
+	inline void writeGraphFile(std::string const& filename, GraphOutData<NodeT, EdgeT> const& data, uint num_threads = 1)
 	{
-		std::ofstream os(filename.c_str());
-
-		if (!os.is_open()) {
-			std::cerr << "FATAL_ERROR: Couldn't open graph file \'" <<
-				filename << "\'. Exiting." << std::endl;
-			std::abort();
-		}
+		auto os(openGraphOutputFile(filename));
 
 		Print("Exporting to " << filename);
-		Writer::writeGraph(os, data);
-		os.close();
+		Writer::writeGraph(*os, data, num_threads);
+		closeGraphOutputFile(*os);
 	}
 
 	template<typename NodeT, typename EdgeT>
-	inline void writeGraphFile(FileFormat format, std::string const& filename, GraphOutData<NodeT, EdgeT> const& data)
+	inline void writeGraphFile(FileFormat format, std::string const& filename, GraphOutData<NodeT, EdgeT> const& data, uint num_threads = 1)
 	{
 		switch (format) {
 		case FileFormat::STD:
-			writeGraphFile<FormatSTD::Writer>(filename, data);
+			writeGraphFile<FormatSTD::Writer>(filename, data, num_threads);
 			return;
 		case FileFormat::SIMPLE:
-			writeGraphFile<FormatSimple::Writer>(filename, data);
+			writeGraphFile<FormatSimple::Writer>(filename, data, num_threads);
 			return;
 		case FileFormat::FMI:
-			writeGraphFile<FormatFMI::Writer>(filename, data);
+			writeGraphFile<FormatFMI::Writer>(filename, data, num_threads);
 			return;
 		case FileFormat::FMI_DIST:
 			break;
 		case FileFormat::FMI_EUCL:
 			break;
 		case FileFormat::FMI_CH:
-			writeGraphFile<FormatFMI_CH::Writer>(filename, data);
+			writeGraphFile<FormatFMI_CH::Writer>(filename, data, num_threads);
 			return;
 		case FileFormat::FMI_EUCL_CH:
-			writeGraphFile<FormatFMI_EUCL_CH::Writer>(filename, data);
+			writeGraphFile<FormatFMI_EUCL_CH::Writer>(filename, data, num_threads);
 			return;
 		case FileFormat::STEFAN_CH:
-			writeGraphFile<FormatSTEFAN_CH::Writer>(filename, data);
+			writeGraphFile<FormatSTEFAN_CH::Writer>(filename, data, num_threads);
+			return;
+		case FileFormat::BINARY:
+			writeGraphFile<FormatBinary::Writer>(filename, data, num_threads);
 			return;
 		}
 		std::cerr << "Unknown output fileformat!" << std::endl;
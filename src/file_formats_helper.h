@@ -2,8 +2,15 @@
 
 #include "nodes_and_edges.h"
 #include "function_traits.h"
+#include "text_scanner.h"
+#include "async_writer.h"
+#include "radix_sort.h"
 
 #include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <utility>
+#include <vector>
 
 namespace chc {
 	template<typename Writer, typename NodeT, typename EdgeT>
@@ -17,6 +24,27 @@ namespace chc {
 		static constexpr bool value = support_node::value && support_edge::value;
 	};
 
+	/*
+	 * Casts between different CHNode<> / CHEdge<> types go through the base
+	 * types and don't keep the level / shortcut data, e.g. when writing a
+	 * CH of OSMNode / CHEdge<OSMEdge> as STEFAN_CH. (ch_constructor reads
+	 * its input in the types of the output format, so it never casts.)
+	 */
+	template<typename NodeT>
+	inline void setNodeLevel(NodeT&, uint) { }
+	template<typename NodeT>
+	inline void setNodeLevel(CHNode<NodeT>& node, uint lvl) { node.lvl = lvl; }
+
+	template<typename EdgeT, typename InEdgeT>
+	inline void copyShortcutData(EdgeT&, InEdgeT const&) { }
+	template<typename EdgeT, typename InEdgeT>
+	inline void copyShortcutData(CHEdge<EdgeT>& edge, CHEdge<InEdgeT> const& in_edge)
+	{
+		edge.child_edge1 = in_edge.child_edge1;
+		edge.child_edge2 = in_edge.child_edge2;
+		edge.center_node = in_edge.center_node;
+	}
+
 
 	template<typename Implementation>
 	struct SimpleReader
@@ -35,14 +63,14 @@ namespace chc {
 		};
 
 		template<typename NodeT = node_type, typename EdgeT = chedge_type, typename std::enable_if<!can_read<NodeT, EdgeT>::value>::type* = nullptr>
-		static GraphInData<NodeT, EdgeT> readGraph(std::istream& is)
+		static GraphInData<NodeT, EdgeT> readGraph(TextScanner& is, uint num_threads = 1)
 		{
 			Print("Can't read nodes / edges in this format");
 			std::abort();
 		}
 
 		template<typename NodeT = node_type, typename EdgeT = chedge_type, typename std::enable_if<can_read<NodeT, EdgeT>::value>::type* = nullptr>
-		static GraphInData<NodeT, EdgeT> readGraph(std::istream& is)
+		static GraphInData<NodeT, EdgeT> readGraph(TextScanner& is, uint num_threads = 1)
 		{
 			Implementation impl(is);
 			NodeID nr_of_nodes = 0;
@@ -50,36 +78,34 @@ namespace chc {
 			GraphInData<NodeT, EdgeT> result;
 			impl.readHeader(nr_of_nodes, nr_of_edges, result.meta_data);
 
-			result.nodes.reserve(nr_of_nodes);
-			result.edges.reserve(nr_of_edges);
-
 			Print("Number of nodes: " << nr_of_nodes);
 			Print("Number of edges: " << nr_of_edges);
 
-			for (NodeID i = 0; i < nr_of_nodes; ++i) {
-				result.nodes.push_back(static_cast<NodeT>(impl.readNode((NodeID) i)));
-			}
-			Print("Read all the nodes.");
+			std::vector<EdgeT> edges;
+			_readRecords(is, nr_of_nodes, nr_of_edges, num_threads, result.nodes, edges,
+				[](Implementation& impl, NodeID i) { return static_cast<NodeT>(impl.readNode(i)); },
+				[](Implementation& impl, EdgeID i) { return static_cast<EdgeT>(impl.readEdge(i)); });
 
-			for (EdgeID i = 0; i < nr_of_edges; ++i) {
-				auto edge = static_cast<EdgeT>(impl.readEdge((EdgeID) i));
+			result.edges.reserve(edges.size());
+			for (auto& edge: edges) {
+				EdgeID i(result.edges.size());
 				if (edge.src == edge.tgt) {
 					std::cerr << "WARNING: input contained loop edge (@" << i << "), dropped edge.\n";
-					--i; --nr_of_edges;
 					continue;
 				}
 				else if (edge.id == c::NO_EID) {
 					std::cerr << "WARNING: input contained edge with invalid id (@" << i << "), dropped edge.\n";
-					--i; --nr_of_edges;
 					continue;
 				}
 
+				edge.id = i;
 				result.edges.push_back(std::move(edge));
 			}
+			edges = std::vector<EdgeT>();
 			Print("Read all the edges.");
 
 			auto size_before(result.edges.size());
-			std::sort(result.edges.begin(), result.edges.end(), EdgeSortSrcTgtDist<EdgeT>());
+			radixSort(result.edges, EdgeSortSrcTgtDist<EdgeT>(), num_threads);
 			result.edges.erase(std::unique(result.edges.begin(), result.edges.end(),
 				equalEndpoints<EdgeT,EdgeT>), result.edges.end());
 			auto size_diff(size_before - result.edges.size());
@@ -97,15 +123,188 @@ namespace chc {
 		}
 
 		template<typename NodeT = node_type, typename EdgeT = chedge_type>
-		static GraphInData<NodeT, EdgeT> readGraph(std::string const& filename)
+		static GraphInData<NodeT, EdgeT> readGraph(std::istream& is, uint num_threads = 1)
+		{
+			TextScanner scanner(is);
+			return readGraph<NodeT, EdgeT>(scanner, num_threads);
+		}
+
+		template<typename NodeT = node_type, typename EdgeT = chedge_type>
+		static GraphInData<NodeT, EdgeT> readGraph(std::string const& filename, uint num_threads = 1)
+		{
+			TextScanner scanner(filename);
+			return readGraph<NodeT, EdgeT>(scanner, num_threads);
+		}
+
+		/*
+		 * Reading already contracted graphs (formats with CHNode<> and CHEdge<>):
+		 * node levels and shortcuts are kept as they are, edge ids are the
+		 * positions in the file.
+		 */
+		typedef typename MakeCHNode<node_type>::base_node_type base_node_type;
+
+		template<typename NodeT = base_node_type, typename EdgeT = chedge_type>
+		struct can_read_ch
+		{
+			typedef is_static_castable_t<base_node_type, NodeT> support_node;
+			typedef is_static_castable_t<edge_type, EdgeT> support_edge;
+
+			static constexpr bool value = support_node::value && support_edge::value;
+		};
+
+		template<typename NodeT = base_node_type, typename EdgeT = chedge_type, typename std::enable_if<!can_read_ch<NodeT, EdgeT>::value>::type* = nullptr>
+		static GraphCHInData<NodeT, EdgeT> readCHGraph(TextScanner& is, uint num_threads = 1)
+		{
+			Print("Can't read nodes / edges in this format");
+			std::abort();
+		}
+
+		template<typename NodeT = base_node_type, typename EdgeT = chedge_type, typename std::enable_if<can_read_ch<NodeT, EdgeT>::value>::type* = nullptr>
+		static GraphCHInData<NodeT, EdgeT> readCHGraph(TextScanner& is, uint num_threads = 1)
+		{
+			Implementation impl(is);
+			NodeID nr_of_nodes = 0;
+			EdgeID nr_of_edges = 0;
+			GraphCHInData<NodeT, EdgeT> result;
+			impl.readHeader(nr_of_nodes, nr_of_edges, result.meta_data);
+
+			Print("Number of nodes: " << nr_of_nodes);
+			Print("Number of edges: " << nr_of_edges);
+
+			std::vector<std::pair<NodeT, uint>> nodes;
+			_readRecords(is, nr_of_nodes, nr_of_edges, num_threads, nodes, result.edges,
+				[](Implementation& impl, NodeID i) {
+					auto const node = impl.readNode(i);
+					return std::make_pair(static_cast<NodeT>(static_cast<base_node_type const&>(node)), uint(node.lvl));
+				},
+				[nr_of_edges](Implementation& impl, EdgeID i) {
+					auto const in_edge = impl.readEdge(i);
+					if (in_edge.child_edge1 != c::NO_EID && (in_edge.child_edge1 >= nr_of_edges || in_edge.child_edge2 >= nr_of_edges)) {
+						std::cerr << "FATAL_ERROR: Invalid child edge of shortcut (@" << i << "). Exiting\n";
+						std::abort();
+					}
+
+					EdgeT edge(static_cast<EdgeT>(in_edge));
+					copyShortcutData(edge, in_edge);
+					edge.id = i;
+					return edge;
+				});
+			Print("Read all the edges.");
+
+			result.nodes.reserve(nodes.size());
+			result.node_levels.reserve(nodes.size());
+			for (auto& node: nodes) {
+				result.nodes.push_back(std::move(node.first));
+				result.node_levels.push_back(node.second);
+			}
+
+			/* center nodes are not stored in the files */
+			for (auto& edge: result.edges) {
+				if (edge.child_edge1 != c::NO_EID) {
+					edge.center_node = result.edges[edge.child_edge1].tgt;
+				}
+			}
+
+			return result;
+		}
+
+		template<typename NodeT = base_node_type, typename EdgeT = chedge_type>
+		static GraphCHInData<NodeT, EdgeT> readCHGraph(std::istream& is, uint num_threads = 1)
+		{
+			TextScanner scanner(is);
+			return readCHGraph<NodeT, EdgeT>(scanner, num_threads);
+		}
+
+		template<typename NodeT = base_node_type, typename EdgeT = chedge_type>
+		static GraphCHInData<NodeT, EdgeT> readCHGraph(std::string const& filename, uint num_threads = 1)
 		{
-			std::ifstream is(filename);
-			if (!is.is_open()) {
-				std::cerr << "FATAL_ERROR: Couldn't open graph file \'" <<
-					filename << "\'. Exiting." << std::endl;
+			TextScanner scanner(filename);
+			return readCHGraph<NodeT, EdgeT>(scanner, num_threads);
+		}
+
+	private:
+		/*
+		 * Reads the nr_of_nodes node records and nr_of_edges edge records
+		 * following the header with read_node(impl, node_id) and
+		 * read_edge(impl, edge_id).
+		 *
+		 * With more than one thread the rest of the input is split into line
+		 * aligned chunks, which are parsed in parallel by their own
+		 * Implementation; this needs every record on its own line (blank lines
+		 * are skipped). The chunks are counted first, so every record still
+		 * gets its index from the position in the file.
+		 */
+		template<typename NodeResult, typename EdgeResult, typename ReadNode, typename ReadEdge>
+		static void _readRecords(TextScanner& is, NodeID nr_of_nodes, EdgeID nr_of_edges, uint num_threads,
+				std::vector<NodeResult>& nodes, std::vector<EdgeResult>& edges,
+				ReadNode read_node, ReadEdge read_edge)
+		{
+			nodes.reserve(nr_of_nodes);
+			edges.reserve(nr_of_edges);
+
+			if (num_threads <= 1) {
+				Implementation impl(is);
+				for (NodeID i = 0; i < nr_of_nodes; ++i) {
+					nodes.push_back(read_node(impl, i));
+				}
+				Print("Read all the nodes.");
+				for (EdgeID i = 0; i < nr_of_edges; ++i) {
+					edges.push_back(read_edge(impl, i));
+				}
+				return;
+			}
+
+			/* small chunks don't pay off */
+			size_t const min_chunk_size(1 << 16);
+			size_t const nr_of_records(size_t(nr_of_nodes) + nr_of_edges);
+
+			/* compressed input arrives in blocks, everything else is one block */
+			size_t next_record(0);
+			do {
+				size_t nr_of_chunks(std::min<size_t>(num_threads * 4, (is.end() - is.current()) / min_chunk_size + 1));
+				auto borders(TextScanner::splitLines(is.current(), is.end(), nr_of_chunks));
+				nr_of_chunks = borders.size() - 1;
+
+				/* index of the first record in each chunk */
+				std::vector<size_t> first_record(nr_of_chunks + 1, 0);
+				#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+				for (size_t k = 0; k < nr_of_chunks; k++) {
+					first_record[k + 1] = TextScanner::countNonBlankLines(borders[k], borders[k + 1]);
+				}
+				first_record[0] = next_record;
+				for (size_t k = 0; k < nr_of_chunks; k++) {
+					first_record[k + 1] += first_record[k];
+				}
+				next_record = first_record[nr_of_chunks];
+
+				std::vector<std::vector<NodeResult>> chunk_nodes(nr_of_chunks);
+				std::vector<std::vector<EdgeResult>> chunk_edges(nr_of_chunks);
+				#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+				for (size_t k = 0; k < nr_of_chunks; k++) {
+					TextScanner chunk(borders[k], borders[k + 1]);
+					Implementation impl(chunk);
+					size_t end(std::min(first_record[k + 1], nr_of_records));
+					for (size_t r = first_record[k]; r < end; r++) {
+						if (r < nr_of_nodes) {
+							chunk_nodes[k].push_back(read_node(impl, NodeID(r)));
+						}
+						else {
+							chunk_edges[k].push_back(read_edge(impl, EdgeID(r - nr_of_nodes)));
+						}
+					}
+				}
+
+				for (size_t k = 0; k < nr_of_chunks; k++) {
+					std::move(chunk_nodes[k].begin(), chunk_nodes[k].end(), std::back_inserter(nodes));
+					std::move(chunk_edges[k].begin(), chunk_edges[k].end(), std::back_inserter(edges));
+				}
+			} while (next_record < nr_of_records && is.nextBlock());
+
+			if (next_record < nr_of_records) {
+				std::cerr << "FATAL_ERROR: end of file\n";
 				std::abort();
 			}
-			return readGraph<NodeT, EdgeT>(is);
+			Print("Read all the nodes.");
 		}
 	};
 
@@ -121,14 +320,14 @@ namespace chc {
 		using can_write = writer_can_write<SimpleWriter, NodeT, EdgeT>;
 
 		template<typename NodeT, typename EdgeT, typename std::enable_if<!can_write<NodeT, EdgeT>::value>::type* = nullptr>
-		static void writeGraph(std::ostream&, GraphOutData<NodeT, EdgeT> const&)
+		static void writeGraph(std::ostream&, GraphOutData<NodeT, EdgeT> const&, uint = 1)
 		{
 			Print("Can't export nodes / edges in this format");
 			std::abort();
 		}
 
 		template<typename NodeT, typename EdgeT, typename std::enable_if<can_write<NodeT, EdgeT>::value>::type* = nullptr>
-		static void writeGraph(std::ostream& os, GraphOutData<NodeT, EdgeT> const& data)
+		static void writeGraph(std::ostream& os, GraphOutData<NodeT, EdgeT> const& data, uint num_threads = 1)
 		{
 			NodeID nr_of_nodes(data.nodes.size());
 			EdgeID nr_of_edges(data.edges.size());
@@ -139,30 +338,28 @@ namespace chc {
 
 			impl.writeHeader(nr_of_nodes, nr_of_edges, data.meta_data);
 
-			NodeID node_id = 0;
-			for (auto const& node: data.nodes) {
-				impl.writeNode(static_cast<node_type>(node), (NodeID) node_id);
-				++node_id;
-			}
+			AsyncWriter writer(os);
+			_writeRecords(writer, nr_of_nodes, num_threads, [&data](Implementation& impl, NodeID node_id) {
+				impl.writeNode(static_cast<node_type>(data.nodes[node_id]), node_id);
+			});
 			Print("Exported all nodes.");
 
-			EdgeID edge_id = 0;
-			for (auto const& edge: data.edges) {
-				impl.writeEdge(static_cast<edge_type>(edge), (EdgeID) edge_id);
-				++edge_id;
-			}
+			_writeRecords(writer, nr_of_edges, num_threads, [&data](Implementation& impl, EdgeID edge_id) {
+				impl.writeEdge(static_cast<edge_type>(data.edges[edge_id]), edge_id);
+			});
+			writer.finish();
 			Print("Exported all edges.");
 		}
 
 		template<typename NodeT, typename EdgeT, typename std::enable_if<!can_write<NodeT, EdgeT>::value>::type* = nullptr>
-		static void writeCHGraph(std::ostream&, GraphCHOutData<NodeT, EdgeT> const&)
+		static void writeCHGraph(std::ostream&, GraphCHOutData<NodeT, EdgeT> const&, uint = 1)
 		{
 			Print("Can't export nodes / edges in this format");
 			std::abort();
 		}
 
 		template<typename NodeT, typename EdgeT, typename std::enable_if<can_write<NodeT, EdgeT>::value>::type* = nullptr>
-		static void writeCHGraph(std::ostream& os, GraphCHOutData<NodeT, EdgeT> const& data)
+		static void writeCHGraph(std::ostream& os, GraphCHOutData<NodeT, EdgeT> const& data, uint num_threads = 1)
 		{
 			NodeID nr_of_nodes(data.nodes.size());
 			EdgeID nr_of_edges(data.edges.size());
@@ -173,20 +370,58 @@ namespace chc {
 
 			impl.writeHeader(nr_of_nodes, nr_of_edges, data.meta_data);
 
-			NodeID node_id = 0;
-			for (auto const& node: data.nodes) {
-				impl.writeNode(static_cast<node_type>(makeCHNode(node, data.node_levels[node_id])), (NodeID) node_id);
-				++node_id;
-			}
+			AsyncWriter writer(os);
+			_writeRecords(writer, nr_of_nodes, num_threads, [&data](Implementation& impl, NodeID node_id) {
+				node_type out(static_cast<node_type>(makeCHNode(data.nodes[node_id], data.node_levels[node_id])));
+				setNodeLevel(out, data.node_levels[node_id]);
+				impl.writeNode(out, node_id);
+			});
 			Print("Exported all nodes.");
 
-			EdgeID edge_id = 0;
-			for (auto const& edge: data.edges) {
-				impl.writeEdge(static_cast<edge_type>(edge), (EdgeID) edge_id);
-				++edge_id;
-			}
+			_writeRecords(writer, nr_of_edges, num_threads, [&data](Implementation& impl, EdgeID edge_id) {
+				edge_type out(static_cast<edge_type>(data.edges[edge_id]));
+				copyShortcutData(out, data.edges[edge_id]);
+				impl.writeEdge(out, edge_id);
+			});
+			writer.finish();
 			Print("Exported all edges.");
 		}
+
+	private:
+		/*
+		 * Formats the records [0, nr_of_records) with write_record(impl, i)
+		 * and hands them to writer in order. Blocks of records are formatted
+		 * into their own buffers by parallel workers, while the writer thread
+		 * is still writing the previous blocks.
+		 */
+		template<typename WriteRecord>
+		static void _writeRecords(AsyncWriter& writer, size_t nr_of_records, uint num_threads, WriteRecord write_record)
+		{
+			size_t const block_size(1 << 14);
+			size_t const blocks_per_batch(std::max<uint>(num_threads, 1) * 2);
+
+			std::vector<std::string> buffers(blocks_per_batch);
+			for (size_t batch_begin(0); batch_begin < nr_of_records; batch_begin += block_size * blocks_per_batch) {
+				size_t nr_of_blocks(std::min(blocks_per_batch, (nr_of_records - batch_begin + block_size - 1) / block_size));
+
+				#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+				for (size_t k = 0; k < nr_of_blocks; k++) {
+					size_t begin(batch_begin + k * block_size);
+					size_t end(std::min(begin + block_size, nr_of_records));
+
+					std::ostringstream os;
+					Implementation impl(os);
+					for (size_t i(begin); i < end; i++) {
+						write_record(impl, i);
+					}
+					buffers[k] = os.str();
+				}
+
+				for (size_t k(0); k < nr_of_blocks; k++) {
+					writer.push(std::move(buffers[k]));
+				}
+			}
+		}
 	};
 
 }
@@ -3,6 +3,7 @@
 #include "defs.h"
 #include "nodes_and_edges.h"
 #include "indexed_container.h"
+#include "radix_sort.h"
 
 #include <vector>
 #include <algorithm>
@@ -25,19 +26,35 @@ class Graph
 
 		std::vector<NodeT> _nodes;
 
-		std::vector<uint> _out_offsets;
-		std::vector<uint> _in_offsets;
+		std::vector<EdgeID> _out_offsets;
+		std::vector<EdgeID> _in_offsets;
 		std::vector<EdgeT> _out_edges;
-		std::vector<EdgeT> _in_edges;
+		/* Indices into _out_edges, in the order of InEdgeSort. */
+		std::vector<EdgeID> _in_edges;
 
 		/* Maps edge id to index in the _out_edge vector. */
-		std::vector<uint> _id_to_index;
+		std::vector<EdgeID> _id_to_index;
+
+		/*
+		 * Other node and distance of the edges, per EdgeType, in the
+		 * order of nodeEdges() (see nodeAdjacency()); 8 bytes per edge and
+		 * direction. Only the OUT arrays are built (for Dijkstra), unless
+		 * _with_in_adjacency is set (CHGraph, for the witness searches in
+		 * both directions).
+		 */
+		std::vector<NodeID> _adjacent_nodes[2];
+		std::vector<uint> _adjacent_dists[2];
+		bool _with_in_adjacency = false;
 
 		EdgeID edge_count = 0;
 
-		void sortInEdges();
+		/* threads used for sorting the edges */
+		uint _num_threads = 1;
+
 		void sortOutEdges();
 		void initOffsets();
+		void initInEdges();
+		void initAdjacency();
 		void initIdToIndex();
 
 		void update();
@@ -55,12 +72,14 @@ class Graph
 		 * the edges according to OutEdgeSort and InEdgeSort. */
 		void init(GraphInData<NodeT,EdgeT>&& data);
 
+		void setNrOfThreads(uint num_threads) { _num_threads = num_threads; }
+
 		void printInfo() const;
 		template<typename Range>
 		void printInfo(Range&& nodes) const;
 
-		uint getNrOfNodes() const { return _nodes.size(); }
-		uint getNrOfEdges() const { return _out_edges.size(); }
+		NodeID getNrOfNodes() const { return _nodes.size(); }
+		EdgeID getNrOfEdges() const { return _out_edges.size(); }
 		Metadata const& getMetadata() const { return _meta_data; }
 		EdgeT const& getEdge(EdgeID edge_id) const;
 		NodeT const& getNode(NodeID node_id) const;
@@ -68,9 +87,24 @@ class Graph
 		uint getNrOfEdges(NodeID node_id) const;
 		uint getNrOfEdges(NodeID node_id, EdgeType type) const;
 
-		typedef range<typename std::vector<EdgeT>::const_iterator> node_edges_range;
+		typedef range<indirect_iterator<EdgeT, EdgeID>> node_edges_range;
 		node_edges_range nodeEdges(NodeID node_id, EdgeType type) const;
 
+		/* Structure-of-arrays view of nodeEdges(), e.g. for StampedLabels::relax(); IN only for CHGraph */
+		struct node_adjacency
+		{
+			NodeID const* nodes;
+			uint const* dists;
+			uint size;
+
+			EdgeT const* _edges;
+			EdgeID const* _indices;
+			EdgeID _first;
+
+			EdgeT const& edge(uint i) const { return _edges[_indices ? _indices[_first + i] : _first + i]; }
+		};
+		node_adjacency nodeAdjacency(NodeID node_id, EdgeType type) const;
+
 		friend void unit_tests::testGraph();
 };
 
@@ -84,7 +118,6 @@ void Graph<NodeT, EdgeT>::init(GraphInData<NodeT, EdgeT>&& data)
 	_meta_data.swap(data.meta_data);
 	_nodes.swap(data.nodes);
 	_out_edges.swap(data.edges);
-	_in_edges = _out_edges;
 	edge_count = _out_edges.size();
 
 	update();
@@ -156,21 +189,12 @@ void Graph<NodeT, EdgeT>::printInfo(Range&& nodes) const
 #endif
 }
 
-template <typename NodeT, typename EdgeT>
-void Graph<NodeT, EdgeT>::sortInEdges()
-{
-	Debug("Sort the incomming edges.");
-
-	std::sort(_in_edges.begin(), _in_edges.end(), InEdgeSort());
-	debug_assert(std::is_sorted(_in_edges.begin(), _in_edges.end(), InEdgeSort()));
-}
-
 template <typename NodeT, typename EdgeT>
 void Graph<NodeT, EdgeT>::sortOutEdges()
 {
 	Debug("Sort the outgoing edges.");
 
-	std::sort(_out_edges.begin(), _out_edges.end(), OutEdgeSort());
+	radixSort(_out_edges, OutEdgeSort(), _num_threads);
 	debug_assert(std::is_sorted(_out_edges.begin(), _out_edges.end(), OutEdgeSort()));
 }
 
@@ -179,21 +203,20 @@ void Graph<NodeT, EdgeT>::initOffsets()
 {
 	Debug("Init the offsets.");
 	debug_assert(std::is_sorted(_out_edges.begin(), _out_edges.end(), OutEdgeSort()));
-	debug_assert(std::is_sorted(_in_edges.begin(), _in_edges.end(), InEdgeSort()));
 
-	uint nr_of_nodes(_nodes.size());
+	NodeID nr_of_nodes(_nodes.size());
 
 	_out_offsets.assign(nr_of_nodes + 1, 0);
 	_in_offsets.assign(nr_of_nodes + 1, 0);
 
-	/* assume "valid" edges are in _out_edges and _in_edges */
+	/* assume "valid" edges are in _out_edges */
 	for (auto const& edge: _out_edges) {
 		_out_offsets[edge.src]++;
 		_in_offsets[edge.tgt]++;
 	}
 
-	uint out_sum(0);
-	uint in_sum(0);
+	EdgeID out_sum(0);
+	EdgeID in_sum(0);
 	for (NodeID i(0); i<nr_of_nodes; i++) {
 		auto old_out_sum = out_sum, old_in_sum = in_sum;
 		out_sum += _out_offsets[i];
@@ -202,18 +225,57 @@ void Graph<NodeT, EdgeT>::initOffsets()
 		_in_offsets[i] = old_in_sum;
 	}
 	assert(out_sum == _out_edges.size());
-	assert(in_sum == _in_edges.size());
+	assert(in_sum == _out_edges.size());
 	_out_offsets[nr_of_nodes] = out_sum;
 	_in_offsets[nr_of_nodes] = in_sum;
 }
 
+template <typename NodeT, typename EdgeT>
+void Graph<NodeT, EdgeT>::initInEdges()
+{
+	Debug("Init the incoming edges.");
+
+	/* _out_edges are sorted by src, so distributing them by tgt
+	 * (stable, in one pass) sorts them by (tgt, src) */
+	std::vector<EdgeID> next(_in_offsets.begin(), _in_offsets.end() - 1);
+	_in_edges.resize(_out_edges.size());
+	for (EdgeID i(0), size(_out_edges.size()); i<size; i++) {
+		_in_edges[next[_out_edges[i].tgt]++] = i;
+	}
+	debug_assert(std::is_sorted(
+		indirect_iterator<EdgeT, EdgeID>(_out_edges.data(), _in_edges.data(), 0),
+		indirect_iterator<EdgeT, EdgeID>(_out_edges.data(), _in_edges.data(), _in_edges.size()),
+		InEdgeSort()));
+}
+
+template <typename NodeT, typename EdgeT>
+void Graph<NodeT, EdgeT>::initAdjacency()
+{
+	Debug("Init the adjacency arrays.");
+
+	for (auto type: {EdgeType::OUT, EdgeType::IN}) {
+		if (type == EdgeType::IN && !_with_in_adjacency) continue;
+		auto& nodes(_adjacent_nodes[from_enum(type)]);
+		auto& dists(_adjacent_dists[from_enum(type)]);
+		nodes.resize(_out_edges.size());
+		dists.resize(_out_edges.size());
+
+		#pragma omp parallel for num_threads(_num_threads) schedule(static)
+		for (EdgeID i = 0; i < _out_edges.size(); i++) {
+			EdgeT const& edge(_out_edges[type == EdgeType::OUT ? i : _in_edges[i]]);
+			nodes[i] = otherNode(edge, type);
+			dists[i] = edge.distance();
+		}
+	}
+}
+
 template <typename NodeT, typename EdgeT>
 void Graph<NodeT, EdgeT>::initIdToIndex()
 {
 	Debug("Renew the index mapper.");
 
 	_id_to_index.resize(edge_count);
-	for (uint i(0), size(_out_edges.size()); i<size; i++) {
+	for (EdgeID i(0), size(_out_edges.size()); i<size; i++) {
 		_id_to_index[_out_edges[i].id] = i;
 	}
 }
@@ -222,8 +284,9 @@ template <typename NodeT, typename EdgeT>
 void Graph<NodeT, EdgeT>::update()
 {
 	sortOutEdges();
-	sortInEdges();
 	initOffsets();
+	initInEdges();
+	initAdjacency();
 	initIdToIndex();
 
 	_is_dirty = false;
@@ -264,11 +327,29 @@ uint Graph<NodeT, EdgeT>::getNrOfEdges(NodeID node_id, EdgeType type) const
 
 template <typename NodeT, typename EdgeT>
 auto Graph<NodeT, EdgeT>::nodeEdges(NodeID node_id, EdgeType type) const -> node_edges_range {
+	typedef typename node_edges_range::iterator iterator;
 	if (EdgeType::OUT == type) {
-		return node_edges_range(_out_edges.begin() + _out_offsets[node_id], _out_edges.begin() + _out_offsets[node_id+1]);
+		return node_edges_range(iterator(_out_edges.data(), nullptr, _out_offsets[node_id]),
+			iterator(_out_edges.data(), nullptr, _out_offsets[node_id+1]));
 	} else {
-		return node_edges_range(_in_edges.begin() + _in_offsets[node_id], _in_edges.begin() + _in_offsets[node_id+1]);
+		return node_edges_range(iterator(_out_edges.data(), _in_edges.data(), _in_offsets[node_id]),
+			iterator(_out_edges.data(), _in_edges.data(), _in_offsets[node_id+1]));
 	}
 }
 
+template <typename NodeT, typename EdgeT>
+auto Graph<NodeT, EdgeT>::nodeAdjacency(NodeID node_id, EdgeType type) const -> node_adjacency {
+	debug_assert(type == EdgeType::OUT || _with_in_adjacency);
+	auto const& offsets(EdgeType::OUT == type ? _out_offsets : _in_offsets);
+	EdgeID first(offsets[node_id]);
+	return node_adjacency {
+		_adjacent_nodes[from_enum(type)].data() + first,
+		_adjacent_dists[from_enum(type)].data() + first,
+		uint(offsets[node_id+1] - first),
+		_out_edges.data(),
+		EdgeType::OUT == type ? nullptr : _in_edges.data(),
+		first
+	};
+}
+
 }
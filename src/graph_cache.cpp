@@ -0,0 +1,175 @@
+#include "graph_cache.h"
+#include "binary_format.h"
+#include "compression.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace chc
+{
+
+namespace GraphCache
+{
+	namespace
+	{
+		/* prefix of the meta data entries holding the key */
+		std::string const KEY_PREFIX("chc_cache_");
+
+		uint64_t const PRIME1(0x9E3779B185EBCA87ull);
+		uint64_t const PRIME2(0xC2B2AE3D27D4EB4Full);
+
+		uint64_t rotl(uint64_t x, int r)
+		{
+			return (x << r) | (x >> (64 - r));
+		}
+
+		uint64_t mixWord(uint64_t lane, uint64_t word)
+		{
+			return rotl(lane + word * PRIME2, 31) * PRIME1;
+		}
+
+		uint64_t finalize(uint64_t h)
+		{
+			h ^= h >> 33;
+			h *= PRIME2;
+			h ^= h >> 29;
+			h *= PRIME1;
+			h ^= h >> 32;
+			return h;
+		}
+
+		/* four independent lanes, so the multiplications can overlap */
+		uint64_t hashBuffer(char const* data, size_t size)
+		{
+			uint64_t lanes[4] = { PRIME1, PRIME2, 0, uint64_t(0) - PRIME1 };
+			size_t pos(0);
+			for (; pos + 32 <= size; pos += 32) {
+				uint64_t words[4];
+				std::memcpy(words, data + pos, sizeof(words));
+				for (int i(0); i<4; i++) lanes[i] = mixWord(lanes[i], words[i]);
+			}
+
+			uint64_t h(rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18));
+			for (; pos < size; pos++) {
+				h = mixWord(h, (unsigned char) data[pos]);
+			}
+			return finalize(h ^ size);
+		}
+
+		std::string toHex(uint64_t value)
+		{
+			std::ostringstream os;
+			os << std::hex << std::setw(16) << std::setfill('0') << value;
+			return os.str();
+		}
+	}
+
+	std::string cacheFilename(std::string const& filename)
+	{
+		return filename + ".chc_cache";
+	}
+
+	std::string createTempFile(std::string const& cache_filename)
+	{
+		std::string const pattern(cache_filename + ".XXXXXX");
+		std::vector<char> name(pattern.begin(), pattern.end());
+		name.push_back('\0');
+		int fd(mkstemp(name.data()));
+		if (fd < 0) return "";
+
+		/* mkstemp() creates the file for the owner only; caches get the usual permissions */
+		mode_t mask(umask(0));
+		umask(mask);
+		fchmod(fd, 0666 & ~mask);
+		close(fd);
+		return name.data();
+	}
+
+	uint64_t hashFile(std::string const& filename)
+	{
+		int fd(open(filename.c_str(), O_RDONLY));
+		if (fd < 0) {
+			std::cerr << "FATAL_ERROR: Couldn't open graph file \'" <<
+				filename << "\'. Exiting." << std::endl;
+			std::abort();
+		}
+
+		struct stat st;
+		uint64_t hash(0);
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void* data(mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+			if (data == MAP_FAILED) {
+				close(fd);
+				std::cerr << "FATAL_ERROR: Couldn't map graph file \'" <<
+					filename << "\'. Exiting." << std::endl;
+				std::abort();
+			}
+			madvise(data, st.st_size, MADV_SEQUENTIAL);
+			hash = hashBuffer(static_cast<char const*>(data), st.st_size);
+			munmap(data, st.st_size);
+		}
+		else {
+			hash = hashBuffer(nullptr, 0);
+		}
+		close(fd);
+		return hash;
+	}
+
+	Metadata sourceKey(std::string const& filename, std::string const& format)
+	{
+		struct stat st;
+		if (stat(filename.c_str(), &st) != 0) {
+			std::cerr << "FATAL_ERROR: Couldn't open graph file \'" <<
+				filename << "\'. Exiting." << std::endl;
+			std::abort();
+		}
+
+		Metadata key;
+		key[KEY_PREFIX + "version"] = std::to_string(VERSION);
+		key[KEY_PREFIX + "format"] = format;
+		key[KEY_PREFIX + "size"] = std::to_string(st.st_size);
+		key[KEY_PREFIX + "mtime"] = std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec);
+		key[KEY_PREFIX + "hash"] = toHex(hashFile(filename));
+		return key;
+	}
+
+	bool isValid(std::string const& cache_filename, Metadata const& key)
+	{
+		Metadata meta_data;
+		if (!FormatBinary::readMetadata(cache_filename, meta_data)) return false;
+
+		for (auto const& entry: key) {
+			auto it(meta_data.find(entry.first));
+			if (it == meta_data.end() || it->second != entry.second) return false;
+		}
+		return true;
+	}
+
+	Metadata withKey(Metadata const& meta_data, Metadata const& key)
+	{
+		Metadata result(meta_data);
+		for (auto const& entry: key) {
+			result[entry.first] = entry.second;
+		}
+		return result;
+	}
+
+	Metadata withoutKey(Metadata const& meta_data)
+	{
+		Metadata result;
+		for (auto const& entry: meta_data) {
+			if (entry.first.compare(0, KEY_PREFIX.size(), KEY_PREFIX) != 0) result.insert(entry);
+		}
+		return result;
+	}
+}
+
+}
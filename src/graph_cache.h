@@ -0,0 +1,47 @@
+#pragma once
+
+#include "nodes_and_edges.h"
+
+#include <cstdint>
+#include <string>
+
+namespace chc
+{
+
+namespace unit_tests
+{
+	void testGraphCache();
+}
+
+/*
+ * Opt-in cache of parsed (and deduplicated) text graphs: the result of
+ * reading a file is stored as BINARY graph next to it, in
+ * cacheFilename(filename), and later reads load that file instead of
+ * parsing again.
+ *
+ * A cache is only used if its meta data matches the key of the source
+ * file: size, mtime, a hash of the whole content and the input format.
+ */
+namespace GraphCache
+{
+	/* bump if parsing changes, to invalidate existing caches */
+	static constexpr uint32_t VERSION = 1;
+
+	std::string cacheFilename(std::string const& filename);
+	/* creates a new, uniquely named file in the directory of cache_filename; "" on failure */
+	std::string createTempFile(std::string const& cache_filename);
+
+	/* the key of the current state of filename, as meta data entries */
+	Metadata sourceKey(std::string const& filename, std::string const& format);
+	/* true if cache_filename is a cache built from the source described by key */
+	bool isValid(std::string const& cache_filename, Metadata const& key);
+
+	/* adds the key to the meta data of the graph / removes it again */
+	Metadata withKey(Metadata const& meta_data, Metadata const& key);
+	Metadata withoutKey(Metadata const& meta_data);
+
+	/* fast non-cryptographic 64 bit hash of the whole file */
+	uint64_t hashFile(std::string const& filename);
+}
+
+}
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <algorithm>
+#include <cstddef>
 #include <functional>
+#include <iterator>
+#include <numeric>
 #include <vector>
 
 namespace chc {
@@ -57,6 +60,34 @@ namespace chc {
 		auto operator-(counting_iterator const& rhs) const -> decltype(m_it - rhs.m_it) { return m_it - rhs.m_it; }
 	};
 
+	/* iterates over elements[indices[i]], or over elements[i] if indices is null */
+	template<typename T, typename Index>
+	class indirect_iterator : public std::iterator<std::forward_iterator_tag, T const>
+	{
+		typedef std::iterator<std::forward_iterator_tag, T const> base_iterator;
+	private:
+		T const* m_elements;
+		Index const* m_indices;
+		std::size_t m_pos;
+
+	public:
+		using typename base_iterator::reference;
+		using typename base_iterator::pointer;
+
+		indirect_iterator() { }
+		indirect_iterator(T const* elements, Index const* indices, std::size_t pos)
+		: m_elements(elements), m_indices(indices), m_pos(pos) { }
+
+		reference operator*() const { return m_elements[m_indices ? m_indices[m_pos] : m_pos]; }
+		pointer operator->() const { return &**this; }
+		indirect_iterator& operator++() { ++m_pos; return *this; }
+		indirect_iterator operator++(int) { return indirect_iterator(m_elements, m_indices, m_pos++); }
+		bool operator==(const indirect_iterator& rhs) const { return m_pos == rhs.m_pos; }
+		bool operator!=(const indirect_iterator& rhs) const { return m_pos != rhs.m_pos; }
+
+		std::ptrdiff_t operator-(indirect_iterator const& rhs) const { return m_pos - rhs.m_pos; }
+	};
+
 	/* only supports container with begin() and end() members; ADL begin() and end() not supported */
 	/* usage: for (auto const& it: counting_iteration(container)) */
 	template<typename Container>
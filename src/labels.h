@@ -0,0 +1,146 @@
+#pragma once
+
+#include "defs.h"
+#include "nodes_and_edges.h"
+
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#endif
+
+namespace chc
+{
+
+/*
+ * Per-node labels for repeated searches: every value is stored together
+ * with the epoch it was written in, and values from older epochs read as
+ * the default value. Resetting all labels only increments the epoch, so
+ * there is no need to remember (and walk) the touched nodes.
+ *
+ * When the 32-bit epoch wraps around, all stamps are cleared once.
+ */
+template <typename T>
+class StampedLabels
+{
+	private:
+		struct Entry
+		{
+			T value;
+			uint32_t stamp;
+		};
+
+		std::vector<Entry> _entries;
+		T _default = T();
+		uint32_t _epoch = 1;
+
+		template <typename Improved>
+		size_t _relaxBlocks(std::false_type, T, NodeID const*, T const*, size_t, Improved&) { return 0; }
+#if defined(__AVX2__)
+		/* relaxes blocks of 8 edges (32 bit node ids only); returns the number of edges done */
+		template <typename Improved>
+		size_t _relaxBlocks(std::true_type, T base, NodeID const* nodes, T const* dists, size_t size, Improved& improved)
+		{
+			static_assert(sizeof(Entry) == 8, "entries are gathered as two 32 bit values");
+			/* the gather indices are signed */
+			if (_entries.size() > size_t(INT32_MAX)) return 0;
+
+			int const* entries(reinterpret_cast<int const*>(_entries.data()));
+			__m256i const base_v(_mm256_set1_epi32(base));
+			__m256i const epoch_v(_mm256_set1_epi32(_epoch));
+			__m256i const default_v(_mm256_set1_epi32(_default));
+
+			size_t i(0);
+			for (; i + 8 <= size; i += 8) {
+				__m256i node_v(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(nodes + i)));
+				__m256i new_v(_mm256_add_epi32(base_v, _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dists + i))));
+				__m256i value_v(_mm256_i32gather_epi32(entries, node_v, sizeof(Entry)));
+				__m256i stamp_v(_mm256_i32gather_epi32(entries + 1, node_v, sizeof(Entry)));
+				__m256i cur_v(_mm256_blendv_epi8(default_v, value_v, _mm256_cmpeq_epi32(stamp_v, epoch_v)));
+
+				/* lanes with min(new, cur) == cur are not improved */
+				__m256i not_improved(_mm256_cmpeq_epi32(_mm256_min_epu32(new_v, cur_v), cur_v));
+				uint mask(~_mm256_movemask_ps(_mm256_castsi256_ps(not_improved)) & 0xff);
+				while (mask) {
+					size_t j(i + __builtin_ctz(mask));
+					mask &= mask - 1;
+					/* check again, an earlier lane might have lowered the same label */
+					T new_dist(base + dists[j]);
+					if (new_dist < (*this)[nodes[j]]) {
+						set(nodes[j], new_dist);
+						improved(j, new_dist);
+					}
+				}
+			}
+			return i;
+		}
+#else
+		template <typename Improved>
+		size_t _relaxBlocks(std::true_type, T, NodeID const*, T const*, size_t, Improved&) { return 0; }
+#endif
+	public:
+		StampedLabels() { }
+		explicit StampedLabels(size_t size, T const& default_value)
+		{
+			assign(size, default_value);
+		}
+
+		/* resizes and resets all labels to default_value */
+		void assign(size_t size, T const& default_value)
+		{
+			_default = default_value;
+			_entries.assign(size, Entry { default_value, 0 });
+			_epoch = 1;
+		}
+
+		size_t size() const { return _entries.size(); }
+
+		T operator[](size_t i) const
+		{
+			Entry const& entry(_entries[i]);
+			return entry.stamp == _epoch ? entry.value : _default;
+		}
+
+		bool isSet(size_t i) const { return _entries[i].stamp == _epoch; }
+
+		void set(size_t i, T const& value)
+		{
+			_entries[i] = Entry { value, _epoch };
+		}
+
+		/*
+		 * Relaxes size edges from a node with label base: every label of
+		 * nodes[i] which is greater than base + dists[i] is lowered, and
+		 * improved(i, new_dist) is called (in order of i). Blocks of 8 edges
+		 * are compared with AVX2 if available.
+		 */
+		template <typename Improved>
+		void relax(T base, NodeID const* nodes, T const* dists, size_t size, Improved&& improved)
+		{
+			/* the node ids are loaded as 32 bit gather indices */
+			typedef std::integral_constant<bool, std::is_same<T, uint32_t>::value && sizeof(NodeID) == 4> UseBlocks;
+			size_t i(_relaxBlocks(UseBlocks(), base, nodes, dists, size, improved));
+			for (; i < size; i++) {
+				T new_dist(base + dists[i]);
+				if (new_dist < (*this)[nodes[i]]) {
+					set(nodes[i], new_dist);
+					improved(i, new_dist);
+				}
+			}
+		}
+
+		/* all labels return to the default value */
+		void reset()
+		{
+			if (++_epoch == 0) {
+				for (auto& entry: _entries) {
+					entry.stamp = 0;
+				}
+				_epoch = 1;
+			}
+		}
+};
+
+}
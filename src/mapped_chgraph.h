@@ -0,0 +1,127 @@
+#pragma once
+
+#include "binary_format.h"
+#include "indexed_container.h"
+
+#include <iterator>
+#include <string>
+
+namespace chc
+{
+
+/*
+ * Read-only CH backed directly by a memory mapped BINARY CH file: nothing
+ * is parsed or sorted when loading, and pages are only read from disk when
+ * a query touches them. The ids in the file are trusted unless verify_ids
+ * is given.
+ *
+ * Offers the parts of the CHGraph interface used by queries (CHDijkstra,
+ * CHQueryServer), but nodeEdges() only returns the upward edges of a node,
+ * as stored in the up-CSR of the file.
+ */
+class MappedCHGraph
+{
+	public:
+		/* edge as returned by getEdge() and nodeEdges(); edge ids are file positions */
+		struct MappedEdge : FormatBinary::BinaryEdge
+		{
+			EdgeID id;
+
+			MappedEdge(EdgeID id, FormatBinary::BinaryEdge const& edge)
+				: FormatBinary::BinaryEdge(edge), id(id) { }
+		};
+
+		class edge_iterator : public std::iterator<std::forward_iterator_tag, MappedEdge const>
+		{
+			private:
+				FormatBinary::BinaryEdge const* _edges;
+				EdgeID const* _pos;
+			public:
+				edge_iterator(FormatBinary::BinaryEdge const* edges, EdgeID const* pos)
+					: _edges(edges), _pos(pos) { }
+
+				MappedEdge operator*() const { return MappedEdge(*_pos, _edges[*_pos]); }
+				edge_iterator& operator++() { ++_pos; return *this; }
+				edge_iterator operator++(int) { return edge_iterator(_edges, _pos++); }
+				bool operator==(edge_iterator const& rhs) const { return _pos == rhs._pos; }
+				bool operator!=(edge_iterator const& rhs) const { return _pos != rhs._pos; }
+				std::ptrdiff_t operator-(edge_iterator const& rhs) const { return _pos - rhs._pos; }
+		};
+		typedef range<edge_iterator> node_edges_range;
+
+	private:
+		FormatBinary::MappedFile _file;
+
+		FormatBinary::BinaryEdge const* _edges;
+		uint32_t const* _node_levels;
+		EdgeID const* _up_offsets[2];
+		EdgeID const* _up_edges[2];
+	public:
+		/* verify_ids checks all ids in the file when opening it, which reads the whole file */
+		explicit MappedCHGraph(std::string const& filename, bool verify_ids = false);
+
+		NodeID getNrOfNodes() const { return _file.getNrOfNodes(); }
+		EdgeID getNrOfEdges() const { return _file.getNrOfEdges(); }
+		/* number of upward edges */
+		uint getNrOfEdges(NodeID node_id, EdgeType type) const;
+		Metadata getMetadata() const { return _file.metaData(); }
+
+		MappedEdge getEdge(EdgeID edge_id) const;
+		uint getNodeLevel(NodeID node_id) const { return _node_levels[node_id]; }
+
+		bool isUp(FormatBinary::BinaryEdge const& edge, EdgeType direction) const;
+
+		/* upward edges of node_id in direction type */
+		node_edges_range nodeEdges(NodeID node_id, EdgeType type) const;
+};
+
+inline MappedCHGraph::MappedCHGraph(std::string const& filename, bool verify_ids)
+	: _file(filename, verify_ids)
+{
+	using FormatBinary::SectionType;
+
+	if (!_file.isCH()) {
+		std::cerr << "FATAL_ERROR: '" << filename << "' doesn't contain a CH. Exiting." << std::endl;
+		std::abort();
+	}
+
+	_edges = _file.section<FormatBinary::BinaryEdge>(SectionType::EDGES);
+	_node_levels = _file.section<uint32_t>(SectionType::LEVELS);
+	_up_offsets[from_enum(EdgeType::OUT)] = _file.section<EdgeID>(SectionType::UP_OUT_OFFSETS);
+	_up_edges[from_enum(EdgeType::OUT)] = _file.section<EdgeID>(SectionType::UP_OUT_EDGES);
+	_up_offsets[from_enum(EdgeType::IN)] = _file.section<EdgeID>(SectionType::UP_IN_OFFSETS);
+	_up_edges[from_enum(EdgeType::IN)] = _file.section<EdgeID>(SectionType::UP_IN_EDGES);
+}
+
+inline uint MappedCHGraph::getNrOfEdges(NodeID node_id, EdgeType type) const
+{
+	EdgeID const* offsets(_up_offsets[from_enum(type)]);
+	return offsets[node_id + 1] - offsets[node_id];
+}
+
+inline auto MappedCHGraph::getEdge(EdgeID edge_id) const -> MappedEdge
+{
+	debug_assert(edge_id < getNrOfEdges());
+	return MappedEdge(edge_id, _edges[edge_id]);
+}
+
+inline bool MappedCHGraph::isUp(FormatBinary::BinaryEdge const& edge, EdgeType direction) const
+{
+	uint src_lvl = _node_levels[edge.src];
+	uint tgt_lvl = _node_levels[edge.tgt];
+
+	if (src_lvl > tgt_lvl) {
+		return direction == EdgeType::IN;
+	}
+	return src_lvl < tgt_lvl && direction == EdgeType::OUT;
+}
+
+inline auto MappedCHGraph::nodeEdges(NodeID node_id, EdgeType type) const -> node_edges_range
+{
+	EdgeID const* offsets(_up_offsets[from_enum(type)]);
+	EdgeID const* edges(_up_edges[from_enum(type)]);
+	return node_edges_range(edge_iterator(_edges, edges + offsets[node_id]),
+			edge_iterator(_edges, edges + offsets[node_id + 1]));
+}
+
+}
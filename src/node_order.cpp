@@ -0,0 +1,53 @@
+#include "node_order.h"
+#include "compression.h"
+
+#include <iostream>
+
+#include <utility>
+
+namespace chc
+{
+
+uint64_t hilbertIndex(uint32_t x, uint32_t y)
+{
+	uint64_t d(0);
+	for (uint32_t s(uint32_t(1) << 31); s > 0; s >>= 1) {
+		uint32_t rx((x & s) ? 1 : 0);
+		uint32_t ry((y & s) ? 1 : 0);
+		d += uint64_t(s) * s * ((3 * rx) ^ ry);
+
+		/* rotate the quadrant; only the lower bits are used from here on */
+		if (ry == 0) {
+			if (rx == 1) {
+				x = ~x;
+				y = ~y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return d;
+}
+
+std::vector<NodeID> inversePermutation(std::vector<NodeID> const& permutation)
+{
+	std::vector<NodeID> inverse(permutation.size());
+	for (NodeID i(0); i<permutation.size(); i++) {
+		inverse[permutation[i]] = i;
+	}
+	return inverse;
+}
+
+void writeNodeIds(std::string const& filename, std::vector<NodeID> const& ids)
+{
+	auto os(openGraphOutputFile(filename));
+	for (NodeID id: ids) {
+		*os << id << '\n';
+	}
+	closeGraphOutputFile(*os);
+	if (!*os) {
+		std::cerr << "FATAL_ERROR: Couldn't write node ids to \'" << filename << "\'. Exiting." << std::endl;
+		std::abort();
+	}
+}
+
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "defs.h"
+#include "nodes_and_edges.h"
+#include "radix_sort.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace chc
+{
+
+namespace unit_tests
+{
+	void testNodeOrder();
+}
+
+/*
+ * Renumbering of nodes for memory locality: nodes which are close in the
+ * graph get close ids, so searches (e.g. the witness searches of the
+ * contraction) touch fewer cache lines of the per node arrays and of the
+ * adjacency.
+ *
+ * An order is given as order[new id] = old id, a renumbering as
+ * new_ids[old id] = new id; one is the inverse of the other.
+ */
+
+/* position of (x, y) on a Hilbert curve through the 2^32 x 2^32 grid */
+uint64_t hilbertIndex(uint32_t x, uint32_t y);
+
+/* inverse permutation: order <-> new_ids */
+std::vector<NodeID> inversePermutation(std::vector<NodeID> const& permutation);
+
+/* nodes along a Hilbert curve over their lat / lon; empty if all nodes are at the same position */
+template <typename NodeT>
+std::vector<NodeID> hilbertOrder(std::vector<NodeT> const& nodes, uint num_threads)
+{
+	if (nodes.empty()) return std::vector<NodeID>();
+
+	double min_lat(nodes[0].lat), max_lat(nodes[0].lat);
+	double min_lon(nodes[0].lon), max_lon(nodes[0].lon);
+	for (auto const& node: nodes) {
+		min_lat = std::min(min_lat, node.lat);
+		max_lat = std::max(max_lat, node.lat);
+		min_lon = std::min(min_lon, node.lon);
+		max_lon = std::max(max_lon, node.lon);
+	}
+	if (min_lat == max_lat && min_lon == max_lon) return std::vector<NodeID>();
+
+	/* the same scale for both, to keep the shape of the area */
+	double const scale(double(std::numeric_limits<uint32_t>::max()) / std::max(max_lat - min_lat, max_lon - min_lon));
+	auto pairs(keyPairs(nodes, [min_lat, min_lon, scale](NodeT const& node) {
+		return hilbertIndex(uint32_t((node.lon - min_lon) * scale), uint32_t((node.lat - min_lat) * scale));
+	}, num_threads));
+	radixSortKeys(pairs, num_threads);
+
+	std::vector<NodeID> order(nodes.size());
+	for (NodeID i(0); i<order.size(); i++) {
+		order[i] = pairs[i].index;
+	}
+	return order;
+}
+
+/* nodes in breadth first order of the graph, ignoring edge directions */
+template <typename EdgeT>
+std::vector<NodeID> bfsOrder(NodeID nr_of_nodes, std::vector<EdgeT> const& edges)
+{
+	std::vector<EdgeID> offsets(nr_of_nodes + 1, 0);
+	for (auto const& edge: edges) {
+		offsets[edge.src + 1]++;
+		offsets[edge.tgt + 1]++;
+	}
+	for (NodeID i(0); i<nr_of_nodes; i++) {
+		offsets[i + 1] += offsets[i];
+	}
+	std::vector<NodeID> neighbours(offsets.back());
+	std::vector<EdgeID> next(offsets.begin(), offsets.end() - 1);
+	for (auto const& edge: edges) {
+		neighbours[next[edge.src]++] = edge.tgt;
+		neighbours[next[edge.tgt]++] = edge.src;
+	}
+
+	/* the order doubles as BFS queue */
+	std::vector<NodeID> order;
+	order.reserve(nr_of_nodes);
+	std::vector<bool> visited(nr_of_nodes, false);
+	for (NodeID root(0); root<nr_of_nodes; root++) {
+		if (visited[root]) continue;
+		visited[root] = true;
+		order.push_back(root);
+		for (size_t i(order.size() - 1); i<order.size(); i++) {
+			NodeID node(order[i]);
+			for (EdgeID j(offsets[node]); j<offsets[node + 1]; j++) {
+				if (!visited[neighbours[j]]) {
+					visited[neighbours[j]] = true;
+					order.push_back(neighbours[j]);
+				}
+			}
+		}
+	}
+	return order;
+}
+
+template <typename NodeT>
+auto _spatialOrder(std::vector<NodeT> const& nodes, uint num_threads, int)
+	-> decltype(nodes[0].lat + nodes[0].lon, std::vector<NodeID>())
+{
+	return hilbertOrder(nodes, num_threads);
+}
+
+template <typename NodeT>
+std::vector<NodeID> _spatialOrder(std::vector<NodeT> const&, uint, long)
+{
+	return std::vector<NodeID>();
+}
+
+/* Hilbert order for nodes with coordinates; empty otherwise */
+template <typename NodeT>
+std::vector<NodeID> spatialOrder(std::vector<NodeT> const& nodes, uint num_threads)
+{
+	return _spatialOrder(nodes, num_threads, 0);
+}
+
+/* Hilbert order for nodes with coordinates, BFS order otherwise */
+template <typename NodeT, typename EdgeT>
+std::vector<NodeID> localityOrder(std::vector<NodeT> const& nodes, std::vector<EdgeT> const& edges, uint num_threads)
+{
+	auto order(spatialOrder(nodes, num_threads));
+	return order.empty() ? bfsOrder(nodes.size(), edges) : order;
+}
+
+/*
+ * Nodes of a CH by descending level, in spatial order within a level (in
+ * id order without coordinates). The top of the hierarchy, where queries
+ * spend most of their time, gets the smallest ids.
+ */
+template <typename NodeT>
+std::vector<NodeID> levelOrder(std::vector<NodeT> const& nodes, std::vector<uint> const& node_levels, uint num_threads)
+{
+	assert(nodes.size() == node_levels.size());
+
+	auto order(spatialOrder(nodes, num_threads));
+	bool const spatial(!order.empty());
+	std::vector<KeyIndex> pairs(nodes.size());
+	#pragma omp parallel for num_threads(num_threads) schedule(static)
+	for (size_t i = 0; i < pairs.size(); i++) {
+		pairs[i].index = spatial ? order[i] : i;
+		pairs[i].key = ~node_levels[pairs[i].index];
+	}
+	/* stable, so the spatial order is kept within a level */
+	radixSortKeys(pairs, num_threads);
+
+	order.resize(nodes.size());
+	for (NodeID i(0); i<order.size(); i++) {
+		order[i] = pairs[i].index;
+	}
+	return order;
+}
+
+/* writes ids as text, one per line: the line of node i has ids[i] */
+void writeNodeIds(std::string const& filename, std::vector<NodeID> const& ids);
+
+template <typename EdgeT>
+inline void renumberCenterNode(EdgeT&, std::vector<NodeID> const&) { }
+template <typename EdgeT>
+inline void renumberCenterNode(CHEdge<EdgeT>& edge, std::vector<NodeID> const& new_ids)
+{
+	if (edge.center_node != c::NO_NID) edge.center_node = new_ids[edge.center_node];
+}
+
+/* values[new_ids[i]] = old values[i] */
+template <typename T>
+void permute(std::vector<T>& values, std::vector<NodeID> const& new_ids)
+{
+	assert(values.size() == new_ids.size());
+
+	std::vector<T> permuted(values.size());
+	for (NodeID i(0); i<values.size(); i++) {
+		permuted[new_ids[i]] = std::move(values[i]);
+	}
+	values.swap(permuted);
+}
+
+/* moves the nodes to their new ids and changes the edges accordingly; the edge order is kept */
+template <typename NodeT, typename EdgeT>
+void renumberNodes(std::vector<NodeT>& nodes, std::vector<EdgeT>& edges, std::vector<NodeID> const& new_ids, uint num_threads)
+{
+	permute(nodes, new_ids);
+	for (NodeID i(0); i<nodes.size(); i++) {
+		nodes[i].id = i;
+	}
+
+	#pragma omp parallel for num_threads(num_threads) schedule(static)
+	for (size_t i = 0; i < edges.size(); i++) {
+		edges[i].src = new_ids[edges[i].src];
+		edges[i].tgt = new_ids[edges[i].tgt];
+		renumberCenterNode(edges[i], new_ids);
+	}
+}
+
+}
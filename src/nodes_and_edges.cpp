@@ -2,28 +2,40 @@
 
 namespace chc
 {
+	Distance addDistances(Distance dist1, Distance dist2)
+	{
+		/* c::NO_EDGE_DIST is reserved, so the sum has to be smaller */
+		if (dist1 >= c::NO_EDGE_DIST - dist2) {
+			std::cerr << "FATAL_ERROR: Shortcut distance " << uint64_t(dist1) << " + " << uint64_t(dist2)
+				<< " doesn't fit into a " << 8 * sizeof(Distance) << " bit distance"
+				<< " (see CHC_DISTANCE_BITS). Exiting." << std::endl;
+			std::abort();
+		}
+		return dist1 + dist2;
+	}
+
 	Edge concat(Edge const& edge1, Edge const& edge2)
 	{
 		assert(edge1.tgt == edge2.src);
-		return Edge(c::NO_EID, edge1.src, edge2.tgt, edge1.dist + edge2.dist);
+		return Edge(c::NO_EID, edge1.src, edge2.tgt, addDistances(edge1.dist, edge2.dist));
 	}
 
 	OSMEdge concat(OSMEdge const& edge1, OSMEdge const& edge2)
 	{
 		assert(edge1.tgt == edge2.src);
-		return OSMEdge(c::NO_EID, edge1.src, edge2.tgt, edge1.dist + edge2.dist, 0, -1);
+		return OSMEdge(c::NO_EID, edge1.src, edge2.tgt, addDistances(edge1.dist, edge2.dist), 0, -1);
 	}
 
 	EuclOSMEdge concat(EuclOSMEdge const& edge1, EuclOSMEdge const& edge2)
 	{
 		assert(edge1.tgt == edge2.src);
-		return EuclOSMEdge(c::NO_EID, edge1.src, edge2.tgt, edge1.dist + edge2.dist, 0, -1,
-				edge1.eucl_dist + edge2.eucl_dist);
+		return EuclOSMEdge(c::NO_EID, edge1.src, edge2.tgt, addDistances(edge1.dist, edge2.dist), 0, -1,
+				addDistances(edge1.eucl_dist, edge2.eucl_dist));
 	}
 
 	StefanEdge concat(StefanEdge const& edge1, StefanEdge const& edge2)
 	{
 		assert(edge1.tgt == edge2.src);
-		return StefanEdge(c::NO_EID, edge1.src, edge2.tgt, edge1.dist + edge2.dist);
+		return StefanEdge(c::NO_EID, edge1.src, edge2.tgt, addDistances(edge1.dist, edge2.dist));
 	}
 }
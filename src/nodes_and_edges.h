@@ -9,6 +9,7 @@
 #include <limits>
 #include <map>
 #include <string>
+#include <cstdint>
 
 namespace chc
 {
@@ -18,16 +19,62 @@ namespace unit_tests
 	void testNodesAndEdges();
 }
 
-typedef uint NodeID;
-typedef uint EdgeID;
+/*
+ * Widths of ids and edge distances, chosen at configuration time (see the
+ * CHC_*_BITS options in CMakeLists.txt): 64 bit edge ids for graphs with
+ * more than 4G edges including shortcuts, 16 bit distances if all edge
+ * distances (also of shortcuts) fit.
+ * Distances of paths (labels of searches) are always computed as uint.
+ */
+#ifndef CHC_NODE_ID_BITS
+#define CHC_NODE_ID_BITS 32
+#endif
+#ifndef CHC_EDGE_ID_BITS
+#define CHC_EDGE_ID_BITS 32
+#endif
+#ifndef CHC_DISTANCE_BITS
+#define CHC_DISTANCE_BITS 32
+#endif
+
+#if CHC_NODE_ID_BITS == 32
+typedef uint32_t NodeID;
+#elif CHC_NODE_ID_BITS == 64
+typedef uint64_t NodeID;
+#else
+#error "CHC_NODE_ID_BITS has to be 32 or 64"
+#endif
+
+#if CHC_EDGE_ID_BITS == 32
+typedef uint32_t EdgeID;
+#elif CHC_EDGE_ID_BITS == 64
+typedef uint64_t EdgeID;
+#else
+#error "CHC_EDGE_ID_BITS has to be 32 or 64"
+#endif
+
+#if CHC_DISTANCE_BITS == 16
+typedef uint16_t Distance;
+#elif CHC_DISTANCE_BITS == 32
+typedef uint32_t Distance;
+#else
+#error "CHC_DISTANCE_BITS has to be 16 or 32"
+#endif
+
+static_assert(sizeof(Distance) <= sizeof(uint), "path distances are computed as uint");
+
 namespace c
 {
-	uint const NO_NID(std::numeric_limits<NodeID>::max());
-	uint const NO_EID(std::numeric_limits<EdgeID>::max());
+	NodeID const NO_NID(std::numeric_limits<NodeID>::max());
+	EdgeID const NO_EID(std::numeric_limits<EdgeID>::max());
 	uint const NO_DIST(std::numeric_limits<uint>::max());
+	/* distance of edges without one; never the result of concat() */
+	Distance const NO_EDGE_DIST(std::numeric_limits<Distance>::max());
 	uint const NO_LVL(std::numeric_limits<uint>::max());
 }
 
+/* dist1 + dist2, aborts if the sum doesn't fit into Distance */
+Distance addDistances(Distance dist1, Distance dist2);
+
 typedef std::map<std::string, std::string> Metadata;
 
 enum class EdgeType : uint8_t {OUT = 0, IN = 1};
@@ -51,6 +98,15 @@ struct GraphOutData {
 	Metadata meta_data;
 };
 
+template <typename NodeT, typename EdgeT>
+struct GraphCHInData {
+	/* graph will "steal" data */
+	std::vector<NodeT> nodes;
+	std::vector<uint> node_levels;
+	std::vector<EdgeT> edges;
+	Metadata meta_data;
+};
+
 template <typename NodeT, typename EdgeT>
 struct GraphCHOutData {
 	std::vector<NodeT> const& nodes;
@@ -240,10 +296,10 @@ struct Edge
 	EdgeID id = c::NO_EID;
 	NodeID src = c::NO_NID;
 	NodeID tgt = c::NO_NID;
-	uint dist = c::NO_DIST;
+	Distance dist = c::NO_EDGE_DIST;
 
 	Edge() { }
-	Edge(EdgeID id, NodeID src, NodeID tgt, uint dist)
+	Edge(EdgeID id, NodeID src, NodeID tgt, Distance dist)
 		: id(id), src(src), tgt(tgt), dist(dist) { }
 
 	uint distance() const { return dist; }
@@ -269,10 +325,10 @@ struct StefanEdge
 	EdgeID id = c::NO_EID;
 	NodeID src = c::NO_NID;
 	NodeID tgt = c::NO_NID;
-	uint dist = c::NO_DIST;
+	Distance dist = c::NO_EDGE_DIST;
 
 	StefanEdge() { }
-	StefanEdge(EdgeID id, NodeID src, NodeID tgt, uint dist)
+	StefanEdge(EdgeID id, NodeID src, NodeID tgt, Distance dist)
 	: id(id), src(src), tgt(tgt), dist(dist) { }
 
 	uint distance() const { return dist; }
@@ -289,12 +345,12 @@ struct OSMEdge
 	EdgeID id = c::NO_EID;
 	NodeID src = c::NO_NID;
 	NodeID tgt = c::NO_NID;
-	uint dist = c::NO_DIST;
+	Distance dist = c::NO_EDGE_DIST;
 	uint type = 0;
 	int speed = -1;
 
 	OSMEdge() { }
-	OSMEdge(EdgeID id, NodeID src, NodeID tgt, uint dist, uint type, int speed)
+	OSMEdge(EdgeID id, NodeID src, NodeID tgt, Distance dist, uint type, int speed)
 	: id(id), src(src), tgt(tgt), dist(dist), type(type), speed(speed) { }
 
 	uint distance() const { return dist; }
@@ -315,10 +371,10 @@ struct OSMDistEdge : OSMEdge { };
 
 struct EuclOSMEdge : OSMEdge
 {
-	uint eucl_dist = c::NO_DIST;
+	Distance eucl_dist = c::NO_EDGE_DIST;
 
 	EuclOSMEdge() { }
-	EuclOSMEdge(EdgeID id, NodeID src, NodeID tgt, uint dist, uint type, int speed, uint eucl_dist)
+	EuclOSMEdge(EdgeID id, NodeID src, NodeID tgt, Distance dist, uint type, int speed, Distance eucl_dist)
 	: OSMEdge(id, src, tgt, dist, type, speed), eucl_dist(eucl_dist) { }
 };
 EuclOSMEdge concat(EuclOSMEdge const& edge1, EuclOSMEdge const& edge2);
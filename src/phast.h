@@ -0,0 +1,463 @@
+#pragma once
+
+#include "chgraph.h"
+#include "labels.h"
+#include "priority_queues.h"
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE4_1__)
+# include <smmintrin.h>
+#endif
+
+namespace chc
+{
+
+namespace unit_tests
+{
+	void testPHAST();
+}
+
+/*
+ * Downward part of a CH laid out for a linear sweep: nodes are ordered by
+ * descending level ("rank"), and the downward edges are grouped by the rank
+ * of their target, each one pointing to the rank of its (higher) source.
+ * Sweeping the ranks in increasing order therefore always sees the final
+ * label of an edge source before relaxing the edge.
+ *
+ * If only a subset of nodes is given, the subset has to be closed under
+ * "downward edge sources" (see RPHAST), the remaining nodes get no rank.
+ */
+struct DownwardSweepGraph
+{
+	struct DownEdge
+	{
+		NodeID src_rank;
+		uint dist;
+	};
+
+	std::vector<NodeID> order;   /* rank -> node */
+	std::vector<NodeID> rank;    /* node -> rank (c::NO_NID if not part of the sweep) */
+	std::vector<EdgeID> offsets; /* rank -> index of its first down edge */
+	std::vector<DownEdge> edges;
+
+	/* all nodes */
+	template <typename NodeT, typename EdgeT>
+	explicit DownwardSweepGraph(CHGraph<NodeT, EdgeT> const& g);
+
+	/* only the given nodes; an empty subset gives an empty sweep */
+	template <typename NodeT, typename EdgeT>
+	explicit DownwardSweepGraph(CHGraph<NodeT, EdgeT> const& g, std::vector<NodeID> nodes);
+
+	template <typename NodeT, typename EdgeT>
+	static std::vector<NodeID> allNodes(CHGraph<NodeT, EdgeT> const& g);
+
+	NodeID getNrOfNodes() const { return order.size(); }
+	bool contains(NodeID node_id) const { return rank[node_id] != c::NO_NID; }
+
+	/* relaxes all downward edges in rank order; dists is indexed by rank */
+	void sweep(uint* dists) const
+	{
+		for (NodeID r(0), size(getNrOfNodes()); r<size; r++) {
+			uint dist(dists[r]);
+			for (EdgeID i(offsets[r]), end(offsets[r+1]); i<end; i++) {
+				uint src_dist(dists[edges[i].src_rank]);
+				if (src_dist != c::NO_DIST) {
+					dist = std::min(dist, src_dist + edges[i].dist);
+				}
+			}
+			dists[r] = dist;
+		}
+	}
+};
+
+/* "min-plus" update of a block of K labels: dst[i] = min(dst[i], src[i] + dist) */
+template <size_t K>
+inline void minPlus(uint* dst, uint const* src, uint dist)
+{
+	for (size_t i = 0; i < K; i++) {
+		uint sum(src[i] + dist);
+		/* saturate on overflow, so c::NO_DIST stays c::NO_DIST */
+		sum = (sum < src[i]) ? c::NO_DIST : sum;
+		dst[i] = std::min(dst[i], sum);
+	}
+}
+
+#if defined(__AVX2__)
+template <>
+inline void minPlus<8>(uint* dst, uint const* src, uint dist)
+{
+	__m256i s = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src));
+	__m256i sum = _mm256_add_epi32(s, _mm256_set1_epi32(dist));
+	/* lanes with sum < s overflowed: set them to all ones (c::NO_DIST) */
+	__m256i ovf = _mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_max_epu32(sum, s), sum), _mm256_set1_epi32(-1));
+	sum = _mm256_or_si256(sum, ovf);
+	__m256i d = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dst));
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_min_epu32(d, sum));
+}
+
+template <>
+inline void minPlus<16>(uint* dst, uint const* src, uint dist)
+{
+	minPlus<8>(dst, src, dist);
+	minPlus<8>(dst + 8, src + 8, dist);
+}
+#elif defined(__SSE4_1__)
+template <>
+inline void minPlus<4>(uint* dst, uint const* src, uint dist)
+{
+	__m128i s = _mm_loadu_si128(reinterpret_cast<__m128i const*>(src));
+	__m128i sum = _mm_add_epi32(s, _mm_set1_epi32(dist));
+	/* lanes with sum < s overflowed: set them to all ones (c::NO_DIST) */
+	__m128i ovf = _mm_xor_si128(_mm_cmpeq_epi32(_mm_max_epu32(sum, s), sum), _mm_set1_epi32(-1));
+	sum = _mm_or_si128(sum, ovf);
+	__m128i d = _mm_loadu_si128(reinterpret_cast<__m128i const*>(dst));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_min_epu32(d, sum));
+}
+
+template <>
+inline void minPlus<8>(uint* dst, uint const* src, uint dist)
+{
+	minPlus<4>(dst, src, dist);
+	minPlus<4>(dst + 4, src + 4, dist);
+}
+
+template <>
+inline void minPlus<16>(uint* dst, uint const* src, uint dist)
+{
+	minPlus<8>(dst, src, dist);
+	minPlus<8>(dst + 8, src + 8, dist);
+}
+#endif
+
+/*
+ * Plain Dijkstra on the upward edges of a CH (in the given direction),
+ * without any stopping criterion besides the optional distance limit.
+ */
+template <typename NodeT, typename EdgeT>
+class CHUpwardSearch
+{
+	private:
+		struct PQElement;
+		typedef BinaryHeap<PQElement> PQ;
+
+		CHGraph<NodeT, EdgeT> const& _g;
+		PQ _pq;
+
+		StampedLabels<uint> _dists;
+		std::vector<NodeID> _settled;
+
+		void _reset();
+	public:
+		CHUpwardSearch(CHGraph<NodeT, EdgeT> const& g);
+
+		/* settles all nodes reachable upwards from src within max_dist */
+		void run(NodeID src, EdgeType direction = EdgeType::OUT, uint max_dist = c::NO_DIST);
+
+		/* nodes settled in the last run, in settle order */
+		std::vector<NodeID> const& settled() const { return _settled; }
+		uint getDist(NodeID node_id) const { return _dists[node_id]; }
+};
+
+/*
+ * PHAST: one-to-all distances by an upward search from the source followed
+ * by a linear sweep over the downward edges in level order.
+ * Requires the complete CH (see CHGraph::rebuildCompleteGraph).
+ */
+template <typename NodeT, typename EdgeT>
+class PHAST
+{
+	private:
+		DownwardSweepGraph _down;
+		CHUpwardSearch<NodeT, EdgeT> _up;
+
+		/* indexed by rank */
+		std::vector<uint> _dists;
+	public:
+		PHAST(CHGraph<NodeT, EdgeT> const& g);
+
+		/* calculates the distances from src to all nodes */
+		void calcDists(NodeID src);
+
+		uint getDist(NodeID node_id) const { return _dists[_down.rank[node_id]]; }
+
+		friend void unit_tests::testPHAST();
+};
+
+/*
+ * PHAST for K sources at once: every node holds a block of K labels, and
+ * each downward edge updates the whole block with one min-plus operation
+ * (vectorized with SSE4.1/AVX2 if available).
+ */
+template <typename NodeT, typename EdgeT, size_t K = 8>
+class MultiPHAST
+{
+	private:
+		DownwardSweepGraph _down;
+		CHUpwardSearch<NodeT, EdgeT> _up;
+
+		/* K labels per rank */
+		std::vector<uint> _dists;
+	public:
+		static constexpr size_t NR_OF_SOURCES = K;
+
+		MultiPHAST(CHGraph<NodeT, EdgeT> const& g);
+
+		/* calculates the distances from up to K sources to all nodes */
+		void calcDists(std::vector<NodeID> const& sources);
+
+		/* distance from the i-th source of the last calcDists() call */
+		uint getDist(size_t i, NodeID node_id) const { return _dists[_down.rank[node_id] * K + i]; }
+
+		friend void unit_tests::testPHAST();
+};
+
+/*
+ * RPHAST: PHAST restricted to a fixed set of targets. A one-time selection
+ * extracts the part of the hierarchy from which the targets can be reached
+ * downwards; each query then only sweeps over this (usually small) part.
+ */
+template <typename NodeT, typename EdgeT>
+class RPHAST
+{
+	private:
+		std::vector<NodeID> _targets;
+		DownwardSweepGraph _down;
+		CHUpwardSearch<NodeT, EdgeT> _up;
+
+		/* indexed by rank in the restricted sweep graph */
+		std::vector<uint> _dists;
+
+		static std::vector<NodeID> _selectNodes(CHGraph<NodeT, EdgeT> const& g,
+				std::vector<NodeID> const& targets);
+	public:
+		RPHAST(CHGraph<NodeT, EdgeT> const& g, std::vector<NodeID> targets);
+
+		/* calculates the distances from src to all targets */
+		void calcDists(NodeID src);
+
+		std::vector<NodeID> const& getTargets() const { return _targets; }
+		/* distance to the i-th target */
+		uint getTargetDist(size_t i) const { return _dists[_down.rank[_targets[i]]]; }
+		/* distance to any node of the selection (includes all targets) */
+		uint getDist(NodeID node_id) const { return _dists[_down.rank[node_id]]; }
+		uint getNrOfSelectedNodes() const { return _down.getNrOfNodes(); }
+
+		friend void unit_tests::testPHAST();
+};
+
+/*
+ * DownwardSweepGraph member functions.
+ */
+
+template <typename NodeT, typename EdgeT>
+DownwardSweepGraph::DownwardSweepGraph(CHGraph<NodeT, EdgeT> const& g)
+	: DownwardSweepGraph(g, allNodes(g))
+{
+}
+
+template <typename NodeT, typename EdgeT>
+DownwardSweepGraph::DownwardSweepGraph(CHGraph<NodeT, EdgeT> const& g, std::vector<NodeID> nodes)
+{
+	uint nr_of_nodes(g.getNrOfNodes());
+
+	std::stable_sort(nodes.begin(), nodes.end(), [&g](NodeID node1, NodeID node2) {
+		return g.getNodeLevel(node1) > g.getNodeLevel(node2);
+	});
+	order = std::move(nodes);
+
+	rank.assign(nr_of_nodes, c::NO_NID);
+	for (NodeID i(0); i<order.size(); i++) {
+		rank[order[i]] = i;
+	}
+
+	offsets.reserve(order.size() + 1);
+	for (NodeID node: order) {
+		offsets.push_back(edges.size());
+		for (auto const& edge: g.nodeEdges(node, EdgeType::IN)) {
+			/* edge from a higher node down to node */
+			if (!g.isUp(edge, EdgeType::IN)) continue;
+			assert(contains(edge.src) && rank[edge.src] < rank[node]);
+			edges.push_back(DownEdge { rank[edge.src], edge.distance() });
+		}
+	}
+	offsets.push_back(edges.size());
+}
+
+template <typename NodeT, typename EdgeT>
+std::vector<NodeID> DownwardSweepGraph::allNodes(CHGraph<NodeT, EdgeT> const& g)
+{
+	std::vector<NodeID> nodes(g.getNrOfNodes());
+	for (NodeID i(0); i<nodes.size(); i++) {
+		nodes[i] = i;
+	}
+	return nodes;
+}
+
+/*
+ * CHUpwardSearch member functions.
+ */
+
+template <typename NodeT, typename EdgeT>
+struct CHUpwardSearch<NodeT, EdgeT>::PQElement
+{
+	NodeID node;
+	uint _dist;
+
+	PQElement(NodeID node, uint dist)
+		: node(node), _dist(dist) {}
+
+	/* make interface look similar to an edge */
+	uint distance() const { return _dist; }
+};
+
+template <typename NodeT, typename EdgeT>
+CHUpwardSearch<NodeT, EdgeT>::CHUpwardSearch(CHGraph<NodeT, EdgeT> const& g)
+	: _g(g), _dists(g.getNrOfNodes(), c::NO_DIST) {}
+
+template <typename NodeT, typename EdgeT>
+void CHUpwardSearch<NodeT, EdgeT>::run(NodeID src, EdgeType direction, uint max_dist)
+{
+	_reset();
+
+	_pq.push(PQElement(src, 0));
+	_dists.set(src, 0);
+
+	while (!_pq.empty()) {
+		PQElement top(_pq.top());
+		_pq.pop();
+
+		if (_dists[top.node] != top.distance()) continue;
+		_settled.push_back(top.node);
+
+		for (auto const& edge: _g.nodeEdges(top.node, direction)) {
+			if (!_g.isUp(edge, direction)) continue;
+
+			NodeID other_node(otherNode(edge, direction));
+			uint new_dist(top.distance() + edge.distance());
+
+			if (new_dist <= max_dist && new_dist < _dists[other_node]) {
+				_dists.set(other_node, new_dist);
+				_pq.push(PQElement(other_node, new_dist));
+			}
+		}
+	}
+}
+
+template <typename NodeT, typename EdgeT>
+void CHUpwardSearch<NodeT, EdgeT>::_reset()
+{
+	_dists.reset();
+	_settled.clear();
+	_pq.clear();
+}
+
+/*
+ * PHAST member functions.
+ */
+
+template <typename NodeT, typename EdgeT>
+PHAST<NodeT, EdgeT>::PHAST(CHGraph<NodeT, EdgeT> const& g)
+	: _down(g), _up(g), _dists(g.getNrOfNodes(), c::NO_DIST) {}
+
+template <typename NodeT, typename EdgeT>
+void PHAST<NodeT, EdgeT>::calcDists(NodeID src)
+{
+	std::fill(_dists.begin(), _dists.end(), c::NO_DIST);
+
+	_up.run(src);
+	for (NodeID node: _up.settled()) {
+		_dists[_down.rank[node]] = _up.getDist(node);
+	}
+
+	_down.sweep(_dists.data());
+}
+
+/*
+ * MultiPHAST member functions.
+ */
+
+template <typename NodeT, typename EdgeT, size_t K>
+MultiPHAST<NodeT, EdgeT, K>::MultiPHAST(CHGraph<NodeT, EdgeT> const& g)
+	: _down(g), _up(g), _dists(size_t(g.getNrOfNodes()) * K, c::NO_DIST) {}
+
+template <typename NodeT, typename EdgeT, size_t K>
+void MultiPHAST<NodeT, EdgeT, K>::calcDists(std::vector<NodeID> const& sources)
+{
+	assert(sources.size() <= K);
+
+	std::fill(_dists.begin(), _dists.end(), c::NO_DIST);
+
+	for (size_t i(0); i<sources.size(); i++) {
+		_up.run(sources[i]);
+		for (NodeID node: _up.settled()) {
+			_dists[size_t(_down.rank[node]) * K + i] = _up.getDist(node);
+		}
+	}
+
+	auto const* edges(_down.edges.data());
+	auto const* offsets(_down.offsets.data());
+	uint* dists(_dists.data());
+	for (uint r(0), size(_down.getNrOfNodes()); r<size; r++) {
+		uint* block(dists + size_t(r) * K);
+		for (EdgeID i(offsets[r]), end(offsets[r+1]); i<end; i++) {
+			minPlus<K>(block, dists + size_t(edges[i].src_rank) * K, edges[i].dist);
+		}
+	}
+}
+
+/*
+ * RPHAST member functions.
+ */
+
+template <typename NodeT, typename EdgeT>
+RPHAST<NodeT, EdgeT>::RPHAST(CHGraph<NodeT, EdgeT> const& g, std::vector<NodeID> targets)
+	: _targets(std::move(targets)), _down(g, _selectNodes(g, _targets)), _up(g),
+	_dists(_down.getNrOfNodes(), c::NO_DIST) {}
+
+template <typename NodeT, typename EdgeT>
+std::vector<NodeID> RPHAST<NodeT, EdgeT>::_selectNodes(CHGraph<NodeT, EdgeT> const& g,
+		std::vector<NodeID> const& targets)
+{
+	/* all nodes reaching a target on downward edges */
+	std::vector<bool> selected(g.getNrOfNodes(), false);
+	std::vector<NodeID> nodes;
+	for (NodeID target: targets) {
+		if (!selected[target]) {
+			selected[target] = true;
+			nodes.push_back(target);
+		}
+	}
+
+	for (size_t i(0); i<nodes.size(); i++) {
+		for (auto const& edge: g.nodeEdges(nodes[i], EdgeType::IN)) {
+			if (!g.isUp(edge, EdgeType::IN) || selected[edge.src]) continue;
+			selected[edge.src] = true;
+			nodes.push_back(edge.src);
+		}
+	}
+
+	return nodes;
+}
+
+template <typename NodeT, typename EdgeT>
+void RPHAST<NodeT, EdgeT>::calcDists(NodeID src)
+{
+	std::fill(_dists.begin(), _dists.end(), c::NO_DIST);
+
+	_up.run(src);
+	for (NodeID node: _up.settled()) {
+		/* nodes outside the selection can't reach any target downwards */
+		if (_down.contains(node)) {
+			_dists[_down.rank[node]] = _up.getDist(node);
+		}
+	}
+
+	_down.sweep(_dists.data());
+}
+
+}
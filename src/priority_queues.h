@@ -0,0 +1,149 @@
+#pragma once
+
+#include "defs.h"
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace chc
+{
+
+/*
+ * Min priority queues for the Dijkstra variants; elements provide their key
+ * via distance(). All of them can be cleared without releasing their memory,
+ * so a query object can keep one and reuse it for every search.
+ *
+ * Interface: push(), pop(), top(), empty(), size(), clear().
+ */
+
+/* std::priority_queue, recreated on clear() */
+template <typename T>
+class StdPriorityQueue
+{
+	private:
+		typedef std::priority_queue<T, std::vector<T>, std::greater<T> > PQ;
+		PQ _pq;
+	public:
+		void push(T const& elem) { _pq.push(elem); }
+		void pop() { _pq.pop(); }
+		T const& top() const { return _pq.top(); }
+		bool empty() const { return _pq.empty(); }
+		size_t size() const { return _pq.size(); }
+		void clear() { _pq = PQ(); }
+};
+
+/* binary heap in a std::vector; like std::priority_queue, but keeps its storage */
+template <typename T>
+class BinaryHeap
+{
+	private:
+		struct Compare
+		{
+			bool operator()(T const& a, T const& b) const
+			{
+				return a.distance() > b.distance();
+			}
+		};
+
+		std::vector<T> _heap;
+	public:
+		void push(T const& elem)
+		{
+			_heap.push_back(elem);
+			std::push_heap(_heap.begin(), _heap.end(), Compare());
+		}
+
+		void pop()
+		{
+			std::pop_heap(_heap.begin(), _heap.end(), Compare());
+			_heap.pop_back();
+		}
+
+		T const& top() const { return _heap.front(); }
+		bool empty() const { return _heap.empty(); }
+		size_t size() const { return _heap.size(); }
+		void clear() { _heap.clear(); }
+};
+
+/*
+ * Radix heap for monotone integer keys: a pushed key must never be smaller
+ * than the key of the last popped element, which holds for Dijkstra with
+ * non-negative edge weights.
+ *
+ * Bucket 0 holds the elements with the key of the last minimum, bucket i > 0
+ * the elements whose key first differs from it in bit i-1. Each element is
+ * moved at most once per bit, i.e. O(log C) amortized per operation.
+ */
+template <typename T>
+class RadixHeap
+{
+	private:
+		static constexpr size_t NR_OF_BUCKETS = std::numeric_limits<uint>::digits + 1;
+
+		std::vector<T> _buckets[NR_OF_BUCKETS];
+		uint _last = 0;
+		size_t _size = 0;
+
+		static size_t _bucketIndex(uint key, uint last)
+		{
+			return key == last ? 0 : std::numeric_limits<uint>::digits - __builtin_clz(key ^ last);
+		}
+
+		void _refill();
+	public:
+		void push(T const& elem)
+		{
+			debug_assert(elem.distance() >= _last);
+			_buckets[_bucketIndex(elem.distance(), _last)].push_back(elem);
+			_size++;
+		}
+
+		void pop()
+		{
+			_refill();
+			_buckets[0].pop_back();
+			_size--;
+		}
+
+		T const& top()
+		{
+			_refill();
+			return _buckets[0].back();
+		}
+
+		bool empty() const { return _size == 0; }
+		size_t size() const { return _size; }
+
+		void clear()
+		{
+			for (auto& bucket: _buckets) bucket.clear();
+			_last = 0;
+			_size = 0;
+		}
+};
+
+template <typename T>
+void RadixHeap<T>::_refill()
+{
+	assert(_size != 0);
+	if (!_buckets[0].empty()) return;
+
+	size_t i(1);
+	while (_buckets[i].empty()) i++;
+
+	/* new minimum; redistribute its bucket into lower buckets */
+	auto& bucket(_buckets[i]);
+	_last = std::min_element(bucket.begin(), bucket.end(), [](T const& a, T const& b) {
+		return a.distance() < b.distance();
+	})->distance();
+
+	for (auto const& elem: bucket) {
+		_buckets[_bucketIndex(elem.distance(), _last)].push_back(elem);
+	}
+	bucket.clear();
+}
+
+}
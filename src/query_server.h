@@ -0,0 +1,419 @@
+#pragma once
+
+#include "defs.h"
+#include "chgraph.h"
+#include "dijkstra.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <omp.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace chc
+{
+
+namespace unit_tests
+{
+	void testQueryServer();
+}
+
+/*
+ * Latencies (in microseconds) of the most recent requests: the time each
+ * request took to be answered, without the time it waited in its batch.
+ */
+class LatencyStats
+{
+	private:
+		static constexpr size_t MAX_SAMPLES = 1 << 16;
+
+		std::vector<double> _samples;
+		size_t _next = 0;
+		uint64_t _count = 0;
+	public:
+		void add(double latency_us)
+		{
+			if (_samples.size() < MAX_SAMPLES) {
+				_samples.push_back(latency_us);
+			}
+			else {
+				_samples[_next] = latency_us;
+				_next = (_next + 1) % MAX_SAMPLES;
+			}
+			_count++;
+		}
+
+		/* total number of recorded requests */
+		uint64_t count() const { return _count; }
+
+		/* p in [0, 1]; 0 if there are no samples yet */
+		double percentile(double p) const
+		{
+			if (_samples.empty()) return 0;
+			std::vector<double> samples(_samples);
+			size_t n(std::min<size_t>(samples.size() - 1, p * samples.size()));
+			std::nth_element(samples.begin(), samples.begin() + n, samples.end());
+			return samples[n];
+		}
+};
+
+/*
+ * Answers shortest path requests on a CH with a pool of CHDijkstra
+ * workspaces, one per thread.
+ *
+ * Line based protocol, one response line per request line, in order:
+ *   d <src> <tgt>   ->  <dist>                 (-1 if there is no path)
+ *   p <src> <tgt>   ->  <dist> <node>...       (unpacked path from src to tgt)
+ *   s               ->  requests <n> p50_us <x> p99_us <y>
+ * Malformed requests are answered with "error <reason>".
+ *
+ * All complete request lines available at a time (from all clients) are
+ * collected into one batch, which is then answered in parallel.
+ * Responses are queued per client and written when the client can take
+ * them; no more requests are read from a client while more than
+ * MAX_BACKLOG bytes of its responses are pending, so a client which
+ * doesn't read doesn't hold up the others. A line longer than
+ * MAX_REQUEST_LENGTH is answered with "error request too long" and ends
+ * the requests of that client.
+ * Requires the complete CH (see CHGraph::rebuildCompleteGraph); GraphT can
+ * also be a MappedCHGraph or CompressedCHGraph.
+ */
+template <typename NodeT, typename EdgeT, typename GraphT = CHGraph<NodeT, EdgeT> >
+class CHQueryServer
+{
+	private:
+		typedef CHDijkstra<NodeT, EdgeT, RadixHeap, GraphT> Query;
+
+		struct Client
+		{
+			int in_fd;
+			int out_fd;
+			std::string in_buf;
+			/* responses not written yet */
+			std::string out_buf;
+			/* no more requests */
+			bool eof;
+			/* the responses can't be written anymore */
+			bool failed;
+		};
+
+		GraphT const& _g;
+		uint _num_threads;
+		size_t _max_batch;
+
+		std::vector<std::unique_ptr<Query>> _queries;
+		LatencyStats _latency;
+
+		std::string _handleRequest(std::string const& request, Query& query) const;
+		void _unpackEdge(EdgeID edge_id, std::vector<NodeID>& nodes) const;
+		std::vector<NodeID> _pathNodes(NodeID src, std::vector<EdgeID> const& path) const;
+
+		void _serve(int listen_fd, std::vector<Client> clients);
+		/* writes as much of the pending responses as possible; false on errors */
+		static bool _flush(Client& client);
+	public:
+		static constexpr size_t MAX_BACKLOG = 1 << 20;
+		static constexpr size_t MAX_REQUEST_LENGTH = 1 << 12;
+
+		CHQueryServer(GraphT const& g, uint num_threads = 1, size_t max_batch = 1024);
+
+		/* answers a batch of requests in parallel; one response (without newline) per request */
+		std::vector<std::string> handleBatch(std::vector<std::string> const& requests);
+
+		/* serves the requests read from in_fd until EOF; responses are written to out_fd */
+		void serve(int in_fd, int out_fd);
+		/* serves all clients connecting to a UNIX domain socket at path; doesn't return */
+		void serveUnixSocket(std::string const& path);
+
+		LatencyStats const& getLatencyStats() const { return _latency; }
+
+		friend void unit_tests::testQueryServer();
+};
+
+template <typename NodeT, typename EdgeT, typename GraphT>
+CHQueryServer<NodeT, EdgeT, GraphT>::CHQueryServer(GraphT const& g, uint num_threads, size_t max_batch)
+	: _g(g), _num_threads(std::max(1u, num_threads)), _max_batch(std::max<size_t>(1, max_batch))
+{
+	for (uint i(0); i<_num_threads; i++) {
+		_queries.emplace_back(new Query(g));
+	}
+}
+
+template <typename NodeT, typename EdgeT, typename GraphT>
+std::vector<std::string> CHQueryServer<NodeT, EdgeT, GraphT>::handleBatch(std::vector<std::string> const& requests)
+{
+	using namespace std::chrono;
+
+	std::vector<std::string> responses(requests.size());
+	std::vector<double> latencies(requests.size());
+
+	uint size(requests.size());
+	#pragma omp parallel for num_threads(_num_threads) schedule(dynamic)
+	for (uint i = 0; i < size; i++) {
+		Query& query(*_queries[omp_get_thread_num()]);
+		steady_clock::time_point t1 = steady_clock::now();
+		responses[i] = _handleRequest(requests[i], query);
+		latencies[i] = duration_cast<duration<double, std::micro>>(steady_clock::now() - t1).count();
+	}
+
+	for (double latency: latencies) {
+		_latency.add(latency);
+	}
+
+	return responses;
+}
+
+template <typename NodeT, typename EdgeT, typename GraphT>
+std::string CHQueryServer<NodeT, EdgeT, GraphT>::_handleRequest(std::string const& request, Query& query) const
+{
+	std::istringstream is(request);
+	std::string type;
+	is >> type;
+
+	std::ostringstream os;
+	if (type == "s") {
+		os << "requests " << _latency.count()
+			<< " p50_us " << _latency.percentile(0.5)
+			<< " p99_us " << _latency.percentile(0.99);
+		return os.str();
+	}
+	if (type != "d" && type != "p") {
+		return "error unknown request";
+	}
+
+	NodeID src, tgt;
+	if (!(is >> src >> tgt)) {
+		return "error expected <src> <tgt>";
+	}
+	if (src >= _g.getNrOfNodes() || tgt >= _g.getNrOfNodes()) {
+		return "error invalid node id";
+	}
+
+	std::vector<EdgeID> path;
+	uint dist(src == tgt ? 0 : query.calcShopa(src, tgt, path));
+	if (dist == c::NO_DIST) {
+		return "-1";
+	}
+
+	os << dist;
+	if (type == "p") {
+		for (NodeID node: _pathNodes(src, path)) {
+			os << " " << node;
+		}
+	}
+	return os.str();
+}
+
+template <typename NodeT, typename EdgeT, typename GraphT>
+void CHQueryServer<NodeT, EdgeT, GraphT>::_unpackEdge(EdgeID edge_id, std::vector<NodeID>& nodes) const
+{
+	auto const& edge(_g.getEdge(edge_id));
+	if (edge.child_edge1 == c::NO_EID) {
+		nodes.push_back(edge.tgt);
+	}
+	else {
+		_unpackEdge(edge.child_edge1, nodes);
+		_unpackEdge(edge.child_edge2, nodes);
+	}
+}
+
+template <typename NodeT, typename EdgeT, typename GraphT>
+std::vector<NodeID> CHQueryServer<NodeT, EdgeT, GraphT>::_pathNodes(NodeID src, std::vector<EdgeID> const& path) const
+{
+	/* the edges of a CHDijkstra path are in no particular order; chain them from src */
+	std::vector<NodeID> nodes(1, src);
+	std::vector<bool> used(path.size(), false);
+	for (size_t n(0); n<path.size(); n++) {
+		for (size_t i(0); i<path.size(); i++) {
+			if (!used[i] && _g.getEdge(path[i]).src == nodes.back()) {
+				used[i] = true;
+				_unpackEdge(path[i], nodes);
+				break;
+			}
+		}
+	}
+	return nodes;
+}
+
+template <typename NodeT, typename EdgeT, typename GraphT>
+void CHQueryServer<NodeT, EdgeT, GraphT>::serve(int in_fd, int out_fd)
+{
+	_serve(-1, std::vector<Client>(1, Client { in_fd, out_fd, std::string(), std::string(), false, false }));
+}
+
+template <typename NodeT, typename EdgeT, typename GraphT>
+void CHQueryServer<NodeT, EdgeT, GraphT>::serveUnixSocket(std::string const& path)
+{
+	int fd(socket(AF_UNIX, SOCK_STREAM, 0));
+	if (fd < 0) {
+		std::cerr << "FATAL_ERROR: Couldn't create socket: " << std::strerror(errno) << "\n";
+		std::abort();
+	}
+
+	sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr.sun_path)) {
+		std::cerr << "FATAL_ERROR: Socket path too long: " << path << "\n";
+		std::abort();
+	}
+	std::strcpy(addr.sun_path, path.c_str());
+
+	unlink(path.c_str());
+	if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+		std::cerr << "FATAL_ERROR: Couldn't listen on " << path << ": " << std::strerror(errno) << "\n";
+		std::abort();
+	}
+
+	_serve(fd, std::vector<Client>());
+}
+
+template <typename NodeT, typename EdgeT, typename GraphT>
+void CHQueryServer<NodeT, EdgeT, GraphT>::_serve(int listen_fd, std::vector<Client> clients)
+{
+	/* clients going away must not kill the server */
+	std::signal(SIGPIPE, SIG_IGN);
+
+	char buf[1 << 16];
+
+	while (listen_fd >= 0 || !clients.empty()) {
+		/* two entries per client, input and output; fd -1 if not polled */
+		std::vector<pollfd> fds;
+		if (listen_fd >= 0) {
+			fds.push_back(pollfd { listen_fd, POLLIN, 0 });
+		}
+		for (auto const& client: clients) {
+			bool read_requests(!client.eof && client.out_buf.size() < MAX_BACKLOG);
+			fds.push_back(pollfd { read_requests ? client.in_fd : -1, POLLIN, 0 });
+			fds.push_back(pollfd { client.out_buf.empty() ? -1 : client.out_fd, POLLOUT, 0 });
+		}
+
+		if (poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR) continue;
+			std::cerr << "FATAL_ERROR: poll failed: " << std::strerror(errno) << "\n";
+			std::abort();
+		}
+
+		size_t first_client(0);
+		if (listen_fd >= 0) {
+			first_client = 1;
+			if (fds[0].revents & POLLIN) {
+				int fd(accept(listen_fd, nullptr, nullptr));
+				if (fd >= 0) {
+					fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+					clients.push_back(Client { fd, fd, std::string(), std::string(), false, false });
+				}
+			}
+		}
+
+		/* write pending responses, read everything available, then collect the complete lines into one batch */
+		std::vector<std::string> requests;
+		std::vector<size_t> request_client;
+		std::vector<bool> too_long(clients.size(), false);
+		for (size_t i(first_client); i + 1<fds.size(); i += 2) {
+			Client& client(clients[(i - first_client) / 2]);
+
+			if ((fds[i + 1].revents & (POLLOUT | POLLHUP | POLLERR)) && !_flush(client)) {
+				client.failed = true;
+			}
+			if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+			ssize_t len(read(client.in_fd, buf, sizeof(buf)));
+			if (len > 0) {
+				client.in_buf.append(buf, len);
+			}
+			else if (len == 0 || (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)) {
+				client.eof = true;
+				/* treat an unterminated last line as request */
+				if (!client.in_buf.empty() && client.in_buf.back() != '\n') client.in_buf += '\n';
+			}
+		}
+		for (size_t c(0); c<clients.size(); c++) {
+			std::string& in_buf(clients[c].in_buf);
+			size_t start(0), end;
+			while ((end = in_buf.find('\n', start)) != std::string::npos) {
+				std::string line(in_buf, start, end - start);
+				if (!line.empty() && line.back() == '\r') line.pop_back();
+				if (!line.empty()) {
+					requests.push_back(std::move(line));
+					request_client.push_back(c);
+				}
+				start = end + 1;
+			}
+			in_buf.erase(0, start);
+
+			/* don't buffer a line without end */
+			if (in_buf.size() > MAX_REQUEST_LENGTH) {
+				in_buf.clear();
+				clients[c].eof = true;
+				too_long[c] = true;
+			}
+		}
+
+		/* answer in batches of at most _max_batch requests */
+		for (size_t first(0); first<requests.size(); first += _max_batch) {
+			size_t last(std::min(requests.size(), first + _max_batch));
+			auto responses(handleBatch(std::vector<std::string>(requests.begin() + first, requests.begin() + last)));
+
+			std::vector<bool> has_output(clients.size(), false);
+			for (size_t i(first); i<last; i++) {
+				Client& client(clients[request_client[i]]);
+				client.out_buf += responses[i - first];
+				client.out_buf += '\n';
+				has_output[request_client[i]] = true;
+			}
+			for (size_t c(0); c<clients.size(); c++) {
+				if (has_output[c] && !clients[c].failed && !_flush(clients[c])) {
+					clients[c].failed = true;
+				}
+			}
+		}
+
+		/* after the responses to its complete lines */
+		for (size_t c(0); c<clients.size(); c++) {
+			if (!too_long[c]) continue;
+			clients[c].out_buf += "error request too long\n";
+			if (!clients[c].failed && !_flush(clients[c])) {
+				clients[c].failed = true;
+			}
+		}
+
+		/* drop closed clients */
+		for (size_t c(clients.size()); c-- > 0; ) {
+			if (!clients[c].failed && !(clients[c].eof && clients[c].out_buf.empty())) continue;
+			if (listen_fd >= 0) close(clients[c].in_fd);
+			clients.erase(clients.begin() + c);
+		}
+	}
+}
+
+template <typename NodeT, typename EdgeT, typename GraphT>
+bool CHQueryServer<NodeT, EdgeT, GraphT>::_flush(Client& client)
+{
+	size_t written(0);
+	while (written < client.out_buf.size()) {
+		ssize_t len(write(client.out_fd, client.out_buf.data() + written, client.out_buf.size() - written));
+		if (len < 0) {
+			if (errno == EINTR) continue;
+			/* non-blocking client, the rest is written on POLLOUT */
+			if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+			return false;
+		}
+		written += len;
+	}
+	client.out_buf.erase(0, written);
+	return true;
+}
+
+}
@@ -0,0 +1,72 @@
+#include "radix_sort.h"
+
+namespace chc
+{
+
+void radixSortKeys(std::vector<KeyIndex>& pairs, uint num_threads)
+{
+	size_t const size(pairs.size());
+	if (size < MIN_RADIX_SORT_SIZE) {
+		std::stable_sort(pairs.begin(), pairs.end(), [](KeyIndex const& a, KeyIndex const& b) {
+			return a.key < b.key;
+		});
+		return;
+	}
+
+	/* bits which are equal in all keys don't have to be sorted by */
+	uint64_t all_or(0), all_and(~uint64_t(0));
+	#pragma omp parallel for num_threads(num_threads) schedule(static) reduction(|:all_or) reduction(&:all_and)
+	for (size_t i = 0; i < size; i++) {
+		all_or |= pairs[i].key;
+		all_and &= pairs[i].key;
+	}
+	uint64_t const differing(all_or ^ all_and);
+	if (differing == 0) return;
+
+	uint const low_bit(__builtin_ctzll(differing));
+	uint const high_bit(64 - __builtin_clzll(differing));
+
+	/* every chunk is counted and scattered by one thread */
+	size_t const nr_of_buckets(size_t(1) << RADIX_BITS);
+	uint const nr_of_chunks(std::max<size_t>(1, std::min<size_t>(num_threads, size / MIN_RADIX_SORT_SIZE)));
+	size_t const chunk_size((size + nr_of_chunks - 1) / nr_of_chunks);
+	std::vector<std::vector<size_t>> offsets(nr_of_chunks, std::vector<size_t>(nr_of_buckets));
+
+	std::vector<KeyIndex> buffer(size);
+	uint64_t const mask(nr_of_buckets - 1);
+	for (uint shift(low_bit); shift < high_bit; shift += RADIX_BITS) {
+		/* start the digit at the next differing bit */
+		shift += __builtin_ctzll(differing >> shift);
+
+		#pragma omp parallel for num_threads(num_threads) schedule(static)
+		for (uint chunk = 0; chunk < nr_of_chunks; chunk++) {
+			auto& counts(offsets[chunk]);
+			std::fill(counts.begin(), counts.end(), 0);
+			for (size_t i(chunk * chunk_size), end(std::min(size, i + chunk_size)); i < end; i++) {
+				counts[(pairs[i].key >> shift) & mask]++;
+			}
+		}
+
+		/* bucket by bucket, and inside a bucket chunk by chunk, to keep it stable */
+		size_t sum(0);
+		for (size_t bucket(0); bucket < nr_of_buckets; bucket++) {
+			for (auto& counts: offsets) {
+				size_t count(counts[bucket]);
+				counts[bucket] = sum;
+				sum += count;
+			}
+		}
+
+		#pragma omp parallel for num_threads(num_threads) schedule(static)
+		for (uint chunk = 0; chunk < nr_of_chunks; chunk++) {
+			auto& next(offsets[chunk]);
+			for (size_t i(chunk * chunk_size), end(std::min(size, i + chunk_size)); i < end; i++) {
+				buffer[next[(pairs[i].key >> shift) & mask]++] = pairs[i];
+			}
+		}
+
+		pairs.swap(buffer);
+	}
+}
+
+}
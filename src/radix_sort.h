@@ -0,0 +1,207 @@
+#pragma once
+
+#include "defs.h"
+#include "nodes_and_edges.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace chc
+{
+
+namespace unit_tests
+{
+	void testRadixSort();
+}
+
+/*
+ * Parallel LSD radix sort for the (large) edge vectors.
+ *
+ * The items themselves are not moved while sorting: (key, index) pairs
+ * are sorted, RADIX_BITS per pass, and the items are permuted once at the
+ * end. Only the bits in which the keys actually differ are sorted by, so
+ * e.g. (src, tgt) keys of a graph with 2^20 nodes take four passes.
+ * The sort is stable, so sorting by several keys works by sorting by the
+ * least significant one first.
+ */
+struct KeyIndex
+{
+	uint64_t key;
+	size_t index;
+};
+
+static constexpr uint RADIX_BITS = 11;
+/* inputs smaller than this are sorted with std::stable_sort */
+static constexpr size_t MIN_RADIX_SORT_SIZE = 1 << 12;
+
+/* stable sort of pairs by key */
+void radixSortKeys(std::vector<KeyIndex>& pairs, uint num_threads);
+
+/* (key(items[i]), i) for all items */
+template <typename T, typename KeyFn>
+std::vector<KeyIndex> keyPairs(std::vector<T> const& items, KeyFn key, uint num_threads)
+{
+	std::vector<KeyIndex> pairs(items.size());
+	#pragma omp parallel for num_threads(num_threads) schedule(static)
+	for (size_t i = 0; i < items.size(); i++) {
+		pairs[i].key = key(items[i]);
+		pairs[i].index = i;
+	}
+	return pairs;
+}
+
+/* replaces the keys by key(items[index]), keeping the order */
+template <typename T, typename KeyFn>
+void rekeyPairs(std::vector<T> const& items, std::vector<KeyIndex>& pairs, KeyFn key, uint num_threads)
+{
+	#pragma omp parallel for num_threads(num_threads) schedule(static)
+	for (size_t i = 0; i < pairs.size(); i++) {
+		pairs[i].key = key(items[pairs[i].index]);
+	}
+}
+
+/* items[i] = old items[pairs[i].index] */
+template <typename T>
+void applyOrder(std::vector<T>& items, std::vector<KeyIndex> const& pairs, uint num_threads)
+{
+	assert(items.size() == pairs.size());
+
+	std::vector<T> sorted(items.size());
+	#pragma omp parallel for num_threads(num_threads) schedule(static)
+	for (size_t i = 0; i < pairs.size(); i++) {
+		sorted[i] = std::move(items[pairs[i].index]);
+	}
+	items.swap(sorted);
+}
+
+/*
+ * Moves every item to the position given by its id, in place (following
+ * the cycles of the permutation); the ids have to be a permutation of
+ * [0, items.size()).
+ */
+template <typename T>
+void sortById(std::vector<T>& items)
+{
+	for (size_t i(0); i<items.size(); i++) {
+		while (items[i].id != i) {
+			debug_assert(items[i].id < items.size() && items[items[i].id].id != items[i].id);
+			std::swap(items[i], items[items[i].id]);
+		}
+	}
+}
+
+inline uint bitsFor(uint64_t value)
+{
+	return value == 0 ? 0 : 64 - __builtin_clzll(value);
+}
+
+/* bits needed for the largest node id of the edges */
+template <typename EdgeT>
+uint nodeBits(std::vector<EdgeT> const& edges, uint num_threads)
+{
+	NodeID max_node(0);
+	#pragma omp parallel for num_threads(num_threads) schedule(static) reduction(max:max_node)
+	for (size_t i = 0; i < edges.size(); i++) {
+		max_node = std::max(max_node, std::max(edges[i].src, edges[i].tgt));
+	}
+	return bitsFor(max_node);
+}
+
+/* keyPairs() if pairs is empty, rekeyPairs() otherwise */
+template <typename T, typename KeyFn>
+void setPairKeys(std::vector<T> const& items, std::vector<KeyIndex>& pairs, KeyFn key, uint num_threads)
+{
+	if (pairs.empty()) pairs = keyPairs(items, key, num_threads);
+	else rekeyPairs(items, pairs, key, num_threads);
+}
+
+/*
+ * Stable sort of pairs (empty for the original order of the edges) by
+ * (major, minor) node of the edges. Both node ids are packed into one key
+ * if they fit, so only with huge node ids (CHC_NODE_ID_BITS=64) two
+ * passes are needed.
+ */
+template <typename EdgeT>
+void sortPairsByNodes(std::vector<EdgeT> const& edges, std::vector<KeyIndex>& pairs,
+		NodeID EdgeT::* major, NodeID EdgeT::* minor, uint node_bits, uint num_threads)
+{
+	if (2 * node_bits <= 64) {
+		setPairKeys(edges, pairs, [major, minor, node_bits](EdgeT const& edge) {
+			return (uint64_t(edge.*major) << node_bits) | edge.*minor;
+		}, num_threads);
+	}
+	else {
+		setPairKeys(edges, pairs, [minor](EdgeT const& edge) { return uint64_t(edge.*minor); }, num_threads);
+		radixSortKeys(pairs, num_threads);
+		rekeyPairs(edges, pairs, [major](EdgeT const& edge) { return uint64_t(edge.*major); }, num_threads);
+	}
+	radixSortKeys(pairs, num_threads);
+}
+
+/* true if the edges are sorted already or small enough for std::stable_sort */
+template <typename EdgeT, typename Compare>
+bool sortedWithoutRadix(std::vector<EdgeT>& edges, Compare comp)
+{
+	if (edges.size() < MIN_RADIX_SORT_SIZE) {
+		std::stable_sort(edges.begin(), edges.end(), comp);
+		return true;
+	}
+	/* e.g. edges read from CH files */
+	return std::is_sorted(edges.begin(), edges.end(), comp);
+}
+
+/*
+ * Sorts edges in the order of the given comparator, which is only used
+ * to select the key (and for small inputs).
+ */
+template <typename EdgeT>
+void radixSort(std::vector<EdgeT>& edges, EdgeSortSrcTgt<EdgeT> comp, uint num_threads)
+{
+	if (sortedWithoutRadix(edges, comp)) return;
+
+	std::vector<KeyIndex> pairs;
+	sortPairsByNodes<EdgeT>(edges, pairs, &EdgeT::src, &EdgeT::tgt, nodeBits(edges, num_threads), num_threads);
+	applyOrder(edges, pairs, num_threads);
+}
+
+template <typename EdgeT>
+void radixSort(std::vector<EdgeT>& edges, EdgeSortTgtSrc<EdgeT> comp, uint num_threads)
+{
+	if (sortedWithoutRadix(edges, comp)) return;
+
+	std::vector<KeyIndex> pairs;
+	sortPairsByNodes<EdgeT>(edges, pairs, &EdgeT::tgt, &EdgeT::src, nodeBits(edges, num_threads), num_threads);
+	applyOrder(edges, pairs, num_threads);
+}
+
+template <typename EdgeT>
+void radixSort(std::vector<EdgeT>& edges, EdgeSortSrcTgtDist<EdgeT> comp, uint num_threads)
+{
+	if (sortedWithoutRadix(edges, comp)) return;
+	uint64_t max_dist(0);
+	#pragma omp parallel for num_threads(num_threads) schedule(static) reduction(max:max_dist)
+	for (size_t i = 0; i < edges.size(); i++) {
+		max_dist = std::max<uint64_t>(max_dist, edges[i].dist);
+	}
+
+	uint const node_bits(nodeBits(edges, num_threads));
+	uint const dist_bits(bitsFor(max_dist));
+
+	std::vector<KeyIndex> pairs;
+	if (dist_bits < 64 && 2 * node_bits + dist_bits <= 64) {
+		/* everything fits into one key */
+		pairs = keyPairs(edges, [node_bits, dist_bits](EdgeT const& edge) {
+			return (((uint64_t(edge.src) << node_bits) | edge.tgt) << dist_bits) | edge.dist;
+		}, num_threads);
+		radixSortKeys(pairs, num_threads);
+	}
+	else {
+		pairs = keyPairs(edges, [](EdgeT const& edge) { return uint64_t(edge.dist); }, num_threads);
+		radixSortKeys(pairs, num_threads);
+		sortPairsByNodes<EdgeT>(edges, pairs, &EdgeT::src, &EdgeT::tgt, node_bits, num_threads);
+	}
+	applyOrder(edges, pairs, num_threads);
+}
+
+}
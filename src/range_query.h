@@ -0,0 +1,179 @@
+#pragma once
+
+#include "chgraph.h"
+#include "phast.h"
+#include "labels.h"
+
+#include <vector>
+#include <queue>
+#include <functional>
+
+namespace chc
+{
+
+namespace unit_tests
+{
+	void testRangeQuery();
+}
+
+/*
+ * Range (isochrone) queries on a CH: finds all nodes within a distance
+ * limit of a source.
+ *
+ * An upward search limited to the distance settles the start labels, then a
+ * pruned downward sweep only visits nodes that actually got a label within
+ * the limit; they are processed in rank order (descending level), so every
+ * label is final before its downward edges are relaxed. The work depends on
+ * the size of the range and not on the size of the graph.
+ * Requires the complete CH (see CHGraph::rebuildCompleteGraph).
+ */
+template <typename NodeT, typename EdgeT>
+class CHRangeQuery
+{
+	private:
+		typedef std::priority_queue<NodeID, std::vector<NodeID>, std::greater<NodeID> > RankPQ;
+
+		struct DownOutEdge
+		{
+			NodeID tgt_rank;
+			uint dist;
+		};
+
+		CHGraph<NodeT, EdgeT> const& _g;
+		DownwardSweepGraph _down;
+		CHUpwardSearch<NodeT, EdgeT> _up;
+
+		/* downward edges grouped by the rank of their source */
+		std::vector<EdgeID> _down_out_offsets;
+		std::vector<DownOutEdge> _down_out_edges;
+
+		/* indexed by rank */
+		StampedLabels<uint> _dists;
+
+		uint _max_dist = c::NO_DIST;
+		std::vector<NodeID> _in_range;
+
+		void _reset();
+	public:
+		CHRangeQuery(CHGraph<NodeT, EdgeT> const& g);
+
+		/* finds all nodes with a distance of at most max_dist from src */
+		void calcRange(NodeID src, uint max_dist);
+
+		/* nodes found by the last calcRange(), ordered by descending level */
+		std::vector<NodeID> const& nodesInRange() const { return _in_range; }
+		/* c::NO_DIST for nodes not in range */
+		uint getDist(NodeID node_id) const { return _dists[_down.rank[node_id]]; }
+
+		/*
+		 * Original (non-shortcut) edges leaving the range: the source is in
+		 * range, but the end of the edge is beyond the distance limit.
+		 */
+		std::vector<EdgeID> getBoundaryEdges() const;
+
+		/* coordinates of the nodes in range, same order as nodesInRange() */
+		std::vector<GeoNode> getNodeCoordinates() const;
+
+		friend void unit_tests::testRangeQuery();
+};
+
+template <typename NodeT, typename EdgeT>
+CHRangeQuery<NodeT, EdgeT>::CHRangeQuery(CHGraph<NodeT, EdgeT> const& g)
+	: _g(g), _down(g), _up(g), _dists(g.getNrOfNodes(), c::NO_DIST)
+{
+	NodeID nr_of_ranks(_down.getNrOfNodes());
+
+	/* transpose the (by target grouped) down edges of the sweep graph */
+	_down_out_offsets.assign(nr_of_ranks + 1, 0);
+	for (auto const& edge: _down.edges) {
+		_down_out_offsets[edge.src_rank + 1]++;
+	}
+	for (NodeID r(0); r<nr_of_ranks; r++) {
+		_down_out_offsets[r + 1] += _down_out_offsets[r];
+	}
+
+	std::vector<EdgeID> pos(_down_out_offsets.begin(), _down_out_offsets.end() - 1);
+	_down_out_edges.resize(_down.edges.size());
+	for (NodeID tgt_rank(0); tgt_rank<nr_of_ranks; tgt_rank++) {
+		for (EdgeID i(_down.offsets[tgt_rank]); i<_down.offsets[tgt_rank + 1]; i++) {
+			auto const& edge(_down.edges[i]);
+			_down_out_edges[pos[edge.src_rank]++] = DownOutEdge { tgt_rank, edge.dist };
+		}
+	}
+}
+
+template <typename NodeT, typename EdgeT>
+void CHRangeQuery<NodeT, EdgeT>::calcRange(NodeID src, uint max_dist)
+{
+	_reset();
+	_max_dist = max_dist;
+
+	RankPQ pq;
+
+	_up.run(src, EdgeType::OUT, max_dist);
+	for (NodeID node: _up.settled()) {
+		NodeID r(_down.rank[node]);
+		_dists.set(r, _up.getDist(node));
+		pq.push(r);
+	}
+
+	while (!pq.empty()) {
+		NodeID r(pq.top());
+		pq.pop();
+
+		uint dist(_dists[r]);
+		_in_range.push_back(_down.order[r]);
+
+		for (EdgeID i(_down_out_offsets[r]), end(_down_out_offsets[r + 1]); i<end; i++) {
+			auto const& edge(_down_out_edges[i]);
+			uint new_dist(dist + edge.dist);
+
+			if (new_dist <= max_dist && new_dist < _dists[edge.tgt_rank]) {
+				if (!_dists.isSet(edge.tgt_rank)) {
+					pq.push(edge.tgt_rank);
+				}
+				_dists.set(edge.tgt_rank, new_dist);
+			}
+		}
+	}
+}
+
+template <typename NodeT, typename EdgeT>
+std::vector<EdgeID> CHRangeQuery<NodeT, EdgeT>::getBoundaryEdges() const
+{
+	std::vector<EdgeID> boundary;
+
+	for (NodeID node: _in_range) {
+		uint dist(getDist(node));
+		for (auto const& edge: _g.nodeEdges(node, EdgeType::OUT)) {
+			if (edge.center_node != c::NO_NID) continue; /* skip shortcuts */
+			if (dist + edge.distance() > _max_dist) {
+				boundary.push_back(edge.id);
+			}
+		}
+	}
+
+	return boundary;
+}
+
+template <typename NodeT, typename EdgeT>
+std::vector<GeoNode> CHRangeQuery<NodeT, EdgeT>::getNodeCoordinates() const
+{
+	std::vector<GeoNode> coordinates;
+	coordinates.reserve(_in_range.size());
+
+	for (NodeID node: _in_range) {
+		coordinates.push_back(static_cast<GeoNode>(_g.getNode(node)));
+	}
+
+	return coordinates;
+}
+
+template <typename NodeT, typename EdgeT>
+void CHRangeQuery<NodeT, EdgeT>::_reset()
+{
+	_dists.reset();
+	_in_range.clear();
+}
+
+}
@@ -0,0 +1,125 @@
+#include "defs.h"
+#include "nodes_and_edges.h"
+#include "file_formats.h"
+#include "chgraph.h"
+#include "ch_constructor.h"
+#include "dijkstra.h"
+#include "compressed_chgraph.h"
+#include "priority_queues.h"
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Micro-benchmarks; not part of the unit tests.
+ *
+ * Usage: ./run_benchmarks [graph file in STD format] [number of queries]
+ * (defaults to ../test_data/15kSZHK.txt and 1000 queries, i.e. run it from src/)
+ */
+
+using namespace chc;
+
+namespace
+{
+	typedef std::vector<std::pair<NodeID, NodeID>> Queries;
+
+	Queries randomQueries(uint nr_of_nodes, uint nr_of_queries)
+	{
+		std::mt19937 gen(42); /* fixed seed: same queries for all candidates */
+		std::uniform_int_distribution<uint> dist(0, nr_of_nodes - 1);
+
+		Queries queries;
+		for (uint i(0); i<nr_of_queries; i++) {
+			queries.emplace_back(dist(gen), dist(gen));
+		}
+		return queries;
+	}
+
+	template <typename Query>
+	void runQueries(std::string const& title, Query& query, Queries const& queries)
+	{
+		using namespace std::chrono;
+
+		std::vector<EdgeID> path;
+		uint64_t checksum(0);
+
+		steady_clock::time_point t1 = steady_clock::now();
+		for (auto const& q: queries) {
+			checksum += query.calcShopa(q.first, q.second, path);
+		}
+		duration<double> time_span = duration_cast<duration<double>>(steady_clock::now() - t1);
+
+		std::cout << title << ": " << time_span.count() << " seconds, "
+			<< time_span.count() * 1e6 / queries.size() << " us/query (checksum " << checksum << ")\n";
+	}
+
+	void benchPriorityQueues(std::string const& filename, uint nr_of_queries)
+	{
+		typedef CHEdge<OSMEdge> Shortcut;
+
+		std::cout << "\nPriority queues on " << filename << "\n";
+
+		Graph<OSMNode, OSMEdge> g;
+		g.init(FormatSTD::Reader::readGraph<OSMNode, OSMEdge>(filename));
+
+		CHGraph<OSMNode, OSMEdge> chg;
+		chg.init(FormatSTD::Reader::readGraph<OSMNode, Shortcut>(filename));
+		CHConstructor<OSMNode, OSMEdge> chc(chg, 1);
+		std::vector<NodeID> all_nodes(chg.getNrOfNodes());
+		for (NodeID i(0); i<all_nodes.size(); i++) {
+			all_nodes[i] = i;
+		}
+		chc.quickContract(all_nodes, 4, 5);
+		chc.contract(all_nodes);
+		chc.rebuildCompleteGraph();
+
+		auto queries(randomQueries(g.getNrOfNodes(), nr_of_queries));
+
+		{
+			Dijkstra<OSMNode, OSMEdge, StdPriorityQueue> dij(g);
+			runQueries("Dijkstra   / std::priority_queue", dij, queries);
+		}
+		{
+			Dijkstra<OSMNode, OSMEdge, BinaryHeap> dij(g);
+			runQueries("Dijkstra   / BinaryHeap         ", dij, queries);
+		}
+		{
+			Dijkstra<OSMNode, OSMEdge, RadixHeap> dij(g);
+			runQueries("Dijkstra   / RadixHeap          ", dij, queries);
+		}
+		{
+			CHDijkstra<OSMNode, OSMEdge, StdPriorityQueue> chdij(chg);
+			runQueries("CHDijkstra / std::priority_queue", chdij, queries);
+		}
+		{
+			CHDijkstra<OSMNode, OSMEdge, BinaryHeap> chdij(chg);
+			runQueries("CHDijkstra / BinaryHeap         ", chdij, queries);
+		}
+		{
+			CHDijkstra<OSMNode, OSMEdge, RadixHeap> chdij(chg);
+			runQueries("CHDijkstra / RadixHeap          ", chdij, queries);
+		}
+		{
+			CompressedCHGraph compressed_chg(chg);
+			CHDijkstra<OSMNode, OSMEdge, RadixHeap, CompressedCHGraph> chdij(compressed_chg);
+			runQueries("CHDijkstra / RadixHeap, compr.  ", chdij, queries);
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::string filename("../test_data/15kSZHK.txt");
+	uint nr_of_queries(1000);
+
+	if (argc > 1) filename = argv[1];
+	if (argc > 2) nr_of_queries = std::stoi(argv[2]);
+
+	benchPriorityQueues(filename, nr_of_queries);
+
+	return 0;
+}
@@ -0,0 +1,146 @@
+#include "text_formatter.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace chc
+{
+
+namespace
+{
+	__extension__ typedef unsigned __int128 uint128_t;
+
+	char const digit_pairs[] =
+		"00010203040506070809"
+		"10111213141516171819"
+		"20212223242526272829"
+		"30313233343536373839"
+		"40414243444546474849"
+		"50515253545556575859"
+		"60616263646566676869"
+		"70717273747576777879"
+		"80818283848586878889"
+		"90919293949596979899";
+
+	uint64_t const powers_of_ten[] = {
+		1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+		100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+		10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+		100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+	};
+	int const MAX_FAST_PRECISION = 9;
+	/* larger exponents might not fit into 128 bits after scaling */
+	int const MAX_FAST_EXPONENT = 40;
+
+	uint nrOfDigits(uint64_t value)
+	{
+		uint digits(1);
+		while (digits < 20 && value >= powers_of_ten[digits]) digits++;
+		return digits;
+	}
+
+	/* writes exactly width digits of value (which has to fit) */
+	void formatDigits(char* out, uint64_t value, uint width)
+	{
+		char* pos(out + width);
+		while (value >= 100) {
+			uint pair(value % 100);
+			value /= 100;
+			pos -= 2;
+			std::memcpy(pos, digit_pairs + 2 * pair, 2);
+		}
+		if (value >= 10) {
+			pos -= 2;
+			std::memcpy(pos, digit_pairs + 2 * value, 2);
+		}
+		else if (pos != out) {
+			*--pos = char('0' + value);
+		}
+		while (pos != out) *--pos = '0';
+	}
+
+	char* formatUnsigned128(char* out, uint128_t value)
+	{
+		if (value <= uint128_t(UINT64_MAX)) {
+			return TextFormatter::formatUnsigned(out, uint64_t(value));
+		}
+
+		/* split into chunks of 19 digits */
+		uint64_t const chunk(powers_of_ten[19]);
+		uint64_t low(value % chunk);
+		value /= chunk;
+		out = formatUnsigned128(out, value);
+		formatDigits(out, low, 19);
+		return out + 19;
+	}
+}
+
+char* TextFormatter::formatUnsigned(char* out, uint64_t value)
+{
+	uint digits(nrOfDigits(value));
+	formatDigits(out, value, digits);
+	return out + digits;
+}
+
+char* TextFormatter::formatSigned(char* out, int64_t value)
+{
+	if (value < 0) {
+		*out++ = '-';
+		return formatUnsigned(out, uint64_t(0) - uint64_t(value));
+	}
+	return formatUnsigned(out, uint64_t(value));
+}
+
+char* TextFormatter::formatFixed(char* out, double value, int precision)
+{
+	uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	int biased_exponent((bits >> 52) & 0x7ff);
+	uint64_t mantissa(bits & ((uint64_t(1) << 52) - 1));
+
+	/* value = mantissa * 2^exponent */
+	int exponent;
+	if (biased_exponent == 0) {
+		exponent = -1074;
+	}
+	else {
+		mantissa |= uint64_t(1) << 52;
+		exponent = biased_exponent - 1075;
+	}
+
+	if (biased_exponent == 0x7ff || precision < 0 || precision > MAX_FAST_PRECISION || exponent > MAX_FAST_EXPONENT) {
+		return out + std::snprintf(out, MAX_VALUE_LENGTH, "%.*f", precision, value);
+	}
+
+	/* value * 10^precision, rounded to nearest (ties to even) on the exact value */
+	uint128_t scaled(uint128_t(mantissa) * powers_of_ten[precision]);
+	if (exponent >= 0) {
+		scaled <<= exponent;
+	}
+	else if (-exponent >= 128) {
+		/* scaled < 2^83, so the result is smaller than 0.5 */
+		scaled = 0;
+	}
+	else {
+		int shift(-exponent);
+		uint128_t remainder(scaled & ((uint128_t(1) << shift) - 1));
+		uint128_t half(uint128_t(1) << (shift - 1));
+		scaled >>= shift;
+		if (remainder > half || (remainder == half && (scaled & 1))) {
+			scaled++;
+		}
+	}
+
+	if (bits >> 63) *out++ = '-';
+
+	uint64_t const unit(powers_of_ten[precision]);
+	out = formatUnsigned128(out, scaled / unit);
+	if (precision > 0) {
+		*out++ = '.';
+		formatDigits(out, uint64_t(scaled % unit), precision);
+		out += precision;
+	}
+	return out;
+}
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "defs.h"
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+namespace chc
+{
+
+namespace unit_tests
+{
+	void testTextFormatter();
+}
+
+/*
+ * Counterpart of TextScanner for writing the text formats: numbers are
+ * formatted into a fixed buffer without locales or allocations, and the
+ * buffer is handed to the ostream in one write() (when it runs full, or at
+ * the latest when the formatter is destroyed).
+ *
+ * The output is the same as with an ostream set to std::fixed and the
+ * given precision (7, as used by all writers).
+ */
+class TextFormatter
+{
+	public:
+		/* longest output of a single value: a huge double with all its digits */
+		static constexpr size_t MAX_VALUE_LENGTH = 400;
+
+		/*
+		 * Low-level functions writing into a caller-provided buffer; they
+		 * return the end of the written text. The buffer has to have room for
+		 * 20 digits plus sign for integers, and MAX_VALUE_LENGTH for doubles.
+		 */
+		static char* formatUnsigned(char* out, uint64_t value);
+		static char* formatSigned(char* out, int64_t value);
+		/* like printf("%.*f"); correctly rounded (half to even on the exact value) */
+		static char* formatFixed(char* out, double value, int precision);
+
+	private:
+		std::ostream& _os;
+		int const _precision;
+
+		char _buffer[4 * MAX_VALUE_LENGTH];
+		char* _pos = _buffer;
+
+		/* makes sure there is room for another value */
+		void _reserve()
+		{
+			if (_pos + MAX_VALUE_LENGTH > _buffer + sizeof(_buffer)) flush();
+		}
+
+		TextFormatter(TextFormatter const&) = delete;
+		TextFormatter& operator=(TextFormatter const&) = delete;
+	public:
+		explicit TextFormatter(std::ostream& os, int precision = 7) : _os(os), _precision(precision) { }
+		~TextFormatter() { flush(); }
+
+		void flush()
+		{
+			_os.write(_buffer, _pos - _buffer);
+			_pos = _buffer;
+		}
+
+		TextFormatter& operator<<(unsigned int value) { _reserve(); _pos = formatUnsigned(_pos, value); return *this; }
+		TextFormatter& operator<<(unsigned long value) { _reserve(); _pos = formatUnsigned(_pos, value); return *this; }
+		TextFormatter& operator<<(unsigned long long value) { _reserve(); _pos = formatUnsigned(_pos, value); return *this; }
+		TextFormatter& operator<<(int value) { _reserve(); _pos = formatSigned(_pos, value); return *this; }
+		TextFormatter& operator<<(long value) { _reserve(); _pos = formatSigned(_pos, value); return *this; }
+		TextFormatter& operator<<(long long value) { _reserve(); _pos = formatSigned(_pos, value); return *this; }
+		TextFormatter& operator<<(double value) { _reserve(); _pos = formatFixed(_pos, value, _precision); return *this; }
+
+		TextFormatter& operator<<(char c)
+		{
+			_reserve();
+			*_pos++ = c;
+			return *this;
+		}
+
+		/* only for short literals (separators) */
+		TextFormatter& operator<<(char const* s)
+		{
+			size_t len(std::strlen(s));
+			debug_assert(len < MAX_VALUE_LENGTH);
+			_reserve();
+			std::memcpy(_pos, s, len);
+			_pos += len;
+			return *this;
+		}
+};
+
+}
@@ -0,0 +1,258 @@
+#include "text_scanner.h"
+#include "compression.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <iterator>
+
+namespace chc
+{
+
+namespace
+{
+	/* powers of ten that are exact doubles */
+	double const exact_powers_of_ten[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+		1e21, 1e22
+	};
+	int const MAX_EXACT_POWER = 22;
+	uint64_t const MAX_EXACT_MANTISSA = uint64_t(1) << 53;
+}
+
+TextScanner::TextScanner(std::string const& filename)
+{
+	Compression compression(compressionOf(filename));
+	if (compression != Compression::NONE) {
+		_source.reset(new DecompressingReader(filename, compression));
+		nextBlock();
+		return;
+	}
+
+	int fd(open(filename.c_str(), O_RDONLY));
+	if (fd < 0) {
+		std::cerr << "FATAL_ERROR: Couldn't open graph file \'" <<
+			filename << "\'. Exiting." << std::endl;
+		std::abort();
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void* data(mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0));
+		if (data != MAP_FAILED) {
+			madvise(data, st.st_size, MADV_SEQUENTIAL);
+			_mapping = data;
+			_mapping_size = st.st_size;
+			_pos = static_cast<char const*>(data);
+			_end = _pos + st.st_size;
+		}
+	}
+
+	if (!_mapping) {
+		/* pipes and the like */
+		char buf[1 << 16];
+		ssize_t len;
+		while ((len = read(fd, buf, sizeof(buf))) > 0) {
+			_buffer.append(buf, len);
+		}
+		_pos = _buffer.data();
+		_end = _pos + _buffer.size();
+	}
+
+	close(fd);
+}
+
+TextScanner::TextScanner(std::istream& is)
+	: _buffer(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>())
+{
+	_pos = _buffer.data();
+	_end = _pos + _buffer.size();
+}
+
+TextScanner::~TextScanner()
+{
+	if (_mapping) munmap(_mapping, _mapping_size);
+}
+
+bool TextScanner::nextBlock()
+{
+	_pos = _end;
+	if (!_source || !_source->next(_buffer)) return false;
+
+	_pos = _buffer.data();
+	_end = _pos + _buffer.size();
+	return true;
+}
+
+TextScanner& TextScanner::getline(std::string& line)
+{
+	line.clear();
+	if (!_refill()) {
+		_eof = _fail = true;
+		return *this;
+	}
+
+	char const* begin(_pos);
+	while (_pos != _end && *_pos != '\n') ++_pos;
+	line.assign(begin, _pos);
+
+	if (_pos == _end) _eof = true;
+	else ++_pos;
+	return *this;
+}
+
+std::vector<char const*> TextScanner::splitLines(char const* begin, char const* end, size_t nr_of_chunks)
+{
+	std::vector<char const*> borders { begin };
+	size_t chunk_size((end - begin) / std::max<size_t>(nr_of_chunks, 1) + 1);
+
+	char const* pos(begin);
+	while (pos != end) {
+		pos = (size_t(end - pos) > chunk_size) ? pos + chunk_size : end;
+		/* move behind the next newline */
+		char const* newline(static_cast<char const*>(std::memchr(pos - 1, '\n', end - pos + 1)));
+		pos = newline ? newline + 1 : end;
+		borders.push_back(pos);
+	}
+	if (borders.size() == 1) borders.push_back(end);
+	return borders;
+}
+
+size_t TextScanner::countNonBlankLines(char const* begin, char const* end)
+{
+	size_t count(0);
+	bool blank(true);
+	for (char const* pos(begin); pos != end; ++pos) {
+		if (*pos == '\n') {
+			if (!blank) count++;
+			blank = true;
+		}
+		else if (!_isSpace(*pos)) {
+			blank = false;
+		}
+	}
+	if (!blank) count++;
+	return count;
+}
+
+bool TextScanner::_readInteger(uint64_t& value, bool& negative)
+{
+	_skipSpaces();
+	if (_pos == _end) {
+		_eof = true;
+		return false;
+	}
+
+	negative = (*_pos == '-');
+	if (*_pos == '-' || *_pos == '+') ++_pos;
+
+	if (_pos == _end || !_isDigit(*_pos)) return false;
+
+	uint64_t v(0);
+	for (; _pos != _end && _isDigit(*_pos); ++_pos) {
+		uint64_t digit(*_pos - '0');
+		if (v > (std::numeric_limits<uint64_t>::max() - digit) / 10) return false;
+		v = v * 10 + digit;
+	}
+	if (_pos == _end) _eof = true;
+
+	value = v;
+	return true;
+}
+
+bool TextScanner::_readDouble(double& value)
+{
+	_skipSpaces();
+	if (_pos == _end) {
+		_eof = true;
+		return false;
+	}
+
+	char const* begin(_pos);
+	char const* p(_pos);
+
+	bool negative(*p == '-');
+	if (*p == '-' || *p == '+') ++p;
+
+	uint64_t mantissa(0);
+	int nr_of_digits(0); /* significant digits in mantissa */
+	int exponent(0);
+	bool any_digit(false);
+
+	for (; p != _end && _isDigit(*p); ++p) {
+		any_digit = true;
+		if (mantissa == 0 && *p == '0') continue;
+		if (nr_of_digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			nr_of_digits++;
+		}
+		else {
+			exponent++;
+		}
+	}
+	if (p != _end && *p == '.') {
+		++p;
+		for (; p != _end && _isDigit(*p); ++p) {
+			any_digit = true;
+			if (mantissa == 0 && *p == '0') {
+				exponent--;
+				continue;
+			}
+			if (nr_of_digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				nr_of_digits++;
+				exponent--;
+			}
+		}
+	}
+	if (!any_digit) return false;
+
+	bool fast_path(nr_of_digits < 19);
+	if (p != _end && (*p == 'e' || *p == 'E')) {
+		char const* q(p + 1);
+		bool negative_exp(q != _end && *q == '-');
+		if (q != _end && (*q == '-' || *q == '+')) ++q;
+		if (q != _end && _isDigit(*q)) {
+			int exp10(0);
+			for (; q != _end && _isDigit(*q); ++q) {
+				if (exp10 < 10000) exp10 = exp10 * 10 + (*q - '0');
+			}
+			exponent += negative_exp ? -exp10 : exp10;
+			p = q;
+		}
+	}
+
+	if (fast_path && mantissa < MAX_EXACT_MANTISSA && std::abs(exponent) <= MAX_EXACT_POWER) {
+		/* both operands are exact, so the single rounding gives the correct result */
+		double d(static_cast<double>(mantissa));
+		d = exponent < 0 ? d / exact_powers_of_ten[-exponent] : d * exact_powers_of_ten[exponent];
+		value = negative ? -d : d;
+	}
+	else {
+		/* the buffer isn't null terminated */
+		std::string token(begin, p);
+		value = std::strtod(token.c_str(), nullptr);
+	}
+
+	_pos = p;
+	if (_pos == _end) _eof = true;
+	return true;
+}
+
+TextScanner& TextScanner::operator>>(double& value)
+{
+	if (!_readDouble(value)) {
+		value = 0;
+		_fail = true;
+	}
+	return *this;
+}
+
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "defs.h"
+
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace chc
+{
+
+namespace unit_tests
+{
+	void testTextScanner();
+}
+
+class DecompressingReader;
+
+/*
+ * Fast replacement for reading the text formats with std::istream: the
+ * whole input is mapped (or read in one go for streams) and numbers are
+ * parsed directly from the buffer, without locales and virtual calls.
+ *
+ * Mimics the used subset of std::istream: operator>> skips leading
+ * whitespace and sets fail() on malformed input, peek() and eof() behave
+ * like their istream counterparts.
+ *
+ * Doubles are parsed exactly with Clinger's fast path (mantissa < 2^53 and
+ * a decimal exponent of at most 22) and fall back to strtod() otherwise.
+ *
+ * Compressed files (see compression.h) are decompressed on another thread
+ * and scanned block by block; blocks end after a newline, so a value never
+ * spans two of them.
+ */
+class TextScanner
+{
+	private:
+		char const* _pos = nullptr;
+		char const* _end = nullptr;
+
+		/* either the mapping or the buffer is used */
+		void* _mapping = nullptr;
+		size_t _mapping_size = 0;
+		std::string _buffer;
+		/* refills _buffer for compressed files */
+		std::unique_ptr<DecompressingReader> _source;
+
+		bool _fail = false;
+		bool _eof = false;
+
+		/* loads the next block if the current one is used up */
+		bool _refill()
+		{
+			return _pos != _end || nextBlock();
+		}
+
+		void _skipSpaces()
+		{
+			do {
+				while (_pos != _end && _isSpace(*_pos)) ++_pos;
+			} while (_pos == _end && nextBlock());
+		}
+
+		static bool _isSpace(char c)
+		{
+			return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+		}
+
+		static bool _isDigit(char c)
+		{
+			return (unsigned char)(c - '0') < 10;
+		}
+
+		/* reads the magnitude of an integer, leaves an optional sign in negative */
+		bool _readInteger(uint64_t& value, bool& negative);
+		bool _readDouble(double& value);
+
+		template<typename T>
+		TextScanner& _readIntegral(T& value);
+
+		TextScanner(TextScanner const&) = delete;
+		TextScanner& operator=(TextScanner const&) = delete;
+	public:
+		static constexpr int EOF_CHAR = -1;
+
+		/* maps (or decompresses) the file; aborts if it can't be opened */
+		explicit TextScanner(std::string const& filename);
+		/* reads the remaining stream */
+		explicit TextScanner(std::istream& is);
+		/* scans [begin, end) of another buffer, which has to outlive the scanner */
+		explicit TextScanner(char const* begin, char const* end) : _pos(begin), _end(end) { }
+		~TextScanner();
+
+		/* the not yet scanned part of the current block (the whole input if not compressed) */
+		char const* current() const { return _pos; }
+		char const* end() const { return _end; }
+		/* drops the rest of the current block and loads the next one; false at the end */
+		bool nextBlock();
+
+		bool fail() const { return _fail; }
+		bool eof() const { return _eof; }
+		explicit operator bool() const { return !_fail; }
+
+		int peek()
+		{
+			if (!_refill()) {
+				_eof = true;
+				return EOF_CHAR;
+			}
+			return (unsigned char) *_pos;
+		}
+
+		/* like std::getline(); the newline is consumed, but not stored */
+		TextScanner& getline(std::string& line);
+
+		/*
+		 * Splits [begin, end) into at most nr_of_chunks pieces of similar size,
+		 * each ending after a newline (or at end); returns the nr + 1 borders.
+		 */
+		static std::vector<char const*> splitLines(char const* begin, char const* end, size_t nr_of_chunks);
+		/* number of lines in [begin, end) containing anything but whitespace */
+		static size_t countNonBlankLines(char const* begin, char const* end);
+
+		TextScanner& operator>>(unsigned short& value) { return _readIntegral(value); }
+		TextScanner& operator>>(unsigned int& value) { return _readIntegral(value); }
+		TextScanner& operator>>(int& value) { return _readIntegral(value); }
+		TextScanner& operator>>(unsigned long& value) { return _readIntegral(value); }
+		TextScanner& operator>>(long& value) { return _readIntegral(value); }
+		TextScanner& operator>>(unsigned long long& value) { return _readIntegral(value); }
+		TextScanner& operator>>(long long& value) { return _readIntegral(value); }
+		TextScanner& operator>>(double& value);
+};
+
+template<typename T>
+TextScanner& TextScanner::_readIntegral(T& value)
+{
+	static_assert(sizeof(T) <= sizeof(uint64_t), "integer type too large");
+
+	/* same results as std::istream: 0 if malformed, the limits on overflow */
+	uint64_t magnitude;
+	bool negative;
+	if (!_readInteger(magnitude, negative)) {
+		value = 0;
+		_fail = true;
+		return *this;
+	}
+
+	/* unsigned types accept negated values */
+	typedef typename std::make_unsigned<T>::type U;
+	if (std::is_signed<T>::value) {
+		uint64_t limit(uint64_t(std::numeric_limits<T>::max()) + (negative ? 1 : 0));
+		if (magnitude > limit) {
+			value = negative ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+			_fail = true;
+			return *this;
+		}
+	}
+	else if (magnitude > uint64_t(std::numeric_limits<U>::max())) {
+		value = std::numeric_limits<T>::max();
+		_fail = true;
+		return *this;
+	}
+
+	U u(static_cast<U>(magnitude));
+	value = static_cast<T>(negative ? U(0) - u : u);
+	return *this;
+}
+
+}
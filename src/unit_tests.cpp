@@ -7,16 +7,37 @@
 
 #include "nodes_and_edges.h"
 #include "graph.h"
+#include "radix_sort.h"
+#include "node_order.h"
+#include "edge_spill.h"
 #include "file_formats.h"
+#include "text_scanner.h"
+#include "text_formatter.h"
+#include "mapped_chgraph.h"
+#include "compressed_chgraph.h"
+#include "compression.h"
+#include "graph_cache.h"
 #include "chgraph.h"
 #include "ch_constructor.h"
 #include "dijkstra.h"
+#include "phast.h"
+#include "range_query.h"
+#include "query_server.h"
 #include "prioritizers.h"
 
+#include <cmath>
+#include <limits>
 #include <map>
+#include <set>
+#include <tuple>
+#include <sstream>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <random>
 #include <chrono>
+#include <cstdio>
+#include <thread>
 
 namespace chc
 {
@@ -25,10 +46,22 @@ void unit_tests::testAll()
 {
 	unit_tests::testNodesAndEdges();
 	unit_tests::testGraph();
+	unit_tests::testRadixSort();
+	unit_tests::testNodeOrder();
 	unit_tests::testCHConstructor();
+	unit_tests::testEdgeSpill();
 	unit_tests::testCHDijkstra();
 	unit_tests::testDijkstra();
+	unit_tests::testTextScanner();
+	unit_tests::testTextFormatter();
+	unit_tests::testCHFileFormats();
+	unit_tests::testCompressedCHGraph();
+	unit_tests::testCompression();
+	unit_tests::testGraphCache();
 	unit_tests::testPrioritizers();
+	unit_tests::testPHAST();
+	unit_tests::testRangeQuery();
+	unit_tests::testQueryServer();
 }
 
 void unit_tests::testNodesAndEdges()
@@ -50,6 +83,11 @@ void unit_tests::testNodesAndEdges()
 
 	Test(otherNode(edge0, EdgeType::IN) == 0);
 	Test(otherNode(ch_edge, EdgeType::OUT) == 2);
+	Test(ch_edge.distance() == 66 && ch_edge.metric == 55);
+
+	/* the largest distance (c::NO_EDGE_DIST) is reserved, all below fit */
+	Test(addDistances(c::NO_EDGE_DIST - 2, 1) == c::NO_EDGE_DIST - 1);
+	Test(addDistances(0, c::NO_EDGE_DIST - 1) == c::NO_EDGE_DIST - 1);
 
 	Print("\n======================================");
 	Print("TEST: Nodes and edges test successful.");
@@ -82,6 +120,22 @@ void unit_tests::testGraph()
 
 			Test(found);
 		}
+
+		/* The incoming edges are the stored edges, sorted by src. */
+		NodeID last_src(0);
+		for (auto const& in_edge: g.nodeEdges(node_id, EdgeType::IN)) {
+			Test(in_edge.tgt == node_id && in_edge.src >= last_src);
+			Test(&in_edge == &g.getEdge(in_edge.id));
+			last_src = in_edge.src;
+		}
+
+		/* The adjacency arrays mirror the outgoing edges. */
+		auto adjacency(g.nodeAdjacency(node_id, EdgeType::OUT));
+		Test(adjacency.size == g.getNrOfEdges(node_id, EdgeType::OUT));
+		for (uint i(0); i<adjacency.size; i++) {
+			Test(adjacency.edge(i).src == node_id);
+			Test(adjacency.nodes[i] == adjacency.edge(i).tgt && adjacency.dists[i] == adjacency.edge(i).distance());
+		}
 	}
 
 	Print("\n============================");
@@ -89,6 +143,217 @@ void unit_tests::testGraph()
 	Print("============================\n");
 }
 
+namespace
+{
+	/* the radix sort is stable, so the result is exactly the stable_sort one */
+	template <typename Compare>
+	void checkRadixSort(std::vector<Edge> const& edges, Compare comp)
+	{
+		auto expected(edges);
+		std::stable_sort(expected.begin(), expected.end(), comp);
+		for (uint num_threads: {1, 4}) {
+			auto sorted(edges);
+			radixSort(sorted, comp, num_threads);
+			for (EdgeID i(0); i<edges.size(); i++) {
+				Test(sorted[i].id == expected[i].id);
+			}
+		}
+	}
+}
+
+void unit_tests::testRadixSort()
+{
+	Print("\n============================");
+	Print("TEST: Start radix sort test.");
+	Print("============================\n");
+
+	/* large enough to not fall back to std::sort */
+	uint const nr_of_edges(5 * MIN_RADIX_SORT_SIZE);
+
+	std::default_random_engine gen(17);
+	std::uniform_int_distribution<NodeID> node_dist(0, 3000);
+	std::uniform_int_distribution<uint> dist_dist(0, 5);
+	std::vector<Edge> edges;
+	for (EdgeID i(0); i<nr_of_edges; i++) {
+		edges.emplace_back(i, node_dist(gen), node_dist(gen), dist_dist(gen));
+	}
+
+	checkRadixSort(edges, EdgeSortSrcTgt<Edge>());
+	checkRadixSort(edges, EdgeSortTgtSrc<Edge>());
+	checkRadixSort(edges, EdgeSortSrcTgtDist<Edge>());
+
+	/* with large node ids, src, tgt and dist don't fit into one key anymore */
+	edges[7].src = c::NO_NID - 1;
+	edges[8].tgt = c::NO_NID - 1;
+	edges[9].dist = c::NO_EDGE_DIST - 1;
+
+	checkRadixSort(edges, EdgeSortSrcTgt<Edge>());
+	checkRadixSort(edges, EdgeSortTgtSrc<Edge>());
+	checkRadixSort(edges, EdgeSortSrcTgtDist<Edge>());
+
+	/* full 64 bit keys */
+	std::uniform_int_distribution<uint64_t> key_dist;
+	std::vector<KeyIndex> pairs(nr_of_edges);
+	for (uint i(0); i<nr_of_edges; i++) {
+		pairs[i].key = key_dist(gen) >> (i % 64);
+		pairs[i].index = i;
+	}
+	radixSortKeys(pairs, 4);
+	for (uint i(1); i<nr_of_edges; i++) {
+		Test(pairs[i-1].key < pairs[i].key || (pairs[i-1].key == pairs[i].key && pairs[i-1].index < pairs[i].index));
+	}
+
+	/* in place permutation by id */
+	auto by_id(edges);
+	std::shuffle(by_id.begin(), by_id.end(), gen);
+	sortById(by_id);
+	for (EdgeID i(0); i<nr_of_edges; i++) {
+		Test(by_id[i].id == i && equalEndpoints(by_id[i], edges[i]) && by_id[i].dist == edges[i].dist);
+	}
+
+	Print("\n==================================");
+	Print("TEST: Radix sort test successful.");
+	Print("==================================\n");
+}
+
+void unit_tests::testNodeOrder()
+{
+	Print("\n=============================");
+	Print("TEST: Start node order test.");
+	Print("=============================\n");
+
+	typedef CHEdge<OSMEdge> Shortcut;
+
+	/* the curve visits a 4x4 corner in 16 steps between neighbouring cells */
+	std::vector<std::pair<uint64_t, std::pair<uint32_t, uint32_t>>> cells;
+	for (uint32_t x(0); x<4; x++) {
+		for (uint32_t y(0); y<4; y++) {
+			cells.push_back(std::make_pair(hilbertIndex(x, y), std::make_pair(x, y)));
+		}
+	}
+	std::sort(cells.begin(), cells.end());
+	for (uint i(0); i<cells.size(); i++) {
+		Test(cells[i].first == i);
+		if (i == 0) continue;
+		auto const& a(cells[i-1].second);
+		auto const& b(cells[i].second);
+		Test(std::max(a.first, b.first) - std::min(a.first, b.first) + std::max(a.second, b.second) - std::min(a.second, b.second) == 1);
+	}
+
+	auto data(FormatSTD::Reader::readGraph<OSMNode, Shortcut>("../test_data/15kSZHK.txt"));
+	auto isPermutation = [](std::vector<NodeID> order) {
+		std::sort(order.begin(), order.end());
+		for (NodeID i(0); i<order.size(); i++) {
+			if (order[i] != i) return false;
+		}
+		return true;
+	};
+
+	auto hilbert_order(hilbertOrder(data.nodes, 2));
+	auto bfs_order(bfsOrder(data.nodes.size(), data.edges));
+	Test(hilbert_order.size() == data.nodes.size() && isPermutation(hilbert_order));
+	Test(bfs_order.size() == data.nodes.size() && isPermutation(bfs_order));
+	Test(localityOrder(data.nodes, data.edges, 2) == hilbert_order);
+	std::vector<Node> plain_nodes(data.nodes.size());
+	Test(localityOrder(plain_nodes, data.edges, 2) == bfs_order);
+
+	auto edgeSpan = [](std::vector<Shortcut> const& edges) {
+		uint64_t span(0);
+		for (auto const& edge: edges) {
+			span += std::max(edge.src, edge.tgt) - std::min(edge.src, edge.tgt);
+		}
+		return span / edges.size();
+	};
+
+	/* contract the renumbered graph; the export has the original ids again */
+	auto renumbered(data);
+	auto new_ids(inversePermutation(hilbert_order));
+	renumberNodes(renumbered.nodes, renumbered.edges, new_ids, 2);
+	Print("Average id distance of edge endpoints: " << edgeSpan(data.edges) << " before, " << edgeSpan(renumbered.edges) << " after renumbering.");
+	for (EdgeID i(0); i<data.edges.size(); i++) {
+		Test(renumbered.edges[i].src == new_ids[data.edges[i].src] && renumbered.edges[i].tgt == new_ids[data.edges[i].tgt]);
+	}
+	for (NodeID i(0); i<data.nodes.size(); i++) {
+		Test(renumbered.nodes[new_ids[i]].osm_id == data.nodes[i].osm_id);
+	}
+
+	auto contract = [&](CHGraph<OSMNode, Edge>& chg, std::vector<Shortcut>& edges) {
+		chg.init(GraphInData<OSMNode, CHEdge<Edge>>{renumbered.nodes, slimEdges(edges), renumbered.meta_data});
+		chg.setOriginalNodeIds(hilbert_order);
+
+		CHConstructor<OSMNode, Edge> chc(chg, 2);
+		std::vector<NodeID> all_nodes(chg.getNrOfNodes());
+		for (NodeID i(0); i<all_nodes.size(); i++) {
+			all_nodes[i] = i;
+		}
+		chc.quickContract(all_nodes, 4, 5);
+		chc.contract(all_nodes);
+	};
+
+	std::vector<Shortcut> edges(renumbered.edges);
+	CHGraph<OSMNode, Edge> chg;
+	contract(chg, edges);
+	auto export_data(chg.exportData(edges));
+	Test(export_data.nodes.size() == data.nodes.size());
+	for (NodeID i(0); i<data.nodes.size(); i++) {
+		Test(export_data.nodes[i].id == i && export_data.nodes[i].osm_id == data.nodes[i].osm_id);
+	}
+	Test(std::is_sorted(export_data.edges.begin(), export_data.edges.end(), EdgeSortSrcTgt<Shortcut>()));
+
+	CHGraph<OSMNode, OSMEdge> loaded_chg;
+	loaded_chg.init(GraphCHInData<OSMNode, Shortcut>{export_data.nodes, export_data.node_levels, export_data.edges, export_data.meta_data});
+
+	Graph<OSMNode, OSMEdge> g;
+	g.init(FormatSTD::Reader::readGraph<OSMNode, OSMEdge>("../test_data/15kSZHK.txt"));
+	Dijkstra<OSMNode, OSMEdge> dij(g);
+	CHDijkstra<OSMNode, OSMEdge> chdij(loaded_chg);
+
+	std::default_random_engine gen(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint> dist(0,g.getNrOfNodes()-1);
+	auto rand_node = std::bind (dist, gen);
+	std::vector<EdgeID> path;
+	for (uint i(0); i<10; i++) {
+		NodeID src = rand_node();
+		NodeID tgt = rand_node();
+		Test(dij.calcShopa(src,tgt,path) == chdij.calcShopa(src,tgt,path));
+	}
+
+	/* export by level: descending levels, in Hilbert order within a level */
+	std::vector<Shortcut> level_edges(renumbered.edges);
+	CHGraph<OSMNode, Edge> level_chg;
+	contract(level_chg, level_edges);
+	level_chg.setExportByLevel(true);
+	auto level_data(level_chg.exportData(level_edges));
+	auto const& ids(level_chg.getExportedNodeIds());
+	Test(ids.size() == data.nodes.size() && isPermutation(ids));
+	auto hilbert_pos(inversePermutation(hilbert_order));
+	for (NodeID i(0); i<ids.size(); i++) {
+		Test(level_data.nodes[i].id == i && level_data.nodes[i].osm_id == data.nodes[ids[i]].osm_id);
+		if (i == 0) continue;
+		Test(level_data.node_levels[i-1] >= level_data.node_levels[i]);
+		if (level_data.node_levels[i-1] == level_data.node_levels[i]) Test(hilbert_pos[ids[i-1]] < hilbert_pos[ids[i]]);
+	}
+	Test(std::is_sorted(level_data.edges.begin(), level_data.edges.end(), EdgeSortSrcTgt<Shortcut>()));
+
+	writeNodeIds("../out/ch_15kSZHK_ids.txt", ids);
+	std::ifstream ids_file("../out/ch_15kSZHK_ids.txt");
+	std::vector<NodeID> read_ids((std::istream_iterator<NodeID>(ids_file)), std::istream_iterator<NodeID>());
+	Test(read_ids == ids);
+
+	CHGraph<OSMNode, OSMEdge> level_loaded_chg;
+	level_loaded_chg.init(GraphCHInData<OSMNode, Shortcut>{level_data.nodes, level_data.node_levels, level_data.edges, level_data.meta_data});
+	CHDijkstra<OSMNode, OSMEdge> level_chdij(level_loaded_chg);
+	for (uint i(0); i<10; i++) {
+		NodeID src = rand_node();
+		NodeID tgt = rand_node();
+		Test(dij.calcShopa(ids[src],ids[tgt],path) == level_chdij.calcShopa(src,tgt,path));
+	}
+
+	Print("\n==================================");
+	Print("TEST: Node order test successful.");
+	Print("==================================\n");
+}
+
 void unit_tests::testCHConstructor()
 {
 	Print("\n===============================");
@@ -136,11 +401,203 @@ void unit_tests::testCHConstructor()
 	// Export
 	writeCHGraphFile<FormatSTD::Writer>("../out/ch_test", g.exportData());
 
+	/*
+	 * Contracting on slim edges and reattaching the payloads at the export
+	 * gives the same CH as contracting the full edges.
+	 */
+	auto data(FormatFMI::Reader::readGraph<OSMNode, Shortcut>("../test_data/15kSZHK_fmi.txt"));
+	std::vector<Shortcut> edges(data.edges);
+
+	CHGraphOSM full_g;
+	full_g.init(GraphInData<OSMNode, Shortcut>(data));
+	CHGraph<OSMNode, Edge> slim_g;
+	slim_g.init(GraphInData<OSMNode, CHEdge<Edge>>{data.nodes, slimEdges(edges), data.meta_data});
+
+	std::vector<NodeID> full_nodes(full_g.getNrOfNodes());
+	for (NodeID i(0); i<full_nodes.size(); i++) {
+		full_nodes[i] = i;
+	}
+	std::vector<NodeID> slim_nodes(full_nodes);
+
+	CHConstructor<OSMNode, OSMEdge> chc_full(full_g, 1);
+	chc_full.quickContract(full_nodes, 4, 5);
+	chc_full.contract(full_nodes);
+	CHConstructor<OSMNode, Edge> chc_slim(slim_g, 1);
+	chc_slim.quickContract(slim_nodes, 4, 5);
+	chc_slim.contract(slim_nodes);
+
+	auto full_data(full_g.exportData());
+	auto slim_data(slim_g.exportData(edges));
+	Test(full_data.node_levels == slim_data.node_levels);
+	Test(full_data.edges.size() == slim_data.edges.size());
+	for (EdgeID i(0); i<full_data.edges.size(); i++) {
+		auto const& full_edge(full_data.edges[i]);
+		auto const& slim_edge(slim_data.edges[i]);
+		Test(full_edge.id == slim_edge.id && full_edge.src == slim_edge.src && full_edge.tgt == slim_edge.tgt);
+		Test(full_edge.dist == slim_edge.dist && full_edge.type == slim_edge.type && full_edge.speed == slim_edge.speed);
+		Test(full_edge.child_edge1 == slim_edge.child_edge1 && full_edge.child_edge2 == slim_edge.child_edge2);
+		Test(full_edge.center_node == slim_edge.center_node);
+	}
+
+	/*
+	 * Tie-break of shortcuts with equal endpoints and distance: an edge
+	 * already in the graph is kept, otherwise the first new shortcut in
+	 * the order they were collected. Enough diamonds s -> m1/m2 -> t to
+	 * take the radix sort path.
+	 */
+	NodeID const nr_of_diamonds(3000);
+	std::vector<OSMNode> diamond_nodes(4 * nr_of_diamonds);
+	for (NodeID i(0); i<diamond_nodes.size(); i++) {
+		diamond_nodes[i].id = i;
+	}
+	std::vector<CHEdge<Edge>> diamond_edges;
+	for (NodeID k(0); k<nr_of_diamonds; k++) {
+		NodeID s(4*k), m1(4*k + 1), m2(4*k + 2), t(4*k + 3);
+		for (auto const& edge: {Edge(0, s, m1, 1), Edge(0, m1, t, 1), Edge(0, s, m2, 1), Edge(0, m2, t, 1)}) {
+			diamond_edges.push_back(edge);
+		}
+		if (k % 3 == 0) diamond_edges.push_back(Edge(0, s, t, 2));
+	}
+	for (EdgeID i(0); i<diamond_edges.size(); i++) {
+		diamond_edges[i].id = i;
+	}
+
+	CHGraph<OSMNode, Edge> diamond_g;
+	diamond_g.init(GraphInData<OSMNode, CHEdge<Edge>>{diamond_nodes, diamond_edges, Metadata()});
+
+	/* shortcuts in reverse diamond order, via m2 first for odd k */
+	std::vector<CHEdge<Edge>> diamond_shortcuts;
+	std::vector<NodeID> removed;
+	std::vector<bool> to_remove(diamond_nodes.size(), false);
+	for (NodeID k(nr_of_diamonds); k-- > 0;) {
+		NodeID s(4*k), m1(4*k + 1), m2(4*k + 2);
+		for (NodeID m: {m1, m2}) {
+			removed.push_back(m);
+			to_remove[m] = true;
+		}
+		auto s_edge(diamond_g.nodeEdges(s, EdgeType::OUT).begin());
+		auto const& via1(*s_edge);
+		auto const& via2(*++s_edge);
+		auto sc1(make_shortcut(via1, *diamond_g.nodeEdges(m1, EdgeType::OUT).begin()));
+		auto sc2(make_shortcut(via2, *diamond_g.nodeEdges(m2, EdgeType::OUT).begin()));
+		Test(sc1.center_node == m1 && sc2.center_node == m2 && sc1.dist == sc2.dist);
+		sc1.id = sc2.id = c::NO_EID;
+		diamond_shortcuts.push_back(k % 2 ? sc2 : sc1);
+		diamond_shortcuts.push_back(k % 2 ? sc1 : sc2);
+	}
+	Test(diamond_shortcuts.size() >= MIN_RADIX_SORT_SIZE);
+	diamond_g.restructure(removed, to_remove, diamond_shortcuts);
+
+	for (NodeID k(0); k<nr_of_diamonds; k++) {
+		NodeID s(4*k), t(4*k + 3);
+		Test(diamond_g.getNrOfEdges(s, EdgeType::OUT) == 1);
+		auto const& kept(*diamond_g.nodeEdges(s, EdgeType::OUT).begin());
+		Test(kept.tgt == t && kept.dist == 2);
+		if (k % 3 == 0) {
+			Test(kept.center_node == c::NO_NID);
+		}
+		else {
+			Test(kept.center_node == (k % 2 ? 4*k + 2 : 4*k + 1));
+		}
+	}
+
 	Print("\n====================================");
 	Print("TEST: CHConstructor test successful.");
 	Print("====================================\n");
 }
 
+void unit_tests::testEdgeSpill()
+{
+	Print("\n============================");
+	Print("TEST: Start edge spill test.");
+	Print("============================\n");
+
+	typedef CHEdge<OSMEdge> Shortcut;
+
+	/* merging the runs is a stable sort of all appended edges */
+	std::default_random_engine gen(23);
+	std::uniform_int_distribution<NodeID> node_dist(0, 500);
+	EdgeSpill<Edge> spill("../out");
+	for (uint round(0); round<2; round++) {
+		std::vector<Edge> expected;
+		for (uint run_size: {3000, 1, 0, 9000, 500}) {
+			std::vector<Edge> run;
+			for (uint i(0); i<run_size; i++) {
+				run.emplace_back(expected.size(), node_dist(gen), node_dist(gen), 1);
+				expected.push_back(run.back());
+			}
+			spill.appendRun(run, 2);
+		}
+		Test(spill.getNrOfRuns() == 4 && spill.getNrOfEdges() == expected.size());
+
+		std::stable_sort(expected.begin(), expected.end(), EdgeSortSrcTgt<Edge>());
+		auto merged(spill.merge());
+		Test(merged.size() == expected.size());
+		for (EdgeID i(0); i<merged.size(); i++) {
+			Test(merged[i].id == expected[i].id);
+		}
+		Test(spill.getNrOfRuns() == 0 && spill.getNrOfEdges() == 0);
+	}
+
+	/* contracting with a spilled dump gives the same CH */
+	auto data(FormatFMI::Reader::readGraph<OSMNode, Shortcut>("../test_data/15kSZHK_fmi.txt"));
+	auto contract = [&data](CHGraph<OSMNode, Edge>& g, std::vector<Shortcut> const& edges) {
+		g.init(GraphInData<OSMNode, CHEdge<Edge>>{data.nodes, slimEdges(edges), data.meta_data});
+		CHConstructor<OSMNode, Edge> chc(g, 2);
+		std::vector<NodeID> all_nodes(g.getNrOfNodes());
+		for (NodeID i(0); i<all_nodes.size(); i++) {
+			all_nodes[i] = i;
+		}
+		chc.quickContract(all_nodes, 4, 5);
+		chc.contract(all_nodes);
+	};
+
+	std::vector<Shortcut> edges(data.edges);
+	CHGraph<OSMNode, Edge> g;
+	contract(g, edges);
+	auto export_data(g.exportData(edges));
+
+	std::vector<Shortcut> spilled_edges(data.edges);
+	CHGraph<OSMNode, Edge> spilled_g;
+	spilled_g.spillEdgesDump("../out", 1000);
+	contract(spilled_g, spilled_edges);
+	auto spilled_data(spilled_g.exportData(spilled_edges));
+
+	Test(export_data.node_levels == spilled_data.node_levels);
+	Test(export_data.edges.size() == spilled_data.edges.size());
+	for (EdgeID i(0); i<export_data.edges.size(); i++) {
+		auto const& edge(export_data.edges[i]);
+		auto const& spilled_edge(spilled_data.edges[i]);
+		Test(edge.id == spilled_edge.id && edge.src == spilled_edge.src && edge.tgt == spilled_edge.tgt);
+		Test(edge.dist == spilled_edge.dist && edge.type == spilled_edge.type && edge.speed == spilled_edge.speed);
+		Test(edge.child_edge1 == spilled_edge.child_edge1 && edge.child_edge2 == spilled_edge.child_edge2);
+		Test(edge.center_node == spilled_edge.center_node);
+	}
+
+	/* and the same complete graph for queries */
+	CHGraph<OSMNode, Edge> rebuilt_g;
+	rebuilt_g.spillEdgesDump("../out", 1000);
+	contract(rebuilt_g, data.edges);
+	rebuilt_g.rebuildCompleteGraph();
+	Test(rebuilt_g.getNrOfEdges() == export_data.edges.size());
+
+	Graph<OSMNode, Edge> base_g;
+	base_g.init(GraphInData<OSMNode, Edge>{data.nodes, std::vector<Edge>(data.edges.begin(), data.edges.end()), data.meta_data});
+	Dijkstra<OSMNode, Edge> dij(base_g);
+	CHDijkstra<OSMNode, Edge> chdij(rebuilt_g);
+	std::uniform_int_distribution<NodeID> rand_node(0, base_g.getNrOfNodes() - 1);
+	std::vector<EdgeID> path;
+	for (uint i(0); i<10; i++) {
+		NodeID src(rand_node(gen));
+		NodeID tgt(rand_node(gen));
+		Test(dij.calcShopa(src, tgt, path) == chdij.calcShopa(src, tgt, path));
+	}
+
+	Print("\n==================================");
+	Print("TEST: Edge spill test successful.");
+	Print("==================================\n");
+}
+
 void unit_tests::testCHDijkstra()
 {
 	Print("\n============================");
@@ -173,6 +630,8 @@ void unit_tests::testCHDijkstra()
 	uint nr_of_dij(10);
 	Dijkstra<OSMNode, OSMEdge> dij(g);
 	CHDijkstra<OSMNode, OSMEdge> chdij(chg);
+	Dijkstra<OSMNode, OSMEdge, RadixHeap> radix_dij(g);
+	CHDijkstra<OSMNode, OSMEdge, RadixHeap> radix_chdij(chg);
 
 	std::default_random_engine gen(std::chrono::system_clock::now().time_since_epoch().count());
 	std::uniform_int_distribution<uint> dist(0,g.getNrOfNodes()-1);
@@ -182,7 +641,10 @@ void unit_tests::testCHDijkstra()
 		NodeID src = rand_node();
 		NodeID tgt = rand_node();
 		Debug("From " << src << " to " << tgt << ".");
-		Test(dij.calcShopa(src,tgt,path) == chdij.calcShopa(src,tgt,path));
+		uint shopa_dist = dij.calcShopa(src,tgt,path);
+		Test(shopa_dist == chdij.calcShopa(src,tgt,path));
+		Test(shopa_dist == radix_dij.calcShopa(src,tgt,path));
+		Test(shopa_dist == radix_chdij.calcShopa(src,tgt,path));
 	}
 
 	// Export (destroys graph data)
@@ -193,6 +655,555 @@ void unit_tests::testCHDijkstra()
 	Print("=================================\n");
 }
 
+void unit_tests::testTextScanner()
+{
+	Print("\n==============================");
+	Print("TEST: Start TextScanner test.");
+	Print("==============================\n");
+
+	/* integers behave like std::istream */
+	std::string const numbers(" 42\t-7 4294967295 -1 4294967296 18446744073709551615 x");
+	std::istringstream is(numbers);
+	TextScanner scanner(is);
+	uint u; int i; uint64_t u64;
+	scanner >> u >> i;
+	Test(scanner && u == 42 && i == -7);
+	scanner >> u;
+	Test(scanner && u == 4294967295u);
+	scanner >> u;
+	Test(scanner && u == 4294967295u);
+	scanner >> u;
+	Test(scanner.fail() && u == 4294967295u);
+
+	std::istringstream is2(numbers);
+	TextScanner scanner2(is2);
+	scanner2 >> u >> i >> u >> u >> u64 >> u64;
+	Test(scanner2 && u64 == 18446744073709551615ull);
+	Test(scanner2.peek() == ' ' && !scanner2.eof());
+	scanner2 >> u;
+	Test(scanner2.fail());
+
+	/* doubles are parsed exactly, with and without the fast path */
+	std::default_random_engine gen(23);
+	std::uniform_real_distribution<double> coord(-180, 180);
+	std::ostringstream os;
+	os.precision(7);
+	os << std::fixed;
+	std::vector<std::string> values;
+	for (uint n(0); n<1000; n++) {
+		std::ostringstream value;
+		if (n % 4 == 0) value << std::scientific;
+		else value << std::fixed;
+		value.precision(n % 2 ? 7 : 17);
+		value << coord(gen);
+		values.push_back(value.str());
+		os << value.str() << "\n";
+	}
+	os << "1e400 0.1e-5 123456789012345678901234 .5 -0";
+	values.insert(values.end(), { "1e400", "0.1e-5", "123456789012345678901234", ".5", "-0" });
+
+	std::istringstream double_is(os.str());
+	TextScanner double_scanner(double_is);
+	for (auto const& value: values) {
+		double d;
+		double_scanner >> d;
+		Test(double_scanner && d == std::strtod(value.c_str(), nullptr));
+	}
+	Test(double_scanner.eof() && double_scanner.peek() == TextScanner::EOF_CHAR);
+
+	std::string line;
+	std::istringstream line_is("# a : b\n\n12");
+	TextScanner line_scanner(line_is);
+	line_scanner.getline(line);
+	Test(line == "# a : b");
+	line_scanner.getline(line);
+	Test(line.empty());
+	line_scanner >> u;
+	Test(line_scanner && u == 12 && line_scanner.eof());
+
+	Print("\n===================================");
+	Print("TEST: TextScanner test successful.");
+	Print("===================================\n");
+}
+
+void unit_tests::testTextFormatter()
+{
+	Print("\n================================");
+	Print("TEST: Start TextFormatter test.");
+	Print("================================\n");
+
+	/* same output as an ostream with std::fixed and precision 7 */
+	std::ostringstream expected;
+	expected.precision(7);
+	expected << std::fixed;
+	std::ostringstream os;
+	{
+		TextFormatter out(os);
+
+		std::vector<int64_t> const integers { 0, 1, 9, 10, 99, 100, 12345, -1, -10, -99999,
+			std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min() };
+		for (auto i: integers) {
+			out << (long) i << ' ';
+			expected << i << ' ';
+		}
+		out << std::numeric_limits<uint64_t>::max() << ' ' << std::numeric_limits<uint>::max() << '\n';
+		expected << std::numeric_limits<uint64_t>::max() << ' ' << std::numeric_limits<uint>::max() << '\n';
+
+		std::vector<double> doubles { 0.0, -0.0, 1.0, -1.5, 0.00000005, 0.00000015, 0.00000025, -0.00000005,
+			1e-9, -1e-9, 1e-300, 5e-324, 0.1, 47.123456789, 9.99999995, 123456789.98765432,
+			1e15, 1e20, 1e300, -1e300, std::numeric_limits<double>::max(),
+			std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() };
+		std::default_random_engine gen(42);
+		std::uniform_real_distribution<double> coord(-180, 180);
+		std::uniform_int_distribution<int> exponent(-12, 12);
+		for (uint n(0); n<10000; n++) {
+			double d(coord(gen));
+			doubles.push_back(d);
+			doubles.push_back(std::round(d * 1e7) / 1e7);
+			doubles.push_back(d * std::pow(10.0, exponent(gen)));
+		}
+		for (auto d: doubles) {
+			out << d << ' ';
+			expected << d << ' ';
+		}
+	}
+	Test(os.str() == expected.str());
+
+	/* low-level functions write into the given buffer */
+	char buffer[TextFormatter::MAX_VALUE_LENGTH];
+	Test(std::string(buffer, TextFormatter::formatFixed(buffer, 2.5, 0)) == "2");
+	Test(std::string(buffer, TextFormatter::formatFixed(buffer, 3.5, 0)) == "4");
+	Test(std::string(buffer, TextFormatter::formatFixed(buffer, 0.125, 2)) == "0.12");
+	Test(std::string(buffer, TextFormatter::formatSigned(buffer, -42)) == "-42");
+
+	Print("\n======================================");
+	Print("TEST: TextFormatter test successful.");
+	Print("======================================\n");
+}
+
+void unit_tests::testCHFileFormats()
+{
+	Print("\n===============================");
+	Print("TEST: Start CH file format test.");
+	Print("===============================\n");
+
+	typedef CHEdge<OSMEdge> Shortcut;
+
+	/* The edge writers write what the former iostream writers wrote */
+	{
+		auto oldChildEdge = [](EdgeID child_edge) {
+			return child_edge == c::NO_EID ? std::string("-1") : std::to_string(child_edge);
+		};
+		for (EdgeID child_edge: { c::NO_EID, EdgeID(0), EdgeID(12345) }) {
+			Shortcut edge(OSMEdge(7, 1, 2, 42, 3, 50), child_edge, child_edge, child_edge == c::NO_EID ? c::NO_NID : 5);
+			std::ostringstream os, expected;
+			text_writeEdge(os, edge);
+			expected << edge.src << " " << edge.tgt << " " << edge.dist << " " << edge.type << " " << edge.speed << " "
+				<< oldChildEdge(edge.child_edge1) << " " << oldChildEdge(edge.child_edge2) << "\n";
+			Test(os.str() == expected.str());
+
+			CHEdge<EuclOSMEdge> eucl_edge(EuclOSMEdge(7, 1, 2, 42, 3, 50, 40), child_edge, child_edge, c::NO_NID);
+			os.str("");
+			expected.str("");
+			text_writeEdge(os, eucl_edge);
+			expected << eucl_edge.src << " " << eucl_edge.tgt << " " << eucl_edge.dist << " " << eucl_edge.type << " "
+				<< eucl_edge.eucl_dist << " " << oldChildEdge(child_edge) << " " << oldChildEdge(child_edge) << "\n";
+			Test(os.str() == expected.str());
+
+			CHEdge<StefanEdge> stefan_edge(StefanEdge(7, 1, 2, 42), child_edge, child_edge, c::NO_NID);
+			os.str("");
+			expected.str("");
+			text_writeEdge(os, stefan_edge);
+			expected << stefan_edge.src << " " << stefan_edge.tgt << " " << stefan_edge.dist << " "
+				<< oldChildEdge(child_edge) << " " << oldChildEdge(child_edge) << "\n";
+			Test(os.str() == expected.str());
+		}
+	}
+
+	/* Build CH */
+	Graph<OSMNode, OSMEdge> g;
+	g.init(FormatSTD::Reader::readGraph<OSMNode, OSMEdge>("../test_data/15kSZHK.txt"));
+
+	CHGraph<OSMNode, OSMEdge> chg;
+	chg.init(FormatSTD::Reader::readGraph<OSMNode, Shortcut>("../test_data/15kSZHK.txt"));
+
+	CHConstructor<OSMNode, OSMEdge> chc(chg, 2);
+	std::vector<NodeID> all_nodes(g.getNrOfNodes());
+	for (NodeID i(0); i<all_nodes.size(); i++) {
+		all_nodes[i] = i;
+	}
+	chc.quickContract(all_nodes, 4, 5);
+	chc.contract(all_nodes);
+	chc.rebuildCompleteGraph();
+
+	/* Export (destroys graph data) */
+	auto data(chg.exportData());
+	writeCHGraphFile<FormatFMI_CH::Writer>("../out/ch_15kSZHK.fmi_ch", data);
+	writeCHGraphFile<FormatSTEFAN_CH::Writer>("../out/ch_15kSZHK.stefan_ch", data);
+	writeCHGraphFile(FileFormat::BINARY, "../out/ch_15kSZHK.bin", data);
+
+	/* Formatting in parallel writes exactly the same file (apart from the random id and the timestamp) */
+	writeCHGraphFile<FormatFMI_CH::Writer>("../out/ch_15kSZHK_parallel.fmi_ch", data, 4);
+	auto readFile = [](std::string const& filename) {
+		std::ifstream is(filename, std::ios::binary);
+		std::string content((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+		for (char const* key: { "# Id : ", "# Timestamp : " }) {
+			auto pos(content.find(key));
+			if (pos != std::string::npos) content.erase(pos, content.find('\n', pos) - pos);
+		}
+		return content;
+	};
+	std::string const fmi_ch_file(readFile("../out/ch_15kSZHK.fmi_ch"));
+	Test(!fmi_ch_file.empty() && fmi_ch_file == readFile("../out/ch_15kSZHK_parallel.fmi_ch"));
+
+	/* Read back */
+	auto fmi_data(readCHGraph<OSMNode, Shortcut>(FileFormat::FMI_CH, "../out/ch_15kSZHK.fmi_ch"));
+	auto parallel_fmi_data(readCHGraph<OSMNode, Shortcut>(FileFormat::FMI_CH, "../out/ch_15kSZHK.fmi_ch", 4));
+	auto stefan_data(readCHGraph<StefanNode, CHEdge<StefanEdge>>(FileFormat::STEFAN_CH, "../out/ch_15kSZHK.stefan_ch"));
+	auto bin_data(readCHGraph<OSMNode, Shortcut>(FileFormat::BINARY, "../out/ch_15kSZHK.bin"));
+
+	Test(isCHFile(FileFormat::BINARY, "../out/ch_15kSZHK.bin"));
+	/* only the header is read, files which aren't binary graphs are no CH files */
+	Test(!isCHFile(FileFormat::BINARY, "../out/ch_15kSZHK.fmi_ch"));
+	Test(fmi_data.node_levels == data.node_levels);
+	Test(parallel_fmi_data.node_levels == data.node_levels);
+	Test(parallel_fmi_data.edges.size() == data.edges.size());
+	Test(stefan_data.node_levels == data.node_levels);
+	Test(bin_data.node_levels == data.node_levels);
+	Test(fmi_data.edges.size() == data.edges.size());
+	Test(stefan_data.edges.size() == data.edges.size());
+	Test(bin_data.edges.size() == data.edges.size());
+	for (NodeID i(0); i<data.nodes.size(); i++) {
+		Test(bin_data.nodes[i].id == i && bin_data.nodes[i].osm_id == data.nodes[i].osm_id);
+		Test(bin_data.nodes[i].lat == data.nodes[i].lat && bin_data.nodes[i].lon == data.nodes[i].lon);
+		Test(parallel_fmi_data.nodes[i].osm_id == data.nodes[i].osm_id);
+	}
+	for (EdgeID i(0); i<data.edges.size(); i++) {
+		auto const& edge(data.edges[i]);
+		for (auto const& read_edge: { static_cast<CHEdge<StefanEdge>>(fmi_data.edges[i]), stefan_data.edges[i],
+				static_cast<CHEdge<StefanEdge>>(bin_data.edges[i]) }) {
+			Test(read_edge.src == edge.src && read_edge.tgt == edge.tgt && read_edge.dist == edge.dist);
+		}
+		for (auto const& read_edge: { fmi_data.edges[i], parallel_fmi_data.edges[i], bin_data.edges[i] }) {
+			Test(read_edge.id == i);
+			Test(read_edge.child_edge1 == edge.child_edge1 && read_edge.child_edge2 == edge.child_edge2);
+			Test(read_edge.center_node == edge.center_node);
+			Test(read_edge.type == edge.type && read_edge.speed == edge.speed);
+		}
+		Test(stefan_data.edges[i].child_edge1 == edge.child_edge1 && stefan_data.edges[i].child_edge2 == edge.child_edge2);
+	}
+
+	/* The up-CSR of the binary file lists exactly the upward edges */
+	FormatBinary::MappedFile bin_file("../out/ch_15kSZHK.bin", true);
+	auto const* up_out_offsets(bin_file.section<EdgeID>(FormatBinary::SectionType::UP_OUT_OFFSETS));
+	auto const* up_out_edges(bin_file.section<EdgeID>(FormatBinary::SectionType::UP_OUT_EDGES));
+	for (NodeID node(0); node<data.nodes.size(); node++) {
+		for (uint i(up_out_offsets[node]); i<up_out_offsets[node + 1]; i++) {
+			auto const& edge(data.edges[up_out_edges[i]]);
+			Test(edge.src == node && data.node_levels[edge.src] < data.node_levels[edge.tgt]);
+		}
+	}
+	Test(bin_file.sectionCount<EdgeID>(FormatBinary::SectionType::UP_OUT_EDGES)
+			+ bin_file.sectionCount<EdgeID>(FormatBinary::SectionType::UP_IN_EDGES) == data.edges.size());
+
+	/* Parsing in parallel chunks gives the same graph */
+	auto parallel_graph_data(readGraph<OSMNode, OSMEdge>(FileFormat::STD, "../test_data/15kSZHK.txt", 4));
+	Test(parallel_graph_data.nodes.size() == g.getNrOfNodes());
+	Test(parallel_graph_data.edges.size() == g.getNrOfEdges());
+	for (EdgeID i(0); i<g.getNrOfEdges(); i++) {
+		auto const& edge(g.getEdge(i));
+		auto const& read_edge(parallel_graph_data.edges[i]);
+		Test(read_edge.id == edge.id && read_edge.src == edge.src && read_edge.tgt == edge.tgt && read_edge.dist == edge.dist);
+	}
+
+	/* A binary CH read as plain graph only has the original edges */
+	auto bin_graph_data(readGraph<OSMNode, OSMEdge>(FileFormat::BINARY, "../out/ch_15kSZHK.bin"));
+	Test(bin_graph_data.nodes.size() == g.getNrOfNodes());
+	Test(bin_graph_data.edges.size() == g.getNrOfEdges());
+
+	/* The loaded CH answers queries without contracting again */
+	CHGraph<OSMNode, OSMEdge> loaded_chg;
+	loaded_chg.init(std::move(fmi_data));
+
+	/* ... also straight from the mapped binary file */
+	MappedCHGraph mapped_chg("../out/ch_15kSZHK.bin");
+	Test(mapped_chg.getNrOfNodes() == g.getNrOfNodes());
+	Test(mapped_chg.getNrOfEdges() == data.edges.size());
+
+	Dijkstra<OSMNode, OSMEdge> dij(g);
+	CHDijkstra<OSMNode, OSMEdge> chdij(loaded_chg);
+	CHDijkstra<OSMNode, OSMEdge, RadixHeap, MappedCHGraph> mapped_chdij(mapped_chg);
+
+	std::default_random_engine gen(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint> dist(0,g.getNrOfNodes()-1);
+	auto rand_node = std::bind (dist, gen);
+	std::vector<EdgeID> path;
+	for (uint i(0); i<10; i++) {
+		NodeID src = rand_node();
+		NodeID tgt = rand_node();
+		uint shopa_dist = dij.calcShopa(src,tgt,path);
+		Test(shopa_dist == chdij.calcShopa(src,tgt,path));
+		Test(shopa_dist == mapped_chdij.calcShopa(src,tgt,path));
+
+		uint path_dist(0);
+		for (auto edge_id: path) {
+			path_dist += mapped_chg.getEdge(edge_id).distance();
+		}
+		Test(src == tgt || shopa_dist == c::NO_DIST || path_dist == shopa_dist);
+	}
+
+	Print("\n=====================================");
+	Print("TEST: CH file format test successful.");
+	Print("=====================================\n");
+}
+
+void unit_tests::testCompressedCHGraph()
+{
+	Print("\n===================================");
+	Print("TEST: Start CompressedCHGraph test.");
+	Print("===================================\n");
+
+	/* written by testCHFileFormats() */
+	MappedCHGraph mapped_chg("../out/ch_15kSZHK.bin");
+	CompressedCHGraph compressed_chg(mapped_chg);
+	Test(compressed_chg.getNrOfNodes() == mapped_chg.getNrOfNodes());
+	Test(compressed_chg.getNrOfBytes() < mapped_chg.getNrOfEdges() * sizeof(FormatBinary::BinaryEdge));
+
+	/* the same upward edges, with the ids of the compressed graph */
+	EdgeID nr_of_up_edges(0);
+	for (NodeID node(0); node<mapped_chg.getNrOfNodes(); node++) {
+		for (auto type: {EdgeType::OUT, EdgeType::IN}) {
+			Test(compressed_chg.getNrOfEdges(node, type) == mapped_chg.getNrOfEdges(node, type));
+			std::multiset<std::tuple<NodeID, NodeID, uint, NodeID>> mapped_edges;
+			for (auto const& edge: mapped_chg.nodeEdges(node, type)) {
+				mapped_edges.insert(std::make_tuple(edge.src, edge.tgt, edge.distance(), edge.center_node));
+			}
+			for (auto const& edge: compressed_chg.nodeEdges(node, type)) {
+				Test(edge.id == nr_of_up_edges++);
+				auto it(mapped_edges.find(std::make_tuple(edge.src, edge.tgt, edge.distance(), edge.center_node)));
+				Test(it != mapped_edges.end());
+				mapped_edges.erase(it);
+
+				/* shortcuts are resolved into their children */
+				auto full_edge(compressed_chg.getEdge(edge.id));
+				Test(full_edge.src == edge.src && full_edge.tgt == edge.tgt && full_edge.dist == edge.dist);
+				if (edge.center_node != c::NO_NID) {
+					auto child1(compressed_chg.getEdge(full_edge.child_edge1));
+					auto child2(compressed_chg.getEdge(full_edge.child_edge2));
+					Test(child1.src == edge.src && child1.tgt == edge.center_node && child2.tgt == edge.tgt);
+					Test(child1.distance() + child2.distance() == edge.distance());
+				}
+			}
+			Test(mapped_edges.empty());
+		}
+	}
+	Test(nr_of_up_edges == compressed_chg.getNrOfEdges());
+
+	/* same queries and paths */
+	CHQueryServer<OSMNode, OSMEdge, MappedCHGraph> mapped_server(mapped_chg);
+	CHQueryServer<OSMNode, OSMEdge, CompressedCHGraph> compressed_server(compressed_chg);
+
+	std::default_random_engine gen(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint> dist(0,mapped_chg.getNrOfNodes()-1);
+	auto rand_node = std::bind (dist, gen);
+	std::vector<std::string> requests;
+	for (uint i(0); i<10; i++) {
+		requests.push_back("p " + std::to_string(rand_node()) + " " + std::to_string(rand_node()));
+	}
+	auto mapped_responses(mapped_server.handleBatch(requests));
+	auto compressed_responses(compressed_server.handleBatch(requests));
+	for (size_t i(0); i<requests.size(); i++) {
+		/* the distance has to match, the path may differ on ties */
+		Test(mapped_responses[i].substr(0, mapped_responses[i].find(' ')) ==
+			compressed_responses[i].substr(0, compressed_responses[i].find(' ')));
+
+		/* ... and it has to lead from src to tgt */
+		std::istringstream request(requests[i]), path(compressed_responses[i]);
+		std::string type;
+		NodeID src, tgt, first, node;
+		int path_dist;
+		request >> type >> src >> tgt;
+		path >> path_dist;
+		if (path_dist < 0) continue;
+		path >> first;
+		NodeID last(first);
+		while (path >> node) last = node;
+		Test(first == src && last == tgt);
+	}
+
+	Print("\n========================================");
+	Print("TEST: CompressedCHGraph test successful.");
+	Print("========================================\n");
+}
+
+void unit_tests::testCompression()
+{
+	Print("\n==============================");
+	Print("TEST: Start compression test.");
+	Print("==============================\n");
+
+	auto data(readGraph<OSMNode, OSMEdge>(FileFormat::FMI, "../test_data/15kSZHK_fmi.txt"));
+	GraphOutData<OSMNode, OSMEdge> out_data { data.nodes, data.edges, data.meta_data };
+
+	std::vector<std::string> filenames;
+#ifdef CHC_HAVE_ZLIB
+	filenames.push_back("../out/15kSZHK.fmi.gz");
+#endif
+#ifdef CHC_HAVE_ZSTD
+	filenames.push_back("../out/15kSZHK.fmi.zst");
+#endif
+
+	for (auto const& filename: filenames) {
+		writeGraphFile(FileFormat::FMI, filename, out_data, 2);
+
+		/* decompressed blocks only end after complete lines */
+		DecompressingReader reader(filename, compressionOf(filename));
+		std::string block;
+		size_t nr_of_blocks(0);
+		while (reader.next(block)) {
+			Test(!block.empty() && block.back() == '\n');
+			nr_of_blocks++;
+		}
+		Test(nr_of_blocks > 1);
+
+		for (uint num_threads: { 1, 4 }) {
+			auto read_data(readGraph<OSMNode, OSMEdge>(FileFormat::FMI, filename, num_threads));
+			Test(read_data.nodes.size() == data.nodes.size());
+			Test(read_data.edges.size() == data.edges.size());
+			for (NodeID i(0); i<data.nodes.size(); i++) {
+				Test(read_data.nodes[i].osm_id == data.nodes[i].osm_id && read_data.nodes[i].elev == data.nodes[i].elev);
+			}
+			for (EdgeID i(0); i<data.edges.size(); i++) {
+				auto const& edge(data.edges[i]);
+				auto const& read_edge(read_data.edges[i]);
+				/* reading FMI applies the time metric to dist again */
+				Test(read_edge.src == edge.src && read_edge.tgt == edge.tgt);
+				Test(read_edge.type == edge.type && read_edge.speed == edge.speed);
+			}
+		}
+	}
+
+	/* streams ending exactly at the end of a decompression chunk (256 KiB) */
+	std::string lines;
+	for (uint i(0); i<43690; i++) {
+		lines += "1 2 3\n";
+	}
+	lines += "4 5\n";
+	Test(lines.size() == 262144);
+
+	auto readAll = [](std::string const& filename) {
+		DecompressingReader reader(filename, compressionOf(filename));
+		std::string all, block;
+		while (reader.next(block)) {
+			all += block;
+		}
+		return all;
+	};
+
+	std::vector<std::string> chunk_filenames;
+#ifdef CHC_HAVE_ZLIB
+	chunk_filenames.push_back("../out/chunk.txt.gz");
+#endif
+#ifdef CHC_HAVE_ZSTD
+	chunk_filenames.push_back("../out/chunk.txt.zst");
+#endif
+
+	for (auto const& filename: chunk_filenames) {
+		{
+			CompressingOStream os(filename, compressionOf(filename));
+			os << lines;
+			os.close();
+		}
+		Test(readAll(filename) == lines);
+
+		/* two gzip members / zstd frames */
+		std::string const twice_filename("../out/twice_" + filename.substr(filename.rfind('/') + 1));
+		{
+			std::ifstream in(filename, std::ios::binary);
+			std::string compressed((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+			std::ofstream out(twice_filename, std::ios::binary);
+			out << compressed << compressed;
+		}
+		Test(readAll(twice_filename) == lines + lines);
+	}
+
+	Print("\n====================================");
+	Print("TEST: compression test successful.");
+	Print("====================================\n");
+}
+
+void unit_tests::testGraphCache()
+{
+	Print("\n==============================");
+	Print("TEST: Start graph cache test.");
+	Print("==============================\n");
+
+	typedef CHEdge<OSMEdge> Shortcut;
+
+	/* work on a copy, the cache is written next to the input */
+	std::string const filename("../out/cache_15kSZHK.fmi");
+	std::string const cache_filename(GraphCache::cacheFilename(filename));
+	{
+		std::ifstream in("../test_data/15kSZHK_fmi.txt", std::ios::binary);
+		std::ofstream out(filename, std::ios::binary);
+		out << in.rdbuf();
+	}
+	std::remove(cache_filename.c_str());
+
+	auto data(readGraph<OSMNode, Shortcut>(FileFormat::FMI, filename));
+	Metadata key(GraphCache::sourceKey(filename, to_string(FileFormat::FMI)));
+	Test(!GraphCache::isValid(cache_filename, key));
+
+	auto checkData = [&data](GraphInData<OSMNode, Shortcut> const& read_data) {
+		Test(read_data.meta_data == data.meta_data);
+		Test(read_data.nodes.size() == data.nodes.size());
+		Test(read_data.edges.size() == data.edges.size());
+		for (NodeID i(0); i<data.nodes.size(); i++) {
+			Test(read_data.nodes[i].id == i && read_data.nodes[i].osm_id == data.nodes[i].osm_id);
+			Test(read_data.nodes[i].lat == data.nodes[i].lat && read_data.nodes[i].lon == data.nodes[i].lon);
+		}
+		for (EdgeID i(0); i<data.edges.size(); i++) {
+			auto const& edge(data.edges[i]);
+			auto const& read_edge(read_data.edges[i]);
+			Test(read_edge.id == edge.id && read_edge.src == edge.src && read_edge.tgt == edge.tgt);
+			Test(read_edge.dist == edge.dist && read_edge.type == edge.type && read_edge.speed == edge.speed);
+		}
+	};
+
+	/* first read builds the cache, the second one uses it */
+	checkData(readGraph<OSMNode, Shortcut>(FileFormat::FMI, filename, 1, true));
+	Test(GraphCache::isValid(cache_filename, key));
+	checkData(readGraph<OSMNode, Shortcut>(FileFormat::FMI, filename, 1, true));
+
+	/* a different format or a changed file invalidates it */
+	Test(!GraphCache::isValid(cache_filename, GraphCache::sourceKey(filename, to_string(FileFormat::STD))));
+	{
+		std::ofstream out(filename, std::ios::binary | std::ios::app);
+		out << "\n";
+	}
+	Metadata new_key(GraphCache::sourceKey(filename, to_string(FileFormat::FMI)));
+	Test(new_key != key && !GraphCache::isValid(cache_filename, new_key));
+	checkData(readGraph<OSMNode, Shortcut>(FileFormat::FMI, filename, 1, true));
+	Test(GraphCache::isValid(cache_filename, new_key));
+
+	/* concurrent runs write to different temporary files */
+	std::string const tmp1(GraphCache::createTempFile(cache_filename));
+	std::string const tmp2(GraphCache::createTempFile(cache_filename));
+	Test(!tmp1.empty() && !tmp2.empty() && tmp1 != tmp2);
+	Test(tmp1.compare(0, cache_filename.size(), cache_filename) == 0);
+	Test(std::remove(tmp1.c_str()) == 0 && std::remove(tmp2.c_str()) == 0);
+
+	std::remove(cache_filename.c_str());
+	std::thread other_run([&]() { checkData(readGraph<OSMNode, Shortcut>(FileFormat::FMI, filename, 1, true)); });
+	checkData(readGraph<OSMNode, Shortcut>(FileFormat::FMI, filename, 1, true));
+	other_run.join();
+	Test(GraphCache::isValid(cache_filename, new_key));
+
+	Print("\n====================================");
+	Print("TEST: graph cache test successful.");
+	Print("====================================\n");
+}
+
 void unit_tests::testDijkstra()
 {
 	Print("\n============================");
@@ -223,6 +1234,22 @@ void unit_tests::testDijkstra()
 		}
 	}
 
+	Print("Test relaxing blocks of edges, with repeated targets.");
+	StampedLabels<uint> labels(8, c::NO_DIST);
+	labels.set(2, 3);
+	std::vector<NodeID> nodes = { 1, 2, 3, 1, 4, 5, 6, 2, 1, 7, 0, 3 };
+	std::vector<uint> dists   = { 9, 1, 4, 7, 2, 8, 3, 6, 8, 5, 1, 2 };
+	std::vector<size_t> improved;
+	labels.relax(3, nodes.data(), dists.data(), nodes.size(), [&](size_t i, uint new_dist) {
+		Test(new_dist == 3 + dists[i]);
+		improved.push_back(i);
+	});
+	Test(improved == std::vector<size_t>({ 0, 2, 3, 4, 5, 6, 9, 10, 11 }));
+	std::vector<uint> expected = { 4, 10, 3, 5, 5, 11, 6, 8 };
+	for (NodeID node(0); node<expected.size(); node++) {
+		Test(labels[node] == expected[node]);
+	}
+
 	Print("\n=================================");
 	Print("TEST: Dijkstra test successful.");
 	Print("=================================\n");
@@ -287,4 +1314,280 @@ void unit_tests::testPrioritizers()
 	Print("==================================\n");
 }
 
+void unit_tests::testPHAST()
+{
+	Print("\n=======================");
+	Print("TEST: Start PHAST test.");
+	Print("=======================\n");
+
+	typedef CHEdge<OSMEdge> Shortcut;
+	typedef CHGraph<OSMNode, OSMEdge> CHGraphOSM;
+
+	/* Init normal graph */
+	Graph<OSMNode, OSMEdge> g;
+	g.init(FormatSTD::Reader::readGraph<OSMNode, OSMEdge>("../test_data/15kSZHK.txt"));
+
+	/* Init CH graph */
+	CHGraphOSM chg;
+	chg.init(FormatSTD::Reader::readGraph<OSMNode, Shortcut>("../test_data/15kSZHK.txt"));
+
+	/* Build CH */
+	CHConstructor<OSMNode, OSMEdge> chc(chg, 2);
+	std::vector<NodeID> all_nodes(g.getNrOfNodes());
+	for (NodeID i(0); i<all_nodes.size(); i++) {
+		all_nodes[i] = i;
+	}
+	chc.quickContract(all_nodes, 4, 5);
+	chc.contract(all_nodes);
+	chc.rebuildCompleteGraph();
+
+	Dijkstra<OSMNode, OSMEdge> dij(g);
+	PHAST<OSMNode, OSMEdge> phast(chg);
+	MultiPHAST<OSMNode, OSMEdge, 8> multi_phast(chg);
+
+	std::default_random_engine gen(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint> dist(0,g.getNrOfNodes()-1);
+	auto rand_node = std::bind (dist, gen);
+
+	std::vector<NodeID> sources;
+	for (uint i(0); i<multi_phast.NR_OF_SOURCES; i++) {
+		sources.push_back(rand_node());
+	}
+	multi_phast.calcDists(sources);
+
+	Print("Comparing PHAST with Dijkstra and multi-source PHAST.");
+	std::vector<EdgeID> path;
+	for (uint i(0); i<sources.size(); i++) {
+		phast.calcDists(sources[i]);
+		for (NodeID node(0); node<g.getNrOfNodes(); node++) {
+			Test(phast.getDist(node) == multi_phast.getDist(i, node));
+		}
+		for (uint j(0); j<10; j++) {
+			NodeID tgt = rand_node();
+			Test(dij.calcShopa(sources[i], tgt, path) == phast.getDist(tgt));
+		}
+	}
+
+	Print("Comparing RPHAST with PHAST.");
+	std::vector<NodeID> targets;
+	for (uint i(0); i<100; i++) {
+		targets.push_back(rand_node());
+	}
+	RPHAST<OSMNode, OSMEdge> rphast(chg, targets);
+	Print("RPHAST selected " << rphast.getNrOfSelectedNodes() << " nodes for " << targets.size() << " targets.");
+	for (NodeID src: sources) {
+		phast.calcDists(src);
+		rphast.calcDists(src);
+		for (uint i(0); i<targets.size(); i++) {
+			Test(rphast.getTargetDist(i) == phast.getDist(targets[i]));
+		}
+	}
+
+	/* no targets select no nodes (and not all of them) */
+	RPHAST<OSMNode, OSMEdge> empty_rphast(chg, std::vector<NodeID>());
+	Test(empty_rphast.getNrOfSelectedNodes() == 0);
+	empty_rphast.calcDists(sources[0]);
+
+	Print("\n============================");
+	Print("TEST: PHAST test successful.");
+	Print("============================\n");
+}
+
+void unit_tests::testRangeQuery()
+{
+	Print("\n============================");
+	Print("TEST: Start RangeQuery test.");
+	Print("============================\n");
+
+	typedef CHEdge<OSMEdge> Shortcut;
+	typedef CHGraph<OSMNode, OSMEdge> CHGraphOSM;
+
+	/* Init CH graph */
+	CHGraphOSM chg;
+	chg.init(FormatSTD::Reader::readGraph<OSMNode, Shortcut>("../test_data/15kSZHK.txt"));
+
+	/* Build CH */
+	CHConstructor<OSMNode, OSMEdge> chc(chg, 2);
+	std::vector<NodeID> all_nodes(chg.getNrOfNodes());
+	for (NodeID i(0); i<all_nodes.size(); i++) {
+		all_nodes[i] = i;
+	}
+	chc.quickContract(all_nodes, 4, 5);
+	chc.contract(all_nodes);
+	chc.rebuildCompleteGraph();
+
+	PHAST<OSMNode, OSMEdge> phast(chg);
+	CHRangeQuery<OSMNode, OSMEdge> range_query(chg);
+
+	std::default_random_engine gen(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint> dist(0,chg.getNrOfNodes()-1);
+	auto rand_node = std::bind (dist, gen);
+
+	for (uint i(0); i<10; i++) {
+		NodeID src = rand_node();
+		phast.calcDists(src);
+		uint max_dist = phast.getDist(rand_node());
+		if (max_dist == c::NO_DIST) continue;
+
+		range_query.calcRange(src, max_dist);
+		Print("Found " << range_query.nodesInRange().size() << " nodes within " << max_dist << " from " << src << ".");
+
+		uint nr_in_range(0);
+		for (NodeID node(0); node<chg.getNrOfNodes(); node++) {
+			if (phast.getDist(node) <= max_dist) {
+				Test(range_query.getDist(node) == phast.getDist(node));
+				nr_in_range++;
+			}
+			else {
+				Test(range_query.getDist(node) == c::NO_DIST);
+			}
+		}
+		Test(nr_in_range == range_query.nodesInRange().size());
+		Test(range_query.getNodeCoordinates().size() == nr_in_range);
+
+		for (EdgeID edge_id: range_query.getBoundaryEdges()) {
+			auto const& edge(chg.getEdge(edge_id));
+			Test(phast.getDist(edge.src) + edge.distance() > max_dist);
+		}
+	}
+
+	Print("\n=================================");
+	Print("TEST: RangeQuery test successful.");
+	Print("=================================\n");
+}
+
+void unit_tests::testQueryServer()
+{
+	Print("\n=============================");
+	Print("TEST: Start QueryServer test.");
+	Print("=============================\n");
+
+	typedef CHEdge<OSMEdge> Shortcut;
+	typedef CHGraph<OSMNode, OSMEdge> CHGraphOSM;
+
+	/* Init CH graph */
+	CHGraphOSM chg;
+	chg.init(FormatSTD::Reader::readGraph<OSMNode, Shortcut>("../test_data/test"));
+
+	/* Build CH */
+	CHConstructor<OSMNode, OSMEdge> chc(chg, 2);
+	std::vector<NodeID> all_nodes(chg.getNrOfNodes());
+	for (NodeID i(0); i<all_nodes.size(); i++) {
+		all_nodes[i] = i;
+	}
+	chc.contract(all_nodes);
+	chc.rebuildCompleteGraph();
+
+	CHQueryServer<OSMNode, OSMEdge> server(chg, 2);
+	NodeID tgt(chg.getNrOfNodes() - 1);
+	std::string const query("0 " + std::to_string(tgt));
+
+	auto responses(server.handleBatch({ "d " + query, "p " + query, "x", "d 0", "d 0 999999", "s" }));
+	Test(responses.size() == 6);
+	Test(responses[0] == "18");
+
+	/* path: distance, then connected nodes from 0 to tgt summing up to the distance */
+	std::istringstream path(responses[1]);
+	uint dist(0), path_dist(0);
+	NodeID prev, node;
+	path >> dist >> prev;
+	Test(dist == 18 && prev == 0);
+	while (path >> node) {
+		uint best(c::NO_DIST);
+		for (auto const& edge: chg.nodeEdges(prev, EdgeType::OUT)) {
+			if (edge.tgt == node && edge.center_node == c::NO_NID) best = std::min(best, edge.distance());
+		}
+		Test(best != c::NO_DIST);
+		path_dist += best;
+		prev = node;
+	}
+	Test(prev == tgt && path_dist == dist);
+
+	Test(responses[2].compare(0, 5, "error") == 0);
+	Test(responses[3].compare(0, 5, "error") == 0);
+	Test(responses[4].compare(0, 5, "error") == 0);
+	Test(responses[5].compare(0, 9, "requests ") == 0);
+
+	/* protocol over a socket pair: all lines answered in order, ends at EOF */
+	int fds[2];
+	Test(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	std::thread server_thread([&server, &fds]() { server.serve(fds[1], fds[1]); });
+
+	std::string const requests("d " + query + "\nd 0 0\r\nd " + query);
+	Test(write(fds[0], requests.data(), requests.size()) == ssize_t(requests.size()));
+	shutdown(fds[0], SHUT_WR);
+
+	std::string answers;
+	char buf[256];
+	ssize_t len;
+	while ((len = read(fds[0], buf, sizeof(buf))) > 0) {
+		answers.append(buf, len);
+		if (std::count(answers.begin(), answers.end(), '\n') == 3) break;
+	}
+	server_thread.join();
+	close(fds[0]);
+	close(fds[1]);
+	Test(answers == "18\n0\n18\n");
+	Test(server.getLatencyStats().count() == 9);
+
+	/* a client which doesn't read its responses doesn't hold up the others */
+	typedef CHQueryServer<OSMNode, OSMEdge>::Client Client;
+	int slow[2], fast[2];
+	Test(socketpair(AF_UNIX, SOCK_STREAM, 0, slow) == 0);
+	Test(socketpair(AF_UNIX, SOCK_STREAM, 0, fast) == 0);
+	for (int fd: { slow[0], slow[1], fast[1] }) {
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	}
+
+	/* path requests until the socket is full; the responses are larger than its buffer */
+	std::string slow_requests;
+	while (slow_requests.size() < (1 << 16)) {
+		slow_requests += "p " + query + "\n";
+	}
+	while (write(slow[0], slow_requests.data(), slow_requests.size()) > 0) { }
+
+	std::thread clients_thread([&]() {
+		server._serve(-1, {
+			Client { slow[1], slow[1], std::string(), std::string(), false, false },
+			Client { fast[1], fast[1], std::string(), std::string(), false, false }
+		});
+	});
+
+	std::string const fast_request("d " + query + "\n");
+	Test(write(fast[0], fast_request.data(), fast_request.size()) == ssize_t(fast_request.size()));
+	shutdown(fast[0], SHUT_WR);
+	answers.clear();
+	while (answers.find('\n') == std::string::npos && (len = read(fast[0], buf, sizeof(buf))) > 0) {
+		answers.append(buf, len);
+	}
+	Test(answers == "18\n");
+
+	/* the server drops the slow client once it goes away */
+	close(slow[0]);
+	clients_thread.join();
+	close(slow[1]);
+	close(fast[0]);
+	close(fast[1]);
+
+	/* a line without end isn't buffered forever; the server stops reading from that client */
+	Test(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	server_thread = std::thread([&server, &fds]() { server.serve(fds[1], fds[1]); });
+
+	std::string const long_requests("d " + query + "\n" + std::string(CHQueryServer<OSMNode, OSMEdge>::MAX_REQUEST_LENGTH + 1, 'x'));
+	Test(write(fds[0], long_requests.data(), long_requests.size()) == ssize_t(long_requests.size()));
+	answers.clear();
+	while ((len = read(fds[0], buf, sizeof(buf))) > 0) {
+		answers.append(buf, len);
+		if (std::count(answers.begin(), answers.end(), '\n') == 2) break;
+	}
+	server_thread.join();
+	close(fds[0]);
+	close(fds[1]);
+	Test(answers == "18\nerror request too long\n");
+
+	Print("\n==================================");
+	Print("TEST: QueryServer test successful.");
+	Print("==================================\n");
+}
+
 }